@@ -0,0 +1,164 @@
+/*
+AsyncFrameStage.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "RingQueue.h"
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Moves the processing of the frames of a filter off the ticker thread: Push only queues the frame, and a
+	/// dedicated worker thread hands the frames to the process function, in order.
+	/// The queue is bounded, when it is full the oldest frame is dropped: a display only wants the newest frames.
+	/// T is a pointer to a frame, the stage owns the frames it holds and releases the unprocessed ones with dispose.
+	/// </summary>
+	template <class T>
+	class AsyncFrameStage
+	{
+	public:
+		typedef void (*DisposeFunc)(T item);
+		/// Takes the ownership of the frame.
+		typedef std::function<void(T item)> ProcessFunc;
+
+		AsyncFrameStage(size_t depth, DisposeFunc dispose)
+			: mQueue(depth), mDepth((depth > 0) ? depth : 1), mDispose(dispose), mRunning(false), mStop(false), mDroppedCount(0), mProcessedCount(0)
+		{}
+
+		~AsyncFrameStage()
+		{
+			Stop();
+		}
+
+		/// A stop in progress on another thread is waited for, so that the stage is restarted after it.
+		void Start(const ProcessFunc &process)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mStopped.wait(lock, [this]() { return !mRunning || !mStop; });
+			if (mRunning) return;
+			mProcess = process;
+			mStop = false;
+			mRunning = true;
+			mThread = std::thread(&AsyncFrameStage::WorkerLoop, this);
+		}
+
+		/// Wait for the frame being processed, if any, and release the queued ones.
+		/// The worker is moved out under the lock, so that only one of concurrent callers joins it: the others
+		/// wait for it to be joined, the callers relying on no frame being processed once Stop has returned.
+		void Stop()
+		{
+			std::thread worker;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				if (!mRunning) return;
+				if (mStop) {
+					mStopped.wait(lock, [this]() { return !mRunning; });
+					return;
+				}
+				mStop = true;
+				worker = std::move(mThread);
+			}
+			mFrameAvailable.notify_one();
+			worker.join();
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mQueue.Clear(mDispose);
+				mProcess = nullptr;
+				mRunning = false;
+			}
+			mStopped.notify_all();
+		}
+
+		bool IsRunning()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mRunning;
+		}
+
+		/// Queue a frame for the worker. Returns false if the stage is not running, the frame is then left to the caller.
+		bool Push(T item)
+		{
+			T dropped = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mRunning || mStop) return false;
+				if ((mQueue.GetCount() == mDepth) && mQueue.PopFront(dropped)) {
+					mDroppedCount++;
+				}
+				mQueue.PushBack(item);
+			}
+			mFrameAvailable.notify_one();
+			if (dropped != nullptr) mDispose(dropped);
+			return true;
+		}
+
+		/// Frames dropped because the queue was full, and frames handed to the process function.
+		unsigned long long GetDroppedCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mDroppedCount;
+		}
+
+		unsigned long long GetProcessedCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mProcessedCount;
+		}
+
+	private:
+		void WorkerLoop()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			while (!mStop) {
+				T item;
+				if (!mQueue.PopFront(item)) {
+					mFrameAvailable.wait(lock);
+					continue;
+				}
+				mProcessedCount++;
+				lock.unlock();
+				mProcess(item);
+				lock.lock();
+			}
+		}
+
+		RingQueue<T> mQueue;
+		size_t mDepth;
+		DisposeFunc mDispose;
+		ProcessFunc mProcess;
+		std::mutex mMutex;
+		std::condition_variable mFrameAvailable;
+		std::condition_variable mStopped;
+		std::thread mThread;
+		bool mRunning;
+		bool mStop;
+		unsigned long long mDroppedCount;
+		unsigned long long mProcessedCount;
+	};
+}
@@ -0,0 +1,118 @@
+/*
+CapturePacer.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Paces the output of a capture filter: at each tick where a frame is due, only the newest queued frame
+	/// is sent and the older ones are dropped, so that the encoder gets one frame per tick instead of bursts.
+	/// A frame older than the maximum latency is dropped as well. Its age is measured from its camera timestamp,
+	/// the camera clock being mapped to the local clock by the smallest delay seen between them, so that the
+	/// frames delivered late by the camera, in a burst after a stall, are seen as old.
+	/// T is a pointer to a frame.
+	/// </summary>
+	template <class T>
+	class CapturePacer
+	{
+	public:
+		typedef void (*DisposeFunc)(T item);
+
+		CapturePacer(DisposeFunc dispose)
+			: mDispose(dispose), mMaxLatency(DefaultMaxLatency), mHasArrival(false), mOffset(0),
+			mSupersededCount(0), mStaleCount(0)
+		{}
+
+		/// Maximum age of a sent frame in milliseconds.
+		void SetMaxLatency(int ms) { mMaxLatency = (ms > 0) ? ms : 1; }
+		int GetMaxLatency() const { return mMaxLatency; }
+
+		/// Called by the capture thread when a frame arrives, with its 90 kHz camera timestamp and the local time in ms.
+		void OnFrameArrival(uint32_t timestamp, uint64_t now)
+		{
+			int32_t offset = (int32_t)((uint32_t)(now * 90) - timestamp);
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mHasArrival || (offset < mOffset)) {
+				mOffset = offset;
+			} else {
+				// Follow slowly an increase of the delay, that is a drift between the clocks, not the late frames.
+				mOffset += (offset - mOffset < OffsetDrift) ? (offset - mOffset) : OffsetDrift;
+			}
+			mHasArrival = true;
+		}
+
+		/// Called at a tick where a frame is due. pop takes the oldest queued frame, as bool pop(T &item),
+		/// and timestampOf gives its 90 kHz camera timestamp. Returns the frame to send, or nullptr.
+		template <class PopFunc, class TimestampFunc>
+		T Select(PopFunc pop, TimestampFunc timestampOf, uint64_t now)
+		{
+			T newest = nullptr;
+			T item;
+			while (pop(item)) {
+				if (newest != nullptr) {
+					mDispose(newest);
+					mSupersededCount++;
+				}
+				newest = item;
+			}
+			if ((newest != nullptr) && (GetAge(timestampOf(newest), now) > (int64_t)mMaxLatency)) {
+				mDispose(newest);
+				mStaleCount++;
+				newest = nullptr;
+			}
+			return newest;
+		}
+
+		/// Age in ms of a frame with the given 90 kHz camera timestamp.
+		int64_t GetAge(uint32_t timestamp, uint64_t now)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mHasArrival) return 0;
+			// Wrapping difference of the 32 bits timestamps.
+			return (int32_t)((uint32_t)(now * 90) - timestamp - (uint32_t)mOffset) / 90;
+		}
+
+		/// Frames dropped because a newer one was queued, and frames dropped because they were too old.
+		uint64_t GetSupersededCount() const { return mSupersededCount; }
+		uint64_t GetStaleCount() const { return mStaleCount; }
+
+	private:
+		static const int DefaultMaxLatency = 200;
+		static const int32_t OffsetDrift = 90;
+
+		DisposeFunc mDispose;
+		std::atomic<int> mMaxLatency;
+		std::mutex mMutex;
+		bool mHasArrival;
+		int32_t mOffset;
+		std::atomic<uint64_t> mSupersededCount;
+		std::atomic<uint64_t> mStaleCount;
+	};
+}
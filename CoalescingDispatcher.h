@@ -0,0 +1,76 @@
+/*
+CoalescingDispatcher.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Coalesces the requests to drain a queue into at most one pending work item.
+	/// The producer pushes to the queue then calls Schedule(). The work item calls BeginDrain() before taking
+	/// the items out of the queue, so that an item pushed while draining gets a new work item.
+	/// </summary>
+	class CoalescingDispatcher
+	{
+	public:
+		/// post schedules one later run of the drain work item on the executor and returns false on failure.
+		/// It is stored once and called each time a work item is needed.
+		typedef std::function<bool()> PostFunc;
+
+		CoalescingDispatcher(const PostFunc &post) : mPost(post), mPending(false), mPostCount(0), mCoalescedCount(0) {}
+
+		/// Returns false if a work item was needed and could not be posted.
+		bool Schedule()
+		{
+			if (mPending.exchange(true)) {
+				mCoalescedCount++;
+				return true;
+			}
+			if (!mPost()) {
+				mPending = false;
+				return false;
+			}
+			mPostCount++;
+			return true;
+		}
+
+		void BeginDrain() { mPending = false; }
+
+		bool IsPending() const { return mPending; }
+		/// Number of work items posted, and number of requests merged into an already pending work item.
+		uint64_t GetPostCount() const { return mPostCount; }
+		uint64_t GetCoalescedCount() const { return mCoalescedCount; }
+
+	private:
+		PostFunc mPost;
+		std::atomic<bool> mPending;
+		std::atomic<uint64_t> mPostCount;
+		std::atomic<uint64_t> mCoalescedCount;
+	};
+}
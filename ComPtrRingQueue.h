@@ -0,0 +1,85 @@
+/*
+ComPtrRingQueue.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <windows.h>
+
+#include "RingQueue.h"
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// RingQueue of COM pointers with the InsertBack/RemoveFront/Clear semantics of ComPtrList:
+	/// the queue holds a reference on each item, RemoveFront hands this reference over to the caller.
+	/// </summary>
+	template <class T, bool NULLABLE = false>
+	class ComPtrRingQueue
+	{
+	public:
+		ComPtrRingQueue(size_t capacity = DefaultCapacity) : mQueue(capacity) {}
+
+		~ComPtrRingQueue()
+		{
+			Clear();
+		}
+
+		HRESULT InsertBack(T *item)
+		{
+			if ((item == nullptr) && !NULLABLE) return E_POINTER;
+			if (item != nullptr) item->AddRef();
+			if (!mQueue.PushBack(item)) {
+				if (item != nullptr) item->Release();
+				return E_OUTOFMEMORY;
+			}
+			return S_OK;
+		}
+
+		/// ppItem can be nullptr if the item is not wanted, it is then released.
+		HRESULT RemoveFront(T **ppItem)
+		{
+			T *item = nullptr;
+			if (!mQueue.PopFront(item)) return E_FAIL;
+			if (ppItem != nullptr) *ppItem = item;
+			else if (item != nullptr) item->Release();
+			return S_OK;
+		}
+
+		void Clear()
+		{
+			mQueue.Clear([](T *&item) {
+				if (item != nullptr) item->Release();
+			});
+		}
+
+		size_t GetCount() const { return mQueue.GetCount(); }
+		bool IsEmpty() const { return mQueue.IsEmpty(); }
+
+	private:
+		// Enough for the samples and markers usually waiting in a stream sink.
+		static const size_t DefaultCapacity = 8;
+
+		RingQueue<T *> mQueue;
+	};
+}
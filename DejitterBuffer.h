@@ -0,0 +1,226 @@
+/*
+DejitterBuffer.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Holds the frames of a display filter in their timestamp order and releases them on the cadence of their
+	/// 90 kHz timestamps instead of the bursts they arrive in. The timestamps are mapped to the local clock by
+	/// the smallest transit delay seen, a frame being released half the latency budget after the time it would
+	/// have arrived without delay. A frame that cannot be released within the whole latency budget is dropped,
+	/// as is the oldest frame when the buffer is full. After a few late frames in a row, the delay of the stream
+	/// is considered to have grown and the mapping restarts from the last one.
+	/// Used by the ticker thread only, the configuration and the counters can be accessed from any thread.
+	/// T is a pointer to a frame, times are in ms.
+	/// </summary>
+	template <class T>
+	class DejitterBuffer
+	{
+	public:
+		typedef void (*DisposeFunc)(T item);
+
+		DejitterBuffer(size_t capacity, DisposeFunc dispose)
+			: mCapacity(capacity), mDispose(dispose), mBudget(DefaultLatencyBudget), mReleasedCount(0), mLateCount(0),
+			mOverflowCount(0), mResyncCount(0)
+		{
+			mEntries.reserve(capacity);
+			Reset();
+		}
+
+		~DejitterBuffer()
+		{
+			Clear();
+		}
+
+		/// Maximum delay of a frame behind the time it would have arrived without network delay.
+		void SetLatencyBudget(int ms) { mBudget = (ms >= 2) ? ms : 2; }
+		int GetLatencyBudget() const { return mBudget; }
+
+		/// Queue a frame with its 90 kHz timestamp, arrived at the local time now. The frame is disposed if
+		/// it is already too late.
+		void Push(T item, uint32_t timestamp, uint64_t now)
+		{
+			int64_t extended = Unwrap(timestamp);
+			int64_t transit = (int64_t)now * 90 - extended;
+			if (!mHasOffset || (transit < mOffset)) {
+				mOffset = transit;
+				mHasOffset = true;
+			} else if ((transit - mOffset) > MaxDeviation) {
+				// The timestamps went backwards or the stream was paused: new timeline.
+				Resync(transit);
+			} else {
+				// Follow slowly an increase of the delay, that is a drift between the clocks, not the late frames.
+				mOffset += ((transit - mOffset) < OffsetDrift) ? (transit - mOffset) : OffsetDrift;
+			}
+
+			if (mHasReleased && (extended <= mLastReleased)) {
+				// Older than a frame already rendered.
+				DropLate(item);
+				return;
+			}
+			if ((int64_t)now > GetBaseTime(extended) + mBudget) {
+				if (++mConsecutiveLateCount <= MaxConsecutiveLate) {
+					DropLate(item);
+					return;
+				}
+				Resync(transit);
+			}
+			mConsecutiveLateCount = 0;
+
+			if (mEntries.size() == mCapacity) {
+				mDispose(mEntries.front().Item);
+				mEntries.erase(mEntries.begin());
+				mOverflowCount++;
+			}
+			typename std::vector<Entry>::iterator it = mEntries.end();
+			while ((it != mEntries.begin()) && ((it - 1)->Timestamp > extended)) --it;
+			Entry entry = { item, extended };
+			mEntries.insert(it, entry);
+		}
+
+		/// Called at each tick: returns the frame to render, or nullptr if none is due yet.
+		T Pop(uint64_t now)
+		{
+			while (!mEntries.empty()) {
+				Entry entry = mEntries.front();
+				int64_t base = GetBaseTime(entry.Timestamp);
+				if ((int64_t)now < base + mBudget / 2) return nullptr;
+				mEntries.erase(mEntries.begin());
+				if ((int64_t)now > base + mBudget) {
+					DropLate(entry.Item);
+					continue;
+				}
+				mLastReleased = entry.Timestamp;
+				mHasReleased = true;
+				mReleasedCount++;
+				return entry.Item;
+			}
+			return nullptr;
+		}
+
+		/// Dispose the queued frames and restart the mapping from the next frame.
+		void Clear()
+		{
+			for (typename std::vector<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it) {
+				mDispose(it->Item);
+			}
+			mEntries.clear();
+			Reset();
+		}
+
+		size_t GetCount() const { return mEntries.size(); }
+
+		/// Frames rendered, frames dropped because they exceeded the latency budget, frames dropped because
+		/// the buffer was full, and restarts of the mapping.
+		uint64_t GetReleasedCount() const { return mReleasedCount; }
+		uint64_t GetLateCount() const { return mLateCount; }
+		uint64_t GetOverflowCount() const { return mOverflowCount; }
+		uint64_t GetResyncCount() const { return mResyncCount; }
+
+	private:
+		struct Entry
+		{
+			T Item;
+			int64_t Timestamp;
+		};
+
+		static const int DefaultLatencyBudget = 100;
+		// Rise of the offset per frame arriving late, 11 us: follows a drift of 330 ppm at 30 fps.
+		static const int64_t OffsetDrift = 1;
+		static const int64_t MaxDeviation = 2 * 90000;
+		static const int MaxConsecutiveLate = 2;
+
+		void Reset()
+		{
+			mHasTimestamp = false;
+			mHasOffset = false;
+			mHasReleased = false;
+			mConsecutiveLateCount = 0;
+		}
+
+		void Resync(int64_t transit)
+		{
+			mOffset = transit;
+			mHasReleased = false;
+			mConsecutiveLateCount = 0;
+			mResyncCount++;
+		}
+
+		void DropLate(T item)
+		{
+			mDispose(item);
+			mLateCount++;
+		}
+
+		int64_t Unwrap(uint32_t timestamp)
+		{
+			if (!mHasTimestamp) {
+				mLastTimestamp = timestamp;
+				mExtendedTimestamp = timestamp;
+				mHasTimestamp = true;
+				return mExtendedTimestamp;
+			}
+			int32_t delta = (int32_t)(timestamp - mLastTimestamp);
+			if (delta < 0) {
+				// Reordered frame, the reference stays on the newest one.
+				return mExtendedTimestamp + delta;
+			}
+			mLastTimestamp = timestamp;
+			mExtendedTimestamp += delta;
+			return mExtendedTimestamp;
+		}
+
+		/// Local time the frame would have arrived at without network delay.
+		int64_t GetBaseTime(int64_t extended) const
+		{
+			int64_t local = extended + mOffset;
+			return (local >= 0) ? (local / 90) : -((-local + 89) / 90);
+		}
+
+		size_t mCapacity;
+		DisposeFunc mDispose;
+		std::atomic<int> mBudget;
+		std::vector<Entry> mEntries;
+		bool mHasTimestamp;
+		uint32_t mLastTimestamp;
+		int64_t mExtendedTimestamp;
+		bool mHasOffset;
+		int64_t mOffset;
+		bool mHasReleased;
+		int64_t mLastReleased;
+		int mConsecutiveLateCount;
+		std::atomic<uint64_t> mReleasedCount;
+		std::atomic<uint64_t> mLateCount;
+		std::atomic<uint64_t> mOverflowCount;
+		std::atomic<uint64_t> mResyncCount;
+	};
+}
@@ -0,0 +1,90 @@
+/*
+FrameAdmission.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include "FrameAdmission.h"
+
+using namespace libmswinrtvid;
+
+
+FrameAdmission::FrameAdmission()
+	: mRate(0), mResetRequested(false), mScheduleRate(0), mInterval(0), mIntervalRemainder(0), mNextDue(0),
+	mNextDueRemainder(0), mLastTimestamp(0), mStarted(false), mAdmittedCount(0), mSkippedCount(0)
+{
+}
+
+void FrameAdmission::SetFrameRate(FrameRate rate)
+{
+	mRate = rate.IsValid() ? (((uint64_t)rate.Numerator << 32) | rate.Denominator) : 0;
+}
+
+FrameRate FrameAdmission::GetFrameRate() const
+{
+	uint64_t rate = mRate;
+	return FrameRate::FromFraction((uint32_t)(rate >> 32), (uint32_t)rate);
+}
+
+void FrameAdmission::Reset()
+{
+	mResetRequested = true;
+}
+
+bool FrameAdmission::Admit(int64_t timestamp)
+{
+	uint64_t rate = mRate;
+	if (mResetRequested.exchange(false) || (rate != mScheduleRate) || (timestamp < mLastTimestamp)) {
+		// New rate, new capture or a camera clock going backwards: restart the schedule with this frame.
+		mStarted = false;
+		mScheduleRate = rate;
+		int64_t numerator = (int64_t)(rate >> 32);
+		int64_t period = TimestampRate * (int64_t)(uint32_t)rate;
+		mInterval = (numerator > 0) ? (period / numerator) : 0;
+		mIntervalRemainder = (numerator > 0) ? (period % numerator) : 0;
+	}
+	mLastTimestamp = timestamp;
+
+	int64_t interval = mInterval;
+	if (interval <= 0) {
+		mAdmittedCount++;
+		return true;
+	}
+	if (mStarted && (timestamp < (mNextDue - ((interval * 3) / 8)))) {
+		mSkippedCount++;
+		return false;
+	}
+	if (!mStarted || (timestamp >= (mNextDue + (2 * interval)))) {
+		// First frame, or the camera has not delivered during two whole intervals: do not try to catch up. A shorter
+		// delay, as between the bursts of a camera delivering several frames at once, keeps the grid so that the
+		// frame still owed is taken from the burst.
+		mNextDue = timestamp;
+		mNextDueRemainder = 0;
+		mStarted = true;
+	}
+	mNextDue += interval;
+	mNextDueRemainder += mIntervalRemainder;
+	if (mNextDueRemainder >= (int64_t)(mScheduleRate >> 32)) {
+		mNextDueRemainder -= (int64_t)(mScheduleRate >> 32);
+		mNextDue++;
+	}
+	mAdmittedCount++;
+	return true;
+}
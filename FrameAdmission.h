@@ -0,0 +1,78 @@
+/*
+FrameAdmission.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "FrameRate.h"
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Decides which camera frames to keep to reach the target frame rate, from their camera timestamps only,
+	/// so that the frames in excess are dropped before any pixel work. Admissions are scheduled on a regular
+	/// grid of the target interval, which keeps the average rate exact whatever the camera rate, and a frame
+	/// is admitted up to 3/8 of an interval early to absorb the jitter of the timestamps. At most one frame
+	/// missed on the grid is made up for, so that bursts keep the rate but a pause is not followed by a burst.
+	/// The grid follows the fractional part of the interval, so that a rate like 30000/1001 does not drift either.
+	/// </summary>
+	class FrameAdmission
+	{
+	public:
+		FrameAdmission();
+
+		/// Target frame rate, the frames are all admitted when it is 0. It can be changed while frames are admitted.
+		void SetFrameRate(FrameRate rate);
+		FrameRate GetFrameRate() const;
+
+		/// Restart the schedule from the next frame, eg. when the capture restarts.
+		void Reset();
+
+		/// Called for each camera frame with its timestamp in 100 ns units. Returns whether the frame is kept.
+		bool Admit(int64_t timestamp);
+
+		uint64_t GetAdmittedCount() const { return mAdmittedCount; }
+		uint64_t GetSkippedCount() const { return mSkippedCount; }
+
+	private:
+		static const int64_t TimestampRate = 10000000;
+
+		// Numerator in the high 32 bits and denominator in the low ones, so that both change at once.
+		std::atomic<uint64_t> mRate;
+		std::atomic<bool> mResetRequested;
+		uint64_t mScheduleRate;
+		// Whole and fractional parts, in 1 / Numerator units, of the interval and of the next due time.
+		int64_t mInterval;
+		int64_t mIntervalRemainder;
+		int64_t mNextDue;
+		int64_t mNextDueRemainder;
+		int64_t mLastTimestamp;
+		bool mStarted;
+		std::atomic<uint64_t> mAdmittedCount;
+		std::atomic<uint64_t> mSkippedCount;
+	};
+}
@@ -0,0 +1,87 @@
+/*
+FrameBufferPool.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "FrameBufferPool.h"
+
+#include <mediastreamer2/mscommon.h>
+
+using namespace libmswinrtvid;
+
+
+FrameBufferPool::FrameBufferPool(size_t maxFreeBuffers)
+	: mMaxFreeBuffers(maxFreeBuffers), mSize(0), mAllocationCount(0)
+{
+	// Reserved once so that keeping a buffer never allocates.
+	mFreeBuffers.reserve(maxFreeBuffers);
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+	FreeBuffers();
+}
+
+uint8_t * FrameBufferPool::Get(size_t size)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (size != mSize) {
+		FreeBuffers();
+		mSize = size;
+	}
+	if (!mFreeBuffers.empty()) {
+		uint8_t *buffer = mFreeBuffers.back();
+		mFreeBuffers.pop_back();
+		return buffer;
+	}
+	mAllocationCount++;
+	return (uint8_t *)ms_malloc(size);
+}
+
+void FrameBufferPool::Release(uint8_t *buffer, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if ((size == mSize) && (mFreeBuffers.size() < mMaxFreeBuffers)) {
+		mFreeBuffers.push_back(buffer);
+	} else {
+		ms_free(buffer);
+	}
+}
+
+void FrameBufferPool::Reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	FreeBuffers();
+	mSize = 0;
+}
+
+unsigned int FrameBufferPool::GetAllocationCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mAllocationCount;
+}
+
+void FrameBufferPool::FreeBuffers()
+{
+	for (size_t i = 0; i < mFreeBuffers.size(); i++) {
+		ms_free(mFreeBuffers[i]);
+	}
+	mFreeBuffers.clear();
+}
@@ -0,0 +1,68 @@
+/*
+FrameBufferPool.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Thread-safe pool recycling the frame buffers handed to the MediaElement, so that displaying a frame does not
+	/// allocate and free a whole picture. All the buffers of the pool have the same size; asking for another size
+	/// resets the pool. It is shared with the buffers in use so that they can be returned after the display is gone.
+	/// </summary>
+	class FrameBufferPool
+	{
+	public:
+		FrameBufferPool(size_t maxFreeBuffers);
+		~FrameBufferPool();
+
+		/// Get a buffer of size bytes, reusing a returned one if possible.
+		uint8_t * Get(size_t size);
+
+		/// Give back a buffer obtained with Get. It is freed if the pool has been reset since or if enough buffers are kept.
+		void Release(uint8_t *buffer, size_t size);
+
+		/// Free the kept buffers and forget the current size, eg. on a resolution change.
+		void Reset();
+
+		/// Number of buffers allocated since the pool creation, for statistics purpose.
+		unsigned int GetAllocationCount();
+
+	private:
+		void FreeBuffers();
+
+		std::mutex mMutex;
+		std::vector<uint8_t *> mFreeBuffers;
+		size_t mMaxFreeBuffers;
+		size_t mSize;
+		unsigned int mAllocationCount;
+	};
+}
@@ -0,0 +1,126 @@
+/*
+FrameRate.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "FrameRate.h"
+
+#include <math.h>
+
+using namespace libmswinrtvid;
+
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b != 0) {
+		uint32_t r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+FrameRate FrameRate::FromFraction(uint32_t numerator, uint32_t denominator)
+{
+	FrameRate rate = { 0, 1 };
+	if ((numerator == 0) || (denominator == 0)) return rate;
+	uint32_t divisor = gcd(numerator, denominator);
+	rate.Numerator = numerator / divisor;
+	rate.Denominator = denominator / divisor;
+	return rate;
+}
+
+FrameRate FrameRate::FromFloat(float fps)
+{
+	if (!(fps > 0.f) || (fps > 1000.f)) return FromFraction(0, 1);
+	double value = fps;
+	// NTSC rates, eg. 29.97 for 30000/1001, 23.976 for 24000/1001 or 59.94 for 60000/1001.
+	double ntsc = value * 1.001;
+	double integer = floor(ntsc + 0.5);
+	if ((integer >= 1.) && (fabs(ntsc - integer) < 0.002) && (fabs(value - integer) > 0.002)) {
+		return FromFraction((uint32_t)integer * 1000, 1001);
+	}
+	return FromFraction((uint32_t)floor(value * 1000. + 0.5), 1000);
+}
+
+
+FrameRateController::FrameRateController()
+	: mStarted(false), mStartTime(0), mFrameCount(0)
+{
+	mRate = FrameRate::FromFraction(0, 1);
+}
+
+void FrameRateController::Init(FrameRate rate)
+{
+	mRate = rate;
+	mStarted = false;
+}
+
+bool FrameRateController::IsFrameDue(uint64_t now)
+{
+	if (!mRate.IsValid()) return false;
+	if (!mStarted || (now < mStartTime)) {
+		mStartTime = now;
+		mFrameCount = 0;
+		mStarted = true;
+	}
+	// Number of frames due since the start: elapsed * Numerator / (Denominator * 1000).
+	uint64_t due = ((now - mStartTime) * mRate.Numerator) / ((uint64_t)mRate.Denominator * 1000) + 1;
+	if (due > mFrameCount + 1) {
+		// Due times without a frame to send: only the last one is used.
+		mFrameCount = due - 1;
+	}
+	if (due > mFrameCount) {
+		mFrameCount++;
+		return true;
+	}
+	return false;
+}
+
+
+FrameRateMeter::FrameRateMeter()
+{
+	Reset();
+}
+
+void FrameRateMeter::Reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mNext = 0;
+	mCount = 0;
+}
+
+void FrameRateMeter::Update(uint64_t now)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mTimes[mNext] = now;
+	mNext = (mNext + 1) % WindowSize;
+	if (mCount < WindowSize) mCount++;
+}
+
+float FrameRateMeter::Get() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mCount < 2) return 0.f;
+	uint64_t newest = mTimes[(mNext + WindowSize - 1) % WindowSize];
+	uint64_t oldest = mTimes[(mNext + WindowSize - mCount) % WindowSize];
+	if (newest <= oldest) return 0.f;
+	return (float)((double)(mCount - 1) * 1000. / (double)(newest - oldest));
+}
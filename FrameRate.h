@@ -0,0 +1,104 @@
+/*
+FrameRate.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// A frame rate as a fraction, so that the rates like 7.5 fps (15/2) or 29.97 fps (30000/1001) are exact.
+	/// </summary>
+	struct FrameRate
+	{
+		uint32_t Numerator;
+		uint32_t Denominator;
+
+		/// The closest fraction to a rate given as a float: the NTSC rates are recognized, the other ones are
+		/// rounded to the ms. A rate that is not positive gives an invalid frame rate.
+		static FrameRate FromFloat(float fps);
+		static FrameRate FromFraction(uint32_t numerator, uint32_t denominator);
+
+		bool IsValid() const { return (Numerator > 0) && (Denominator > 0); }
+		float ToFloat() const { return IsValid() ? (float)((double)Numerator / (double)Denominator) : 0.f; }
+		bool operator==(const FrameRate &other) const
+		{
+			return ((uint64_t)Numerator * other.Denominator) == ((uint64_t)other.Numerator * Denominator);
+		}
+		bool operator!=(const FrameRate &other) const { return !(*this == other); }
+	};
+
+	/// <summary>
+	/// Decides at which ticks a frame is sent to reach a frame rate exactly: frame n is due at the start time
+	/// plus n / rate, computed in integers so that the schedule does not drift however long it runs.
+	/// It is only asked when a frame is ready, so that a frame arriving a little after its due time is sent
+	/// at the next tick instead of waiting for the next due time with the following frame. The due times
+	/// passed without a frame are not caught up on. Times are in ms.
+	/// </summary>
+	class FrameRateController
+	{
+	public:
+		FrameRateController();
+
+		/// Restart the schedule from the next tick with the given rate.
+		void Init(FrameRate rate);
+
+		/// Called at a tick where a frame is ready: returns whether it is due.
+		bool IsFrameDue(uint64_t now);
+
+	private:
+		FrameRate mRate;
+		bool mStarted;
+		uint64_t mStartTime;
+		uint64_t mFrameCount;
+	};
+
+	/// <summary>
+	/// Measures the average rate of the frames sent, over the last frames so that the 10 ms resolution of the
+	/// ticker times does not bias a rate like 29.97 fps. Updated by the ticker thread, it can be read and reset
+	/// from any thread. Times are in ms.
+	/// </summary>
+	class FrameRateMeter
+	{
+	public:
+		FrameRateMeter();
+
+		void Reset();
+		void Update(uint64_t now);
+
+		/// Average rate in frames per second, 0 until two frames have been sent.
+		float Get() const;
+
+	private:
+		static const int WindowSize = 128;
+
+		mutable std::mutex mMutex;
+		uint64_t mTimes[WindowSize];
+		int mNext;
+		int mCount;
+	};
+}
@@ -0,0 +1,112 @@
+/*
+LatestFrameMailbox.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "PendingRequestRing.h"
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Hands the newest frame of a producer over to the sample requests of a consumer.
+	/// The frame slot is a single atomic pointer: posting a frame replaces the one that has not been taken yet,
+	/// and taking it empties the slot, neither of them ever waits. The requests that find the slot empty are
+	/// deferred, and paired with the next frame by whichever side comes last, so that a frame posted while a
+	/// request is being deferred is not left waiting: both sides call Match after their update.
+	/// Only the deferred requests are guarded by a mutex, held for O(1) operations; the frames are rendered
+	/// outside of it. The mailbox owns the frame in the slot.
+	/// </summary>
+	template <class F, class R>
+	class LatestFrameMailbox
+	{
+	public:
+		LatestFrameMailbox(size_t maxPendingRequests) : mFrame(nullptr), mRequests(maxPendingRequests), mReplacedCount(0) {}
+
+		~LatestFrameMailbox()
+		{
+			delete Take();
+		}
+
+		/// Producer: put the newest frame in the slot. Returns the frame it replaces, that the caller must dispose.
+		F * Post(F *frame)
+		{
+			F *replaced = mFrame.exchange(frame);
+			if (replaced != nullptr) mReplacedCount++;
+			return replaced;
+		}
+
+		/// Consumer: take the frame in the slot, if any. The caller owns the frame.
+		F * Take()
+		{
+			return mFrame.exchange(nullptr);
+		}
+
+		/// Consumer: defer a request that found the slot empty. Returns true if too many requests were pending,
+		/// the oldest one being then moved to evicted.
+		bool Defer(const R &request, R &evicted)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mRequests.Push(request, evicted);
+		}
+
+		/// Both sides: pair the oldest deferred request with the frame in the slot. Returns false if one of them is missing.
+		bool Match(R &request, F *&frame)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mRequests.IsEmpty()) return false;
+			frame = Take();
+			if (frame == nullptr) return false;
+			mRequests.Pop(request);
+			return true;
+		}
+
+		/// Remove all the deferred requests, calling clearFn on each of them, and dispose the frame in the slot.
+		/// clearFn is called without the mutex held, so that completing a request may raise a new one.
+		template <class FN>
+		void Clear(FN clearFn)
+		{
+			R request;
+			while (PopRequest(request)) clearFn(request);
+			delete Take();
+		}
+
+		/// Frames replaced by a newer one before being taken.
+		unsigned long long GetReplacedCount() const { return mReplacedCount; }
+
+	private:
+		bool PopRequest(R &request)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mRequests.Pop(request);
+		}
+
+		std::atomic<F *> mFrame;
+		std::mutex mMutex;
+		PendingRequestRing<R> mRequests;
+		std::atomic<unsigned long long> mReplacedCount;
+	};
+}
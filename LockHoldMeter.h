@@ -0,0 +1,80 @@
+/*
+LockHoldMeter.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+#pragma once
+
+#include <stdint.h>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Statistics of the time a lock is held, or waited for, in ticks of a performance counter.
+	/// The meter is not synchronized, it is updated and read under the lock it measures.
+	/// </summary>
+	class LockHoldMeter
+	{
+	public:
+		LockHoldMeter() : mFrequency(1), mCount(0), mTotalTicks(0), mMaxTicks(0) {}
+
+		/// frequency is the number of ticks per second.
+		void SetFrequency(int64_t frequency)
+		{
+			mFrequency = (frequency > 0) ? frequency : 1;
+		}
+
+		void Record(int64_t ticks)
+		{
+			if (ticks < 0) ticks = 0;
+			mCount++;
+			mTotalTicks += ticks;
+			if (ticks > mMaxTicks) mMaxTicks = ticks;
+		}
+
+		void Reset()
+		{
+			mCount = 0;
+			mTotalTicks = 0;
+			mMaxTicks = 0;
+		}
+
+		unsigned int GetCount() const { return mCount; }
+
+		double GetAverageUs() const
+		{
+			return (mCount > 0) ? ((double)mTotalTicks * 1000000.0) / ((double)mFrequency * mCount) : 0.0;
+		}
+
+		double GetMaxUs() const
+		{
+			return ((double)mMaxTicks * 1000000.0) / (double)mFrequency;
+		}
+
+	private:
+		int64_t mFrequency;
+		unsigned int mCount;
+		int64_t mTotalTicks;
+		int64_t mMaxTicks;
+	};
+}
@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
 #include "MediaStreamSource.h"
+#include "VideoBuffer.h"
+#include "YuvConverter.h"
 #include <mfapi.h>
 #include <wrl.h>
 #include <robuffer.h>
@@ -32,19 +34,53 @@ using namespace Windows::Media::MediaProperties;
 using Microsoft::WRL::ComPtr;
 
 
+// Sample attribute holding the generation of the pool the sample has been acquired from.
+// {9E0A5C7B-3F64-4D2A-B1C8-57E2D4A06F13}
+static const GUID SamplePoolGenerationKey = { 0x9e0a5c7b, 0x3f64, 0x4d2a, { 0xb1, 0xc8, 0x57, 0xe2, 0xd4, 0xa0, 0x6f, 0x13 } };
+
+// Called by a tracked sample once the media engine has released it, to put it back in the pool.
+class SampleAllocatorCallback : public Microsoft::WRL::RuntimeClass<Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>, IMFAsyncCallback>
+{
+public:
+	SampleAllocatorCallback(std::shared_ptr<libmswinrtvid::MFSamplePool> pool) : mPool(pool) {}
+
+	STDMETHODIMP GetParameters(DWORD *pdwFlags, DWORD *pdwQueue)
+	{
+		return E_NOTIMPL;
+	}
+
+	STDMETHODIMP Invoke(IMFAsyncResult *pAsyncResult)
+	{
+		ComPtr<IUnknown> object;
+		ComPtr<IMFSample> sample;
+		UINT32 generation;
+		if (SUCCEEDED(pAsyncResult->GetObject(object.GetAddressOf())) && SUCCEEDED(object.As(&sample))
+			&& SUCCEEDED(sample->GetUINT32(SamplePoolGenerationKey, &generation))) {
+			mPool->Recycle(sample, generation);
+		}
+		return S_OK;
+	}
+
+private:
+	std::shared_ptr<libmswinrtvid::MFSamplePool> mPool;
+};
+
+
 libmswinrtvid::MediaStreamSource::MediaStreamSource()
-	: mMediaStreamSource(nullptr), mTimeStamp(0LL), mInitialTimeStamp(0LL)
+	: mMediaStreamSource(nullptr), mMailbox(MaxPendingRequests), mLastArrival(0), mLastBuffer(nullptr), mLastWidth(0), mLastHeight(0)
 {
-	mDeferralQueue = ref new Platform::Collections::Vector<SampleRequestDeferral^>();
+	mSamplePool = std::make_shared<MFSamplePool>(SamplePoolSize);
+	mSampleAllocator = Microsoft::WRL::Make<SampleAllocatorCallback>(mSamplePool);
 }
 
 libmswinrtvid::MediaStreamSource::~MediaStreamSource()
 {
 }
 
-libmswinrtvid::MediaStreamSource^ libmswinrtvid::MediaStreamSource::CreateMediaSource()
+libmswinrtvid::MediaStreamSource^ libmswinrtvid::MediaStreamSource::CreateMediaSource(const std::shared_ptr<RenderAheadEstimator> &renderAhead)
 {
 	libmswinrtvid::MediaStreamSource^ streamState = ref new libmswinrtvid::MediaStreamSource();
+	streamState->mRenderAhead = renderAhead;
 	VideoEncodingProperties^ videoProperties = VideoEncodingProperties::CreateUncompressed(MediaEncodingSubtypes::Nv12, 40, 40);
 	streamState->mVideoDesc = ref new VideoStreamDescriptor(videoProperties);
 	streamState->mVideoDesc->EncodingProperties->Width = 40;
@@ -63,87 +99,190 @@ void libmswinrtvid::MediaStreamSource::OnSampleRequested(Windows::Media::Core::M
 	if (request == nullptr) {
 		return;
 	}
-	mMutex.lock();
-	if (mSample == nullptr) {
-		mDeferralQueue->Append(ref new SampleRequestDeferral(request, request->GetDeferral()));
+	Sample *sample = mMailbox.Take();
+	if (sample != nullptr) {
+		AnswerSampleRequest(request, sample);
 	} else {
-		AnswerSampleRequest(request);
+		DeferSampleRequest(request);
+		// A frame may have been fed while the request was being deferred.
+		AnswerPendingRequests();
 	}
-	mMutex.unlock();
 }
 
-void libmswinrtvid::MediaStreamSource::Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height)
+void libmswinrtvid::MediaStreamSource::Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height, int64 timestamp)
 {
-	mMutex.lock();
-	mSample = ref new Sample(pBuffer, width, height);
-	if (mDeferralQueue->Size > 0) {
-		SampleRequestDeferral^ deferral = mDeferralQueue->GetAt(0);
-		mDeferralQueue->RemoveAt(0);
-		AnswerSampleRequest(deferral->Request);
-		deferral->Deferral->Complete();
+	// The frame not taken yet is replaced, only the newest one is worth rendering.
+	delete mMailbox.Post(new Sample(pBuffer, width, height, timestamp, MonotonicClock::Now()));
+	AnswerPendingRequests();
+}
+
+void libmswinrtvid::MediaStreamSource::AnswerPendingRequests()
+{
+	SampleRequestDeferral deferral;
+	Sample *sample;
+	while (mMailbox.Match(deferral, sample)) {
+		AnswerSampleRequest(deferral.Request, sample);
+		deferral.Deferral->Complete();
 	}
-	mMutex.unlock();
+}
+
+void libmswinrtvid::MediaStreamSource::DeferSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ request)
+{
+	SampleRequestDeferral deferral = { request, request->GetDeferral() };
+	SampleRequestDeferral evicted;
+	if (mMailbox.Defer(deferral, evicted)) {
+		// Completing the request without a sample would end the stream, repeat the last frame instead.
+		ms_warning("MediaStreamSource::DeferSampleRequest: %u requests pending, answering the oldest one with the last frame", (unsigned int)MaxPendingRequests);
+		AnswerSampleRequest(evicted.Request, CreateRepeatedSample());
+		evicted.Deferral->Complete();
+	}
+}
+
+libmswinrtvid::Sample * libmswinrtvid::MediaStreamSource::CreateRepeatedSample()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mLastBuffer != nullptr) {
+		return new Sample(mLastBuffer, mLastWidth, mLastHeight, -1, MonotonicClock::Now());
+	}
+	// No frame has been answered yet.
+	int width = (int)mVideoDesc->EncodingProperties->Width;
+	int height = (int)mVideoDesc->EncodingProperties->Height;
+	return new Sample(VideoBuffer::CreateBlackFrame(width, height), width, height, -1, MonotonicClock::Now());
 }
 
 void libmswinrtvid::MediaStreamSource::Stop()
 {
 	mMediaStreamSource = nullptr;
 	mVideoDesc = nullptr;
-	mDeferralQueue = nullptr;
+	mMailbox.Clear([](SampleRequestDeferral &deferral) {
+		deferral.Deferral->Complete();
+	});
+	ms_message("MediaStreamSource::Stop: %llu frames replaced before being rendered", mMailbox.GetReplacedCount());
+	mMutex.lock();
+	if (mTimeline.GetResyncCount() > 0) {
+		ms_message("MediaStreamSource::Stop: frame timeline resynchronized %u times", mTimeline.GetResyncCount());
+	}
+	mTimeline.Reset();
+	mLastArrival = 0;
+	mLastBuffer = nullptr;
+	ms_message("MediaStreamSource::Stop: rendering %d ms ahead", mRenderAhead->GetRenderAheadMs());
+	mRenderAhead->Reset();
+	mMutex.unlock();
+	mSamplePool->Reset();
 }
 
-void libmswinrtvid::MediaStreamSource::AnswerSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest)
+void libmswinrtvid::MediaStreamSource::AnswerSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest, Sample *sample)
 {
+	std::unique_ptr<Sample> owner(sample);
 	ComPtr<IMFMediaStreamSourceSampleRequest> spRequest;
 	HRESULT hr = reinterpret_cast<IInspectable*>(sampleRequest)->QueryInterface(spRequest.ReleaseAndGetAddressOf());
 	if (FAILED(hr)) {
 		ms_error("MediaStreamSource::AnswerSampleRequest: QueryInterface failed %x", hr);
 		return;
 	}
-	ComPtr<IMFSample> spSample;
-	hr = MFCreateSample(spSample.GetAddressOf());
-	if (FAILED(hr)) {
-		ms_error("MediaStreamSource::AnswerSampleRequest: MFCreateSample failed %x", hr);
-		return;
-	}
-	LONGLONG timeStamp = GetTickCount64();
-	if (mInitialTimeStamp == 0) {
-		mInitialTimeStamp = timeStamp;
-	}
 	LONGLONG duration;
-	if (mTimeStamp == 0LL)
-	{
-		duration = (LONGLONG)((1.0 / 30.0) * 1000 * 1000 * 10);
+	LONGLONG sampleTime;
+	mMutex.lock();
+	if ((mVideoDesc->EncodingProperties->Width != sample->Width) || (mVideoDesc->EncodingProperties->Height != sample->Height)) {
+		mVideoDesc->EncodingProperties->Width = sample->Width;
+		mVideoDesc->EncodingProperties->Height = sample->Height;
 	}
-	else
-	{
-		duration = (timeStamp - mTimeStamp) * 10000LL;
+	int64_t jitter;
+	if (sample->Timestamp >= 0) {
+		// Present the frame on the cadence of its timestamps, mapped to the local clock.
+		int64_t presentation = mTimeline.Map((uint32_t)sample->Timestamp, sample->Arrival);
+		mSampleClock.Stamp(presentation, sampleTime, duration);
+		jitter = sample->Arrival - presentation;
+	} else {
+		mSampleClock.Stamp(sample->Arrival, sampleTime, duration);
+		jitter = (mLastArrival > 0) ? (sample->Arrival - mLastArrival - duration) : 0;
+		if (jitter < 0) jitter = -jitter;
 	}
-	mTimeStamp = timeStamp;
-	spSample->SetSampleDuration(duration);
-	// Set frame 40ms into the future
-	LONGLONG sampleTime = (mTimeStamp - mInitialTimeStamp + 40LL) * 10000LL;
-	spSample->SetSampleTime(sampleTime);
+	mLastArrival = sample->Arrival;
+	mLastBuffer = sample->Buffer;
+	mLastWidth = sample->Width;
+	mLastHeight = sample->Height;
+	// Set the frame far enough into the future for the late frames to be rendered in time.
+	sampleTime += mRenderAhead->Update(jitter);
+	mMutex.unlock();
+
+	// The copy is done without any lock held, the ticker thread can feed the next frame meanwhile.
+	ComPtr<IMFSample> spSample;
 	ComPtr<IMFMediaBuffer> mediaBuffer;
-	if ((mVideoDesc->EncodingProperties->Width != mSample->Width) || (mVideoDesc->EncodingProperties->Height != mSample->Height)) {
-		mVideoDesc->EncodingProperties->Width = mSample->Width;
-		mVideoDesc->EncodingProperties->Height = mSample->Height;
-	}
-	hr = MFCreate2DMediaBuffer(mVideoDesc->EncodingProperties->Width, mVideoDesc->EncodingProperties->Height, 0x3231564E /* NV12 */, FALSE, mediaBuffer.GetAddressOf());
+	hr = AcquireSample((UINT32)sample->Width, (UINT32)sample->Height, spSample.GetAddressOf(), mediaBuffer.GetAddressOf());
 	if (FAILED(hr)) {
-		ms_error("MediaStreamSource::AnswerSampleRequest: MFCreate2DMediaBuffer failed %x", hr);
 		return;
 	}
-	spSample->AddBuffer(mediaBuffer.Get());
-	RenderFrame(mediaBuffer.Get());
+	spSample->SetSampleDuration(duration);
+	spSample->SetSampleTime(sampleTime);
+	RenderFrame(mediaBuffer.Get(), sample);
 	hr = spRequest->SetSample(spSample.Get());
 	if (FAILED(hr)) {
 		ms_error("MediaStreamSource::AnswerSampleRequest: SetSample failed %x", hr);
 	}
-	mSample = nullptr;
 }
 
-void libmswinrtvid::MediaStreamSource::RenderFrame(IMFMediaBuffer* mediaBuffer)
+HRESULT libmswinrtvid::MediaStreamSource::AcquireSample(UINT32 width, UINT32 height, IMFSample **ppSample, IMFMediaBuffer **ppMediaBuffer)
+{
+	ComPtr<IMFSample> spSample;
+	unsigned int generation;
+	HRESULT hr = S_OK;
+	bool pooled = mSamplePool->Acquire((int)width, (int)height, spSample, generation, [&](ComPtr<IMFSample> &created) -> bool {
+		ComPtr<IMFTrackedSample> trackedSample;
+		ComPtr<IMFMediaBuffer> mediaBuffer;
+		hr = MFCreateTrackedSample(trackedSample.GetAddressOf());
+		if (FAILED(hr)) {
+			ms_error("MediaStreamSource::AcquireSample: MFCreateTrackedSample failed %x", hr);
+			return false;
+		}
+		hr = MFCreate2DMediaBuffer(width, height, 0x3231564E /* NV12 */, FALSE, mediaBuffer.GetAddressOf());
+		if (FAILED(hr)) {
+			ms_error("MediaStreamSource::AcquireSample: MFCreate2DMediaBuffer failed %x", hr);
+			return false;
+		}
+		hr = trackedSample.As(&created);
+		if (SUCCEEDED(hr)) hr = created->AddBuffer(mediaBuffer.Get());
+		return SUCCEEDED(hr);
+	});
+	if (pooled) {
+		// The allocator is cleared each time the sample is handed back, so set it again before every use.
+		ComPtr<IMFTrackedSample> trackedSample;
+		ComPtr<IMFMediaBuffer> mediaBuffer;
+		spSample->DeleteAllItems();
+		hr = spSample->SetUINT32(SamplePoolGenerationKey, generation);
+		if (SUCCEEDED(hr)) hr = spSample->GetBufferByIndex(0, mediaBuffer.GetAddressOf());
+		if (SUCCEEDED(hr)) hr = spSample.As(&trackedSample);
+		if (SUCCEEDED(hr)) hr = trackedSample->SetAllocator(mSampleAllocator.Get(), nullptr);
+		if (FAILED(hr)) {
+			ms_error("MediaStreamSource::AcquireSample: cannot reuse pooled sample %x", hr);
+			mSamplePool->Recycle(spSample, generation);
+			return hr;
+		}
+		*ppSample = spSample.Detach();
+		*ppMediaBuffer = mediaBuffer.Detach();
+		return S_OK;
+	}
+	if (FAILED(hr)) return hr;
+
+	// All the pooled samples are still held by the media engine, use a sample that will not be recycled.
+	ComPtr<IMFMediaBuffer> mediaBuffer;
+	hr = MFCreateSample(spSample.GetAddressOf());
+	if (FAILED(hr)) {
+		ms_error("MediaStreamSource::AcquireSample: MFCreateSample failed %x", hr);
+		return hr;
+	}
+	hr = MFCreate2DMediaBuffer(width, height, 0x3231564E /* NV12 */, FALSE, mediaBuffer.GetAddressOf());
+	if (FAILED(hr)) {
+		ms_error("MediaStreamSource::AcquireSample: MFCreate2DMediaBuffer failed %x", hr);
+		return hr;
+	}
+	spSample->AddBuffer(mediaBuffer.Get());
+	*ppSample = spSample.Detach();
+	*ppMediaBuffer = mediaBuffer.Detach();
+	return S_OK;
+}
+
+void libmswinrtvid::MediaStreamSource::RenderFrame(IMFMediaBuffer* mediaBuffer, Sample *sample)
 {
 	ComPtr<IMF2DBuffer2> imageBuffer;
 	HRESULT hr = mediaBuffer->QueryInterface(imageBuffer.GetAddressOf());
@@ -153,9 +292,9 @@ void libmswinrtvid::MediaStreamSource::RenderFrame(IMFMediaBuffer* mediaBuffer)
 	}
 
 	ComPtr<Windows::Storage::Streams::IBufferByteAccess> sampleByteAccess;
-	hr = reinterpret_cast<IInspectable*>(mSample->Buffer)->QueryInterface(IID_PPV_ARGS(&sampleByteAccess));
+	hr = reinterpret_cast<IInspectable*>(sample->Buffer)->QueryInterface(IID_PPV_ARGS(&sampleByteAccess));
 	if (FAILED(hr)) {
-		ms_error("MediaStreamSource::RenderFrame: mSample->Buffer QueryInterface failed %x", hr);
+		ms_error("MediaStreamSource::RenderFrame: sample->Buffer QueryInterface failed %x", hr);
 		return;
 	}
 
@@ -172,24 +311,9 @@ void libmswinrtvid::MediaStreamSource::RenderFrame(IMFMediaBuffer* mediaBuffer)
 	BYTE* srcRawData = nullptr;
 	sampleByteAccess->Buffer(&srcRawData);
 	MSPicture src_pic;
-	MSPicture dst_pic;
-	ms_yuv_buf_init(&src_pic, mSample->Width, mSample->Height, mSample->Width, srcRawData);
-	ms_yuv_buf_init(&dst_pic, mSample->Width, mSample->Height, pitch, destRawData);
-	/* Copy Y plane */
-	uint8_t *src_plane = src_pic.planes[0];
-	uint8_t *dst_plane = dst_pic.planes[0];
-	for (int i = 0; i < src_pic.h; ++i) {
-		memcpy(dst_plane, src_plane, src_pic.w);
-		src_plane += src_pic.w;
-		dst_plane += pitch;
-	}
-	/* Copy U & V plane with interleaving */
-	dst_plane = dst_pic.planes[1];
-	for (int i = 0; i < src_pic.h / 2; i++) {
-		for (int j = 0; j < src_pic.w / 2; j++) {
-			dst_plane[i * pitch + j * 2] = src_pic.planes[1][i * (src_pic.w / 2) + j];
-			dst_plane[i * pitch + j * 2 + 1] = src_pic.planes[2][i * (src_pic.w / 2) + j];
-		}
-	}
+	ms_yuv_buf_init(&src_pic, sample->Width, sample->Height, sample->Width, srcRawData);
+	/* Copy Y plane and interleave U & V planes, the UV plane follows the pitch-padded Y plane */
+	YuvConverter::I420ToNV12(src_pic.planes[0], src_pic.strides[0], src_pic.planes[1], src_pic.strides[1], src_pic.planes[2], src_pic.strides[2],
+		destRawData, pitch, destRawData + pitch * src_pic.h, pitch, src_pic.w, src_pic.h);
 	imageBuffer->Unlock2D();
 }
@@ -23,79 +23,52 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #pragma once
 
 #include <Mfidl.h>
+#include <memory>
 #include <mutex>
-#include <collection.h>
+#include <wrl/client.h>
+
+#include "LatestFrameMailbox.h"
+#include "MonotonicClock.h"
+#include "RenderAheadEstimator.h"
+#include "SamplePool.h"
+#include "TimelineMapper.h"
 
 
 namespace libmswinrtvid
 {
-	private ref class SampleRequestDeferral sealed
+	/// A sample request waiting for a frame, with the deferral to complete once it has been answered.
+	struct SampleRequestDeferral
 	{
-	public:
-		SampleRequestDeferral(Windows::Media::Core::MediaStreamSourceSampleRequest^ request, Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ deferral)
-		{
-			this->Request = request;
-			this->Deferral = deferral;
-		}
-
-		property Windows::Media::Core::MediaStreamSourceSampleRequest^ Request
-		{
-			Windows::Media::Core::MediaStreamSourceSampleRequest^ get() { return mRequest; }
-			void set(Windows::Media::Core::MediaStreamSourceSampleRequest^ value) { mRequest = value; }
-		}
-
-		property Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ Deferral
-		{
-			Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ get() { return mDeferral; }
-			void set(Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ value) { mDeferral = value; }
-		}
-
-	private:
-		~SampleRequestDeferral() {};
-
-		Windows::Media::Core::MediaStreamSourceSampleRequest^ mRequest;
-		Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ mDeferral;
+		Windows::Media::Core::MediaStreamSourceSampleRequest^ Request;
+		Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ Deferral;
 	};
 
-	private ref class Sample sealed
+	/// A frame fed to the MediaStreamSource, waiting for a sample request.
+	struct Sample
 	{
-	public:
-		Sample(Windows::Storage::Streams::IBuffer^ buffer, int width, int height)
-		{
-			mBuffer = buffer;
-			mWidth = width;
-			mHeight = height;
-		}
-
-		property Windows::Storage::Streams::IBuffer^ Buffer
-		{
-			Windows::Storage::Streams::IBuffer^ get() { return mBuffer; }
-		}
-
-		property int Width
-		{
-			int get() { return mWidth; }
-		}
-
-		property int Height
-		{
-			int get() { return mHeight; }
-		}
-
-	private:
-		~Sample() {};
-
-		Windows::Storage::Streams::IBuffer^ mBuffer;
-		int mWidth;
-		int mHeight;
+		Sample(Windows::Storage::Streams::IBuffer^ buffer, int width, int height, int64_t timestamp, int64_t arrival)
+			: Buffer(buffer), Width(width), Height(height), Timestamp(timestamp), Arrival(arrival) {}
+
+		Windows::Storage::Streams::IBuffer^ Buffer;
+		int Width;
+		int Height;
+		// 90 kHz timestamp of the frame, or -1 to present it when it is rendered.
+		int64_t Timestamp;
+		// MonotonicClock time of the feed.
+		int64_t Arrival;
 	};
 
+	typedef SamplePool<Microsoft::WRL::ComPtr<IMFSample>> MFSamplePool;
+
 	ref class MediaStreamSource sealed
 	{
-	public:
-		static MediaStreamSource^ CreateMediaSource();
+	internal:
+		/// The render-ahead estimator is shared with the owner of the MediaStreamSource, that sets its bounds.
+		static MediaStreamSource^ CreateMediaSource(const std::shared_ptr<RenderAheadEstimator> &renderAhead);
 
-		void Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height);
+	public:
+		/// timestamp is the 90 kHz timestamp the frame is presented at, or -1 to present it when it is rendered.
+		void Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height, int64 timestamp);
 		void Stop();
 
 		property Windows::Media::Core::MediaStreamSource^ Source
@@ -108,15 +81,34 @@ namespace libmswinrtvid
 		~MediaStreamSource();
 
 		void OnSampleRequested(Windows::Media::Core::MediaStreamSource ^sender, Windows::Media::Core::MediaStreamSourceSampleRequestedEventArgs ^args);
-		void AnswerSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest);
-		void RenderFrame(IMFMediaBuffer* mediaBuffer);
+		void AnswerSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest, Sample *sample);
+		void AnswerPendingRequests();
+		HRESULT AcquireSample(UINT32 width, UINT32 height, IMFSample **ppSample, IMFMediaBuffer **ppMediaBuffer);
+		void RenderFrame(IMFMediaBuffer* mediaBuffer, Sample *sample);
+
+		void DeferSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ request);
+		// Sample repeating the last frame answered, or a black one, for a request evicted from the mailbox.
+		Sample * CreateRepeatedSample();
+
+		static const size_t SamplePoolSize = 4;
+		static const size_t MaxPendingRequests = 4;
 
 		Windows::Media::Core::MediaStreamSource^ mMediaStreamSource;
 		Windows::Media::Core::VideoStreamDescriptor^ mVideoDesc;
-		Platform::Collections::Vector<SampleRequestDeferral^>^ mDeferralQueue;
-		Sample^ mSample;
-		uint64 mTimeStamp;
-		uint64 mInitialTimeStamp;
+		// Hands the frames fed by the ticker thread over to the SampleRequested thread.
+		LatestFrameMailbox<Sample, SampleRequestDeferral> mMailbox;
+		SampleClock mSampleClock;
+		TimelineMapper mTimeline;
+		std::shared_ptr<RenderAheadEstimator> mRenderAhead;
+		// MonotonicClock time of the feed of the last frame answered, 0 before the first one.
+		int64_t mLastArrival;
+		// Last frame answered, repeated for an evicted request.
+		Windows::Storage::Streams::IBuffer^ mLastBuffer;
+		int mLastWidth;
+		int mLastHeight;
+		std::shared_ptr<MFSamplePool> mSamplePool;
+		Microsoft::WRL::ComPtr<IMFAsyncCallback> mSampleAllocator;
+		// Guards the stream descriptor and the timelines, not the frame copy.
 		std::mutex mMutex;
 	};
 }
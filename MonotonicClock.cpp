@@ -0,0 +1,83 @@
+/*
+MonotonicClock.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "MonotonicClock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+using namespace libmswinrtvid;
+
+
+int64_t MonotonicClock::Now()
+{
+#ifdef _WIN32
+	// Never fails from Windows XP on, and constant until the reboot.
+	static const int64_t frequency = []() {
+		LARGE_INTEGER value;
+		QueryPerformanceFrequency(&value);
+		return value.QuadPart;
+	}();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// Split the conversion so that the product does not overflow.
+	int64_t seconds = counter.QuadPart / frequency;
+	int64_t remainder = counter.QuadPart % frequency;
+	return seconds * Rate + (remainder * Rate) / frequency;
+#else
+	return std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, Rate>>>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+SampleClock::SampleClock()
+	: mStarted(false), mOrigin(0), mLast(0), mDuration(DefaultDuration)
+{
+}
+
+void SampleClock::Reset()
+{
+	mStarted = false;
+	mDuration = DefaultDuration;
+}
+
+void SampleClock::Stamp(int64_t now, int64_t &sampleTime, int64_t &duration)
+{
+	if (!mStarted) {
+		mStarted = true;
+		mOrigin = now;
+	} else {
+		int64_t interval = now - mLast;
+		if ((interval > 0) && (interval <= MaxInterval)) {
+			mDuration += (interval - mDuration) / SmoothingFactor;
+		} else if (interval <= 0) {
+			// Eg. a frame fed before a repeated frame was stamped, the sample times must keep increasing.
+			now = mLast + 1;
+		}
+	}
+	mLast = now;
+	sampleTime = now - mOrigin;
+	duration = mDuration;
+}
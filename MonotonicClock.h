@@ -0,0 +1,74 @@
+/*
+MonotonicClock.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// High resolution monotonic clock: QueryPerformanceCounter on Windows, std::chrono::steady_clock elsewhere.
+	/// </summary>
+	class MonotonicClock
+	{
+	public:
+		static const int64_t Rate = 10000000;
+
+		/// Current time in 100 ns units, from an arbitrary origin.
+		static int64_t Now();
+	};
+
+	/// <summary>
+	/// Stamps the rendered samples: the sample time is the time elapsed since the first sample, and the duration
+	/// is the interval between the frames smoothed over the last ones, so that the jitter of the arrivals does
+	/// not make the durations of successive samples swing. Times are in 100 ns units.
+	/// </summary>
+	class SampleClock
+	{
+	public:
+		SampleClock();
+
+		/// Restart the timeline from the next sample, eg. when the renderer restarts.
+		void Reset();
+		bool IsStarted() const { return mStarted; }
+
+		/// Stamp a sample from the MonotonicClock time at which its frame arrived, not the time it is answered.
+		/// A time not after the previous one is stamped just after it, the sample times keep increasing.
+		void Stamp(int64_t now, int64_t &sampleTime, int64_t &duration);
+
+	private:
+		// Duration of the first samples, before an interval has been measured.
+		static const int64_t DefaultDuration = MonotonicClock::Rate / 30;
+		// Longer intervals are pauses of the stream, not its frame rate.
+		static const int64_t MaxInterval = MonotonicClock::Rate;
+		// Weight of a new interval in the smoothed duration is 1/SmoothingFactor.
+		static const int64_t SmoothingFactor = 8;
+
+		bool mStarted;
+		int64_t mOrigin;
+		int64_t mLast;
+		int64_t mDuration;
+	};
+}
@@ -0,0 +1,97 @@
+/*
+PendingRequestRing.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Fixed capacity FIFO of the sample requests of a MediaStreamSource waiting for a frame. The storage is
+	/// allocated once, pushing and popping a request is O(1) and never allocates.
+	/// The media pipeline keeps a single request outstanding per stream, so the ring only fills up if requests are
+	/// not answered for a long time. The oldest request is then evicted and handed back to the caller, that must
+	/// answer it with a sample before completing it: a request completed without a sample ends the stream.
+	/// </summary>
+	template <class T>
+	class PendingRequestRing
+	{
+	public:
+		PendingRequestRing(size_t capacity) : mItems((capacity > 0) ? capacity : 1), mHead(0), mCount(0), mEvictedCount(0) {}
+
+		/// Returns true if the ring was full, the oldest request being then moved to evicted.
+		bool Push(const T &item, T &evicted)
+		{
+			bool full = (mCount == mItems.size());
+			if (full) {
+				Pop(evicted);
+				mEvictedCount++;
+			}
+			mItems[Index(mCount)] = item;
+			mCount++;
+			return full;
+		}
+
+		/// Returns false if the ring is empty.
+		bool Pop(T &item)
+		{
+			if (mCount == 0) return false;
+			item = mItems[mHead];
+			// Do not keep a reference on the request in the ring.
+			mItems[mHead] = T();
+			mHead = Index(1);
+			mCount--;
+			return true;
+		}
+
+		/// Remove all the requests, calling clearFn on each of them, oldest first.
+		template <class FN>
+		void Clear(FN clearFn)
+		{
+			T item;
+			while (Pop(item)) clearFn(item);
+			mHead = 0;
+		}
+
+		size_t GetCount() const { return mCount; }
+		bool IsEmpty() const { return mCount == 0; }
+		size_t GetCapacity() const { return mItems.size(); }
+		unsigned long long GetEvictedCount() const { return mEvictedCount; }
+
+	private:
+		size_t Index(size_t offset) const
+		{
+			size_t index = mHead + offset;
+			return (index >= mItems.size()) ? (index - mItems.size()) : index;
+		}
+
+		std::vector<T> mItems;
+		size_t mHead;
+		size_t mCount;
+		unsigned long long mEvictedCount;
+	};
+}
@@ -0,0 +1,114 @@
+/*
+RenderAheadEstimator.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "RenderAheadEstimator.h"
+
+#include <string.h>
+
+using namespace libmswinrtvid;
+
+
+RenderAheadEstimator::RenderAheadEstimator()
+	: mMin(DefaultMinMs * UnitsPerMs), mMax(DefaultMaxMs * UnitsPerMs)
+{
+	Reset();
+}
+
+bool RenderAheadEstimator::SetBounds(int minMs, int maxMs)
+{
+	if ((minMs < 0) || (maxMs < minMs)) return false;
+	std::lock_guard<std::mutex> lock(mMutex);
+	mMin = minMs * UnitsPerMs;
+	mMax = maxMs * UnitsPerMs;
+	mValue = Clamp(mValue);
+	return true;
+}
+
+void RenderAheadEstimator::GetBounds(int &minMs, int &maxMs)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	minMs = (int)(mMin / UnitsPerMs);
+	maxMs = (int)(mMax / UnitsPerMs);
+}
+
+void RenderAheadEstimator::Reset()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	memset(mHistogram, 0, sizeof(mHistogram));
+	mNext = 0;
+	mCount = 0;
+	mValue = Clamp(DefaultRenderAhead);
+}
+
+int64_t RenderAheadEstimator::Update(int64_t jitter)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	int64_t bucket = (jitter > 0) ? (jitter / (BucketWidthMs * UnitsPerMs)) : 0;
+	if (bucket >= BucketCount) bucket = BucketCount - 1;
+	if (mCount == WindowSize) {
+		mHistogram[mWindow[mNext]]--;
+	} else {
+		mCount++;
+	}
+	mWindow[mNext] = (unsigned char)bucket;
+	mHistogram[bucket]++;
+	mNext = (mNext + 1) % WindowSize;
+
+	int64_t target = DefaultRenderAhead;
+	if (mCount >= MinSamples) {
+		unsigned int threshold = (unsigned int)((mCount * Percentile + 99) / 100);
+		unsigned int cumulated = 0;
+		int i = 0;
+		for (; i < BucketCount - 1; i++) {
+			cumulated += mHistogram[i];
+			if (cumulated >= threshold) break;
+		}
+		// Upper edge of the bucket, the jitter of the frames counted in it being up to there.
+		target = (i + 1) * BucketWidthMs * UnitsPerMs + Margin;
+	}
+	target = Clamp(target);
+	if (target >= mValue) {
+		mValue = target;
+	} else {
+		mValue = ((mValue - target) > MaxDecrease) ? (mValue - MaxDecrease) : target;
+	}
+	return mValue;
+}
+
+int RenderAheadEstimator::GetRenderAheadMs()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (int)(mValue / UnitsPerMs);
+}
+
+void RenderAheadEstimator::GetHistogram(unsigned int counts[BucketCount])
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	memcpy(counts, mHistogram, sizeof(mHistogram));
+}
+
+int64_t RenderAheadEstimator::Clamp(int64_t value) const
+{
+	if (value < mMin) return mMin;
+	if (value > mMax) return mMax;
+	return value;
+}
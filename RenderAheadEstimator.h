@@ -0,0 +1,86 @@
+/*
+RenderAheadEstimator.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Estimates how far ahead of the local clock the frames must be scheduled for the renderer to get them in
+	/// time: the 95th percentile of the jitter of the last frames plus a margin, within configurable bounds.
+	/// The jitter is kept in a histogram of 2 ms buckets over a sliding window of frames. The estimate rises at
+	/// once and falls by 1 ms per frame at most, so that the presentation times of the frames stay increasing.
+	/// Times are in 100 ns units, the bounds in ms.
+	/// </summary>
+	class RenderAheadEstimator
+	{
+	public:
+		static const int BucketCount = 128;
+		static const int BucketWidthMs = 2;
+		static const int DefaultMinMs = 10;
+		static const int DefaultMaxMs = 200;
+
+		RenderAheadEstimator();
+
+		/// Returns false if the bounds are invalid.
+		bool SetBounds(int minMs, int maxMs);
+		void GetBounds(int &minMs, int &maxMs);
+
+		/// Forget the jitter measured so far, eg. when the stream restarts.
+		void Reset();
+
+		/// Add the jitter of a frame and return the render-ahead to use for it.
+		int64_t Update(int64_t jitter);
+
+		/// Current render-ahead in ms, and count of the frames of the window per jitter bucket,
+		/// the last bucket counting all the frames above.
+		int GetRenderAheadMs();
+		void GetHistogram(unsigned int counts[BucketCount]);
+
+	private:
+		static const int64_t UnitsPerMs = 10000;
+		static const int WindowSize = 300;
+		// Below this number of frames, the former fixed render-ahead is used.
+		static const int MinSamples = 30;
+		static const int64_t DefaultRenderAhead = 40 * UnitsPerMs;
+		static const int Percentile = 95;
+		static const int64_t Margin = 5 * UnitsPerMs;
+		static const int64_t MaxDecrease = 1 * UnitsPerMs;
+
+		int64_t Clamp(int64_t value) const;
+
+		std::mutex mMutex;
+		int64_t mMin;
+		int64_t mMax;
+		int64_t mValue;
+		unsigned int mHistogram[BucketCount];
+		unsigned char mWindow[WindowSize];
+		int mNext;
+		int mCount;
+	};
+}
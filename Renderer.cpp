@@ -85,6 +85,7 @@ MSWinRTRenderer::MSWinRTRenderer() :
 	mMediaStreamSource(nullptr), mMediaEngine(nullptr), mUrl(nullptr),
 	mForegroundProcess(nullptr), mMemoryMapping(nullptr), mSharedData(nullptr), mLock(nullptr), mShutdownEvent(nullptr), mEventAvailableEvent(nullptr)
 {
+	mRenderAhead = std::make_shared<RenderAheadEstimator>();
 }
 
 MSWinRTRenderer::~MSWinRTRenderer()
@@ -238,7 +239,7 @@ bool MSWinRTRenderer::Start()
 		SendErrorEvent(hr);
 		return false;
 	}
-	mMediaStreamSource = MediaStreamSource::CreateMediaSource();
+	mMediaStreamSource = MediaStreamSource::CreateMediaSource(mRenderAhead);
 	mUrl = "mswinrtvid://";
 	GUID result;
 	hr = CoCreateGuid(&result);
@@ -276,7 +277,7 @@ void MSWinRTRenderer::Stop()
 	Close();
 }
 
-void MSWinRTRenderer::Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height)
+void MSWinRTRenderer::Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height, int64 timestamp)
 {
 	if ((mMediaStreamSource != nullptr) && (mSharedData != nullptr) && (mMediaEngineEx != nullptr)) {
 		bool sizeChanged = false;
@@ -303,7 +304,7 @@ void MSWinRTRenderer::Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int widt
 			mMediaEngineEx->UpdateVideoStream(&srcSize, &dstSize, &backgroundColor);
 		}
 
-		mMediaStreamSource->Feed(pBuffer, width, height);
+		mMediaStreamSource->Feed(pBuffer, width, height, timestamp);
 	}
 }
 
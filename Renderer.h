@@ -84,7 +84,7 @@ namespace libmswinrtvid
 
 		bool Start();
 		void Stop();
-		void Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height);
+		void Feed(Windows::Storage::Streams::IBuffer^ pBuffer, int width, int height, int64 timestamp);
 		virtual void OnMediaEngineEvent(uint32 meEvent, uintptr_t param1, uint32 param2);
 		static bool D3D11Supported();
 
@@ -104,6 +104,10 @@ namespace libmswinrtvid
 			void set(Platform::String^ value) { mSwapChainPanelName = value; }
 		}
 
+	internal:
+		/// Kept across the restarts of the renderer, so that its bounds are kept too.
+		std::shared_ptr<RenderAheadEstimator> GetRenderAheadEstimator() { return mRenderAhead; }
+
 	private:
 		void Close();
 		void SetSwapChainPanel();
@@ -117,6 +121,7 @@ namespace libmswinrtvid
 		int mSwapChainPanelWidth;
 		int mSwapChainPanelHeight;
 		MediaStreamSource^ mMediaStreamSource;
+		std::shared_ptr<RenderAheadEstimator> mRenderAhead;
 		UINT mResetToken;
 
 		HANDLE mMemoryMapping;
@@ -0,0 +1,108 @@
+/*
+RingQueue.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+
+#include <new>
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// FIFO queue stored in a ring buffer. The buffer only grows when the queue is full, so once it has reached
+	/// the usual depth of the queue, inserting and removing items no longer allocates.
+	/// </summary>
+	template <class T>
+	class RingQueue
+	{
+	public:
+		RingQueue(size_t capacity) : mItems((capacity > 0) ? capacity : 1), mHead(0), mCount(0) {}
+
+		/// Returns false if the buffer had to grow and the allocation failed.
+		bool PushBack(const T &item)
+		{
+			if ((mCount == mItems.size()) && !Grow()) return false;
+			mItems[Index(mCount)] = item;
+			mCount++;
+			return true;
+		}
+
+		/// Returns false if the queue is empty.
+		bool PopFront(T &item)
+		{
+			if (mCount == 0) return false;
+			item = mItems[mHead];
+			mItems[mHead] = T();
+			mHead = Index(1);
+			mCount--;
+			return true;
+		}
+
+		/// Remove all the items, calling clearFn on each of them. The buffer is kept.
+		template <class FN>
+		void Clear(FN clearFn)
+		{
+			T item;
+			while (PopFront(item)) clearFn(item);
+			mHead = 0;
+		}
+
+		void Clear()
+		{
+			Clear([](T &) {});
+		}
+
+		size_t GetCount() const { return mCount; }
+		bool IsEmpty() const { return mCount == 0; }
+		size_t GetCapacity() const { return mItems.size(); }
+
+	private:
+		size_t Index(size_t offset) const
+		{
+			size_t index = mHead + offset;
+			return (index >= mItems.size()) ? (index - mItems.size()) : index;
+		}
+
+		bool Grow()
+		{
+			try {
+				std::vector<T> items(mItems.size() * 2);
+				for (size_t i = 0; i < mCount; i++) {
+					items[i] = mItems[Index(i)];
+				}
+				mItems.swap(items);
+				mHead = 0;
+			} catch (std::bad_alloc &) {
+				return false;
+			}
+			return true;
+		}
+
+		std::vector<T> mItems;
+		size_t mHead;
+		size_t mCount;
+	};
+}
@@ -0,0 +1,118 @@
+/*
+SamplePool.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+
+#include <mutex>
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Bounded pool of media samples of the same dimensions. T is a copyable handle on a sample (eg. a ComPtr).
+	/// Each item is tagged with the generation of the pool it was acquired from, so that the items given back
+	/// after a change of dimensions or a reset are dropped instead of being reused.
+	/// </summary>
+	template <class T>
+	class SamplePool
+	{
+	public:
+		SamplePool(size_t capacity) : mCapacity(capacity), mWidth(0), mHeight(0), mGeneration(0), mInUse(0)
+		{
+			// Reserved once so that giving an item back never allocates.
+			mFree.reserve(capacity);
+		}
+
+		/// Get an item of width x height, either a recycled one or one made by create, called as bool create(T &item).
+		/// Returns false when capacity items are already in use or when create fails.
+		template <class Factory>
+		bool Acquire(int width, int height, T &item, unsigned int &generation, Factory create)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if ((width != mWidth) || (height != mHeight)) {
+				ResetLocked();
+				mWidth = width;
+				mHeight = height;
+			}
+			if (!mFree.empty()) {
+				item = mFree.back();
+				mFree.pop_back();
+			} else {
+				if (mInUse >= mCapacity) return false;
+				if (!create(item)) return false;
+			}
+			mInUse++;
+			generation = mGeneration;
+			return true;
+		}
+
+		/// Give back an item obtained with Acquire. Returns false if the item has been dropped.
+		bool Recycle(const T &item, unsigned int generation)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (generation != mGeneration) return false;
+			mInUse--;
+			mFree.push_back(item);
+			return true;
+		}
+
+		/// Drop the free items and forget the items in use.
+		void Reset()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			ResetLocked();
+		}
+
+		size_t GetFreeCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mFree.size();
+		}
+
+		size_t GetInUseCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mInUse;
+		}
+
+	private:
+		void ResetLocked()
+		{
+			mFree.clear();
+			mInUse = 0;
+			mWidth = mHeight = 0;
+			mGeneration++;
+		}
+
+		std::mutex mMutex;
+		std::vector<T> mFree;
+		size_t mCapacity;
+		int mWidth;
+		int mHeight;
+		unsigned int mGeneration;
+		size_t mInUse;
+	};
+}
@@ -0,0 +1,116 @@
+/*
+SliceWorkerPool.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "SliceWorkerPool.h"
+
+using namespace libmswinrtvid;
+
+
+// Split the frames starting from 720p.
+std::atomic<int> SliceWorkerPool::smParallelThreshold(1280 * 720);
+
+
+SliceWorkerPool * SliceWorkerPool::GetInstance()
+{
+	// Never destroyed: joining threads from the static destructors would run under the loader lock when the plugin is unloaded.
+	static SliceWorkerPool *instance = nullptr;
+	static std::once_flag created;
+	std::call_once(created, []() {
+		instance = new SliceWorkerPool((int)std::thread::hardware_concurrency());
+	});
+	return instance;
+}
+
+SliceWorkerPool::SliceWorkerPool(int threadCount)
+	: mJob(nullptr), mCount(0), mSliceSize(0), mSliceCount(0), mNextSlice(0), mPendingSlices(0), mStop(false)
+{
+	if (threadCount > MaxThreads) threadCount = MaxThreads;
+	if (threadCount < 1) threadCount = 1;
+	// The calling thread takes a slice of each frame.
+	for (int i = 1; i < threadCount; i++) {
+		mThreads.push_back(std::thread(&SliceWorkerPool::WorkerLoop, this));
+	}
+}
+
+SliceWorkerPool::~SliceWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWorkAvailable.notify_all();
+	for (size_t i = 0; i < mThreads.size(); i++) {
+		mThreads[i].join();
+	}
+}
+
+void SliceWorkerPool::Run(int count, int granularity, const SliceJob &job)
+{
+	if (count <= 0) return;
+	std::unique_lock<std::mutex> runLock(mRunMutex, std::try_to_lock);
+	int units = (count + granularity - 1) / granularity;
+	if (mThreads.empty() || !runLock.owns_lock() || (units < 2)) {
+		job(0, count);
+		return;
+	}
+
+	int slices = (units < GetThreadCount()) ? units : GetThreadCount();
+	std::unique_lock<std::mutex> lock(mMutex);
+	mJob = &job;
+	mCount = count;
+	mSliceSize = ((units + slices - 1) / slices) * granularity;
+	mSliceCount = (count + mSliceSize - 1) / mSliceSize;
+	mNextSlice = 0;
+	mPendingSlices = mSliceCount;
+	mWorkAvailable.notify_all();
+	while (RunNextSlice(lock));
+	// Completion barrier: the job and the frame buffers must not be released while a worker is still on a slice.
+	mWorkDone.wait(lock, [this]() { return mPendingSlices == 0; });
+	mJob = nullptr;
+}
+
+bool SliceWorkerPool::RunNextSlice(std::unique_lock<std::mutex> &lock)
+{
+	if ((mJob == nullptr) || (mNextSlice >= mSliceCount)) return false;
+
+	const SliceJob *job = mJob;
+	int first = mNextSlice * mSliceSize;
+	int last = ((first + mSliceSize) < mCount) ? (first + mSliceSize) : mCount;
+	mNextSlice++;
+	lock.unlock();
+	(*job)(first, last);
+	lock.lock();
+	if (--mPendingSlices == 0) {
+		mWorkDone.notify_all();
+	}
+	return true;
+}
+
+void SliceWorkerPool::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (!mStop) {
+		if (!RunNextSlice(lock)) {
+			mWorkAvailable.wait(lock);
+		}
+	}
+}
@@ -0,0 +1,88 @@
+/*
+SliceWorkerPool.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Small bounded pool of threads shared by the pixel conversions of all the filters.
+	/// A frame is split into horizontal slices that are converted in parallel, the calling thread taking its share.
+	/// The pool has MaxThreads threads at most, the calling thread included: past that the conversions are bound
+	/// by the memory bandwidth, and the threads would only compete with the codecs.
+	/// </summary>
+	class SliceWorkerPool
+	{
+	public:
+		typedef std::function<void(int first, int last)> SliceJob;
+
+		static const int MaxThreads = 8;
+
+		/// Pool shared by the filters, with a thread per core up to MaxThreads.
+		static SliceWorkerPool * GetInstance();
+
+		/// Pool of threadCount threads, the calling thread included, clamped to [1, MaxThreads].
+		/// The filters use GetInstance(), a separate pool is for measuring the scaling with the thread count.
+		explicit SliceWorkerPool(int threadCount);
+		~SliceWorkerPool();
+
+		/// Minimum number of pixels of a frame for its conversion to be split among the threads.
+		static void SetParallelThreshold(int pixels) { smParallelThreshold = pixels; }
+		static int GetParallelThreshold() { return smParallelThreshold; }
+		static bool ShouldParallelize(int width, int height) { return (width * height) >= smParallelThreshold; }
+
+		/// Number of threads working on a frame, including the calling thread.
+		int GetThreadCount() const { return (int)mThreads.size() + 1; }
+
+		/// Run job on slices covering [0, count), each slice boundary being a multiple of granularity.
+		/// Returns once every slice has completed. If the pool is already busy with another frame,
+		/// the whole job is run on the calling thread.
+		void Run(int count, int granularity, const SliceJob &job);
+
+	private:
+		void WorkerLoop();
+		bool RunNextSlice(std::unique_lock<std::mutex> &lock);
+
+		static std::atomic<int> smParallelThreshold;
+
+		std::vector<std::thread> mThreads;
+		std::mutex mRunMutex;
+		std::mutex mMutex;
+		std::condition_variable mWorkAvailable;
+		std::condition_variable mWorkDone;
+		const SliceJob *mJob;
+		int mCount;
+		int mSliceSize;
+		int mSliceCount;
+		int mNextSlice;
+		int mPendingSlices;
+		bool mStop;
+	};
+}
@@ -0,0 +1,147 @@
+/*
+SpscRing.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Bounded lock-free ring of pointers between a single producer thread and a single consumer thread.
+	/// When the ring holds Depth items, a new item is handled according to the overflow policy. An item that
+	/// is dropped is given to the dispose function. Only the head index is shared by both sides for writing:
+	/// the producer advances it to drop the oldest item, so the consumer takes an item with a compare-and-swap.
+	/// </summary>
+	template <class T>
+	class SpscRing
+	{
+	public:
+		enum OverflowPolicy {
+			DropOldest = 0, /// Drop the oldest queued item to make room for the new one.
+			DropNewest = 1, /// Drop the new item.
+			Block = 2       /// Wait in the producer until the consumer makes room, or until the ring is closed.
+		};
+		typedef void (*DisposeFunc)(T item);
+
+		SpscRing(size_t capacity, DisposeFunc dispose)
+			: mSlots((capacity > 0) ? capacity : 1), mDispose(dispose), mDepth(mSlots.size()), mPolicy(DropOldest),
+			mClosed(false), mHead(0), mTail(0), mDropped(0)
+		{}
+
+		~SpscRing()
+		{
+			Clear();
+		}
+
+		/// Producer side. Returns false if the item has been dropped.
+		bool Push(T item)
+		{
+			for (;;) {
+				uint64_t tail = mTail.load(std::memory_order_relaxed);
+				uint64_t head = mHead.load(std::memory_order_acquire);
+				if ((tail - head) < mDepth.load(std::memory_order_relaxed)) {
+					mSlots[tail % mSlots.size()].store(item, std::memory_order_relaxed);
+					mTail.store(tail + 1, std::memory_order_release);
+					return true;
+				}
+				int policy = mPolicy.load(std::memory_order_relaxed);
+				if (policy == DropOldest) {
+					T oldest = mSlots[head % mSlots.size()].load(std::memory_order_relaxed);
+					// Fails if the consumer took the item in the meantime, there is then room for the new one.
+					if (mHead.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+						Drop(oldest);
+					}
+				} else if ((policy == Block) && !mClosed.load(std::memory_order_acquire)) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				} else {
+					Drop(item);
+					return false;
+				}
+			}
+		}
+
+		/// Consumer side. Returns false if the ring is empty.
+		bool Pop(T &item)
+		{
+			uint64_t head = mHead.load(std::memory_order_acquire);
+			for (;;) {
+				if (head == mTail.load(std::memory_order_acquire)) return false;
+				T value = mSlots[head % mSlots.size()].load(std::memory_order_relaxed);
+				// Fails if the producer dropped this item meanwhile, head is then reloaded.
+				if (mHead.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+					item = value;
+					return true;
+				}
+			}
+		}
+
+		/// Consumer side. Whether there is an item to pop.
+		bool IsEmpty() const
+		{
+			return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+		}
+
+		/// Consumer side. Dispose of all the queued items, they are not counted as dropped.
+		void Clear()
+		{
+			T item;
+			while (Pop(item)) mDispose(item);
+		}
+
+		/// A closed ring never blocks the producer, the Block policy then drops the new items.
+		void Close() { mClosed.store(true, std::memory_order_release); }
+		void Open() { mClosed.store(false, std::memory_order_release); }
+
+		size_t GetCapacity() const { return mSlots.size(); }
+		/// Maximum number of queued items, between 1 and the capacity. It can be changed while the ring is in use.
+		size_t GetDepth() const { return mDepth; }
+		void SetDepth(size_t depth) { mDepth = (depth < 1) ? 1 : ((depth > mSlots.size()) ? mSlots.size() : depth); }
+		OverflowPolicy GetOverflowPolicy() const { return (OverflowPolicy)mPolicy.load(); }
+		void SetOverflowPolicy(OverflowPolicy policy) { mPolicy = policy; }
+		uint64_t GetDroppedCount() const { return mDropped; }
+
+	private:
+		void Drop(T item)
+		{
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+			mDispose(item);
+		}
+
+		std::vector<std::atomic<T>> mSlots;
+		DisposeFunc mDispose;
+		std::atomic<size_t> mDepth;
+		std::atomic<int> mPolicy;
+		std::atomic<bool> mClosed;
+		std::atomic<uint64_t> mHead;
+		std::atomic<uint64_t> mTail;
+		std::atomic<uint64_t> mDropped;
+	};
+}
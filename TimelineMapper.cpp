@@ -0,0 +1,76 @@
+/*
+TimelineMapper.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "TimelineMapper.h"
+
+using namespace libmswinrtvid;
+
+
+TimelineMapper::TimelineMapper()
+	: mStarted(false), mLastTimestamp(0), mExtendedTimestamp(0), mOffset(0), mLastOutput(0), mResyncCount(0)
+{
+}
+
+void TimelineMapper::Reset()
+{
+	mStarted = false;
+}
+
+void TimelineMapper::Start(uint32_t timestamp, int64_t arrival)
+{
+	mLastTimestamp = timestamp;
+	mExtendedTimestamp = 0;
+	mOffset = arrival;
+}
+
+int64_t TimelineMapper::Map(uint32_t timestamp, int64_t arrival)
+{
+	if (!mStarted) {
+		Start(timestamp, arrival);
+	} else {
+		// Unwrap the 32 bits timestamps, a frame older than the previous one goes back on the timeline.
+		mExtendedTimestamp += (int32_t)(timestamp - mLastTimestamp);
+		mLastTimestamp = timestamp;
+	}
+
+	int64_t mediaTime = (mExtendedTimestamp * LocalRate) / TimestampRate;
+	int64_t offset = arrival - mediaTime;
+	if (mStarted && ((offset - mOffset > MaxDeviation) || (mOffset - offset > MaxDeviation))) {
+		mResyncCount++;
+		Start(timestamp, arrival);
+		mediaTime = 0;
+		offset = arrival;
+	}
+	if (!mStarted || (offset < mOffset)) {
+		mOffset = offset;
+	} else {
+		mOffset += ((offset - mOffset) < DriftStep) ? (offset - mOffset) : DriftStep;
+	}
+
+	int64_t output = mediaTime + mOffset;
+	if (mStarted && (output <= mLastOutput)) {
+		output = mLastOutput + 1;
+	}
+	mStarted = true;
+	mLastOutput = output;
+	return output;
+}
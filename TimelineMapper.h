@@ -0,0 +1,72 @@
+/*
+TimelineMapper.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Maps the 90 kHz RTP timestamps of the frames to presentation times on the local MonotonicClock, so that the
+	/// frames can be presented on the cadence they were captured at instead of the one they arrived at.
+	/// The offset between the two clocks is the smallest transit delay seen, the frames delayed by the network
+	/// being then presented at the time they would have arrived without delay. The offset rises slowly when all
+	/// the frames arrive later than it, to follow a sender clock slower than the local one, and falls at once
+	/// on an earlier frame. Times are in 100 ns units.
+	/// </summary>
+	class TimelineMapper
+	{
+	public:
+		TimelineMapper();
+
+		/// Restart the mapping from the next frame, eg. when the stream changes.
+		void Reset();
+
+		/// Presentation time of a frame with the given timestamp, that arrived at the given local time.
+		/// The presentation times never go backwards.
+		int64_t Map(uint32_t timestamp, int64_t arrival);
+
+		/// Current offset between the local clock and the media timeline, and number of discontinuities met.
+		int64_t GetOffset() const { return mOffset; }
+		unsigned int GetResyncCount() const { return mResyncCount; }
+
+	private:
+		static const int64_t TimestampRate = 90000;
+		static const int64_t LocalRate = 10000000;
+		// Rise of the offset per frame arriving late, 10 us: follows a drift of 300 ppm at 30 fps.
+		static const int64_t DriftStep = 100;
+		// A larger gap between the clocks is a new timeline, eg. a new stream or a sender restart.
+		static const int64_t MaxDeviation = 2 * LocalRate;
+
+		void Start(uint32_t timestamp, int64_t arrival);
+
+		bool mStarted;
+		uint32_t mLastTimestamp;
+		int64_t mExtendedTimestamp;
+		int64_t mOffset;
+		int64_t mLastOutput;
+		unsigned int mResyncCount;
+	};
+}
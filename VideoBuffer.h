@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #pragma once
 
 
+#include <string.h>
 #include <windows.h>
 #include <wrl.h>
 #include <wrl/implements.h>
@@ -33,6 +34,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include <mediastreamer2/mscommon.h>
 
+#include "FrameBufferPool.h"
+
 
 namespace libmswinrtvid
 {
@@ -47,24 +50,38 @@ namespace libmswinrtvid
 	{
 	public:
 		virtual ~VideoBuffer() {
-			freemsg(mMblk);
+			if (mMblk != NULL) {
+				freemsg(mMblk);
+			}
+			if (mPool) {
+				mPool->Release(mBuffer, mCapacity);
+			}
 			mBuffer = NULL;
 		}
 
 		STDMETHODIMP RuntimeClassInitialize(BYTE* pBuffer, UINT size, mblk_t *mblk) {
-			mSize = size;
+			mSize = mCapacity = size;
 			mBuffer = pBuffer;
 			mMblk = mblk;
 			return S_OK;
 		}
 
+		/// The buffer is given back to the pool when the IBuffer is released.
+		STDMETHODIMP RuntimeClassInitialize(BYTE* pBuffer, UINT size, std::shared_ptr<FrameBufferPool> pool) {
+			mSize = mCapacity = size;
+			mBuffer = pBuffer;
+			mMblk = NULL;
+			mPool = pool;
+			return S_OK;
+		}
+
 		STDMETHODIMP Buffer(BYTE **value) {
 			*value = mBuffer;
 			return S_OK;
 		}
 
 		STDMETHODIMP get_Capacity(UINT32 *value) {
-			*value = mSize;
+			*value = mCapacity;
 			return S_OK;
 		}
 
@@ -74,7 +91,7 @@ namespace libmswinrtvid
 		}
 
 		STDMETHODIMP put_Length(UINT32 value) {
-			if(value > mSize) {
+			if(value > mCapacity) {
 				return E_INVALIDARG;
 			}
 			mSize = value;
@@ -86,9 +103,25 @@ namespace libmswinrtvid
 			return reinterpret_cast<Windows::Storage::Streams::IBuffer^>(iinspectable);
 		}
 
+		/// Black frame to answer a sample request that no frame has been fed for. With a uniform chroma
+		/// the I420 and NV12 layouts are the same, so the frame is valid for both.
+		static Windows::Storage::Streams::IBuffer^ CreateBlackFrame(int width, int height) {
+			size_t lumaSize = (size_t)width * (size_t)height;
+			size_t size = lumaSize * 3 / 2;
+			mblk_t *mblk = allocb(size, 0);
+			memset(mblk->b_wptr, 16, lumaSize);
+			memset(mblk->b_wptr + lumaSize, 128, size - lumaSize);
+			mblk->b_wptr += size;
+			Microsoft::WRL::ComPtr<VideoBuffer> spVideoBuffer;
+			Microsoft::WRL::MakeAndInitialize<VideoBuffer>(&spVideoBuffer, mblk->b_rptr, (UINT)size, mblk);
+			return GetIBuffer(spVideoBuffer);
+		}
+
 	private:
 		UINT32 mSize;
+		UINT32 mCapacity;
 		BYTE* mBuffer;
 		mblk_t *mMblk;
+		std::shared_ptr<FrameBufferPool> mPool;
 	};
 }
@@ -0,0 +1,905 @@
+/*
+YuvConverter.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "YuvConverter.h"
+
+#include <string.h>
+#include <memory>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define YUVCONVERTER_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define YUVCONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__clang__) || defined(__GNUC__)
+#define YUVCONVERTER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define YUVCONVERTER_TARGET_AVX2
+#endif
+
+using namespace libmswinrtvid;
+
+
+/******************************************************************************
+ * Scalar implementation                                                      *
+ *****************************************************************************/
+
+static void InterleaveUV_C(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count)
+{
+	for (int i = 0; i < count; i++) {
+		dst[2 * i] = u[i];
+		dst[2 * i + 1] = v[i];
+	}
+}
+
+static void DeinterleaveUV_C(uint8_t *u, uint8_t *v, const uint8_t *src, int count)
+{
+	for (int i = 0; i < count; i++) {
+		u[i] = src[2 * i];
+		v[i] = src[2 * i + 1];
+	}
+}
+
+static void Reverse_C(uint8_t *dst, const uint8_t *src, int count)
+{
+	for (int i = 0; i < count; i++) {
+		dst[i] = src[count - 1 - i];
+	}
+}
+
+// Reverse the order of count CbCr pairs.
+static void ReverseUV16_C(uint8_t *dst, const uint8_t *src, int count)
+{
+	for (int i = 0; i < count; i++) {
+		dst[2 * i] = src[2 * (count - 1 - i)];
+		dst[2 * i + 1] = src[2 * (count - 1 - i) + 1];
+	}
+}
+
+static void ReverseDeinterleaveUV_C(uint8_t *u, uint8_t *v, const uint8_t *src, int count)
+{
+	for (int i = 0; i < count; i++) {
+		u[i] = src[2 * (count - 1 - i)];
+		v[i] = src[2 * (count - 1 - i) + 1];
+	}
+}
+
+static void TransposeTile_C(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride)
+{
+	for (int r = 0; r < 8; r++) {
+		for (int c = 0; c < 8; c++) {
+			dst[r * dstStride + c] = src[c * srcStride + r];
+		}
+	}
+}
+
+static void TransposeUVTile_C(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride)
+{
+	for (int r = 0; r < 8; r++) {
+		for (int c = 0; c < 8; c++) {
+			dstU[r * dstUStride + c] = src[c * srcStride + 2 * r];
+			dstV[r * dstVStride + c] = src[c * srcStride + 2 * r + 1];
+		}
+	}
+}
+
+
+#ifdef YUVCONVERTER_X86
+/******************************************************************************
+ * x86 implementations                                                        *
+ *****************************************************************************/
+
+static void CpuId(int info[4], int leaf, int subleaf)
+{
+#ifdef _MSC_VER
+	__cpuidex(info, leaf, subleaf);
+#else
+	__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+static bool CpuHasSse2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#else
+	int info[4];
+	CpuId(info, 1, 0);
+	return (info[3] & (1 << 26)) != 0;
+#endif
+}
+
+static bool CpuHasAvx2()
+{
+	int info[4];
+	CpuId(info, 0, 0);
+	if (info[0] < 7) return false;
+	CpuId(info, 1, 0);
+	// The OS must save the YMM registers on context switches (OSXSAVE + AVX).
+	if ((info[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28))) return false;
+#ifdef _MSC_VER
+	unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+	if ((xcr0 & 6) != 6) return false;
+	CpuId(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+
+static void InterleaveUV_SSE2(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i mu = _mm_loadu_si128((const __m128i *)(u + i));
+		__m128i mv = _mm_loadu_si128((const __m128i *)(v + i));
+		_mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(mu, mv));
+		_mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(mu, mv));
+	}
+	InterleaveUV_C(dst + 2 * i, u + i, v + i, count - i);
+}
+
+static void DeinterleaveUV_SSE2(uint8_t *u, uint8_t *v, const uint8_t *src, int count)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i x0 = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+		__m128i x1 = _mm_loadu_si128((const __m128i *)(src + 2 * i + 16));
+		_mm_storeu_si128((__m128i *)(u + i), _mm_packus_epi16(_mm_and_si128(x0, mask), _mm_and_si128(x1, mask)));
+		_mm_storeu_si128((__m128i *)(v + i), _mm_packus_epi16(_mm_srli_epi16(x0, 8), _mm_srli_epi16(x1, 8)));
+	}
+	DeinterleaveUV_C(u + i, v + i, src + 2 * i, count - i);
+}
+
+// Reverse the order of the 16-bit words, then of the bytes, of a register (SSE2 has no byte shuffle).
+static inline __m128i ReverseWords_SSE2(__m128i x)
+{
+	x = _mm_shufflelo_epi16(x, 0x1B);
+	x = _mm_shufflehi_epi16(x, 0x1B);
+	return _mm_shuffle_epi32(x, 0x4E);
+}
+
+static inline __m128i ReverseBytes_SSE2(__m128i x)
+{
+	return ReverseWords_SSE2(_mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+}
+
+static void Reverse_SSE2(uint8_t *dst, const uint8_t *src, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + count - 16 - i));
+		_mm_storeu_si128((__m128i *)(dst + i), ReverseBytes_SSE2(x));
+	}
+	Reverse_C(dst + i, src, count - i);
+}
+
+static void ReverseUV16_SSE2(uint8_t *dst, const uint8_t *src, int count)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * (count - 8 - i)));
+		_mm_storeu_si128((__m128i *)(dst + 2 * i), ReverseWords_SSE2(x));
+	}
+	ReverseUV16_C(dst + 2 * i, src, count - i);
+}
+
+static void ReverseDeinterleaveUV_SSE2(uint8_t *u, uint8_t *v, const uint8_t *src, int count)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		// The last 8 pairs of the block come first once reversed.
+		__m128i x0 = ReverseWords_SSE2(_mm_loadu_si128((const __m128i *)(src + 2 * (count - 8 - i))));
+		__m128i x1 = ReverseWords_SSE2(_mm_loadu_si128((const __m128i *)(src + 2 * (count - 16 - i))));
+		_mm_storeu_si128((__m128i *)(u + i), _mm_packus_epi16(_mm_and_si128(x0, mask), _mm_and_si128(x1, mask)));
+		_mm_storeu_si128((__m128i *)(v + i), _mm_packus_epi16(_mm_srli_epi16(x0, 8), _mm_srli_epi16(x1, 8)));
+	}
+	ReverseDeinterleaveUV_C(u + i, v + i, src, count - i);
+}
+
+// Transpose the 8x8 bytes held in the low halves of r0..r7 and store the 8 resulting rows.
+static inline void Transpose8x8Store_SSE2(__m128i r0, __m128i r1, __m128i r2, __m128i r3, __m128i r4, __m128i r5, __m128i r6, __m128i r7, uint8_t *dst, int dstStride)
+{
+	__m128i a0 = _mm_unpacklo_epi8(r0, r1);
+	__m128i a1 = _mm_unpacklo_epi8(r2, r3);
+	__m128i a2 = _mm_unpacklo_epi8(r4, r5);
+	__m128i a3 = _mm_unpacklo_epi8(r6, r7);
+	__m128i b0 = _mm_unpacklo_epi16(a0, a1);
+	__m128i b1 = _mm_unpackhi_epi16(a0, a1);
+	__m128i b2 = _mm_unpacklo_epi16(a2, a3);
+	__m128i b3 = _mm_unpackhi_epi16(a2, a3);
+	__m128i c0 = _mm_unpacklo_epi32(b0, b2);
+	__m128i c1 = _mm_unpackhi_epi32(b0, b2);
+	__m128i c2 = _mm_unpacklo_epi32(b1, b3);
+	__m128i c3 = _mm_unpackhi_epi32(b1, b3);
+	_mm_storel_epi64((__m128i *)(dst), c0);
+	_mm_storel_epi64((__m128i *)(dst + dstStride), _mm_srli_si128(c0, 8));
+	_mm_storel_epi64((__m128i *)(dst + 2 * dstStride), c1);
+	_mm_storel_epi64((__m128i *)(dst + 3 * dstStride), _mm_srli_si128(c1, 8));
+	_mm_storel_epi64((__m128i *)(dst + 4 * dstStride), c2);
+	_mm_storel_epi64((__m128i *)(dst + 5 * dstStride), _mm_srli_si128(c2, 8));
+	_mm_storel_epi64((__m128i *)(dst + 6 * dstStride), c3);
+	_mm_storel_epi64((__m128i *)(dst + 7 * dstStride), _mm_srli_si128(c3, 8));
+}
+
+static void TransposeTile_SSE2(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride)
+{
+	Transpose8x8Store_SSE2(
+		_mm_loadl_epi64((const __m128i *)(src)),
+		_mm_loadl_epi64((const __m128i *)(src + srcStride)),
+		_mm_loadl_epi64((const __m128i *)(src + 2 * srcStride)),
+		_mm_loadl_epi64((const __m128i *)(src + 3 * srcStride)),
+		_mm_loadl_epi64((const __m128i *)(src + 4 * srcStride)),
+		_mm_loadl_epi64((const __m128i *)(src + 5 * srcStride)),
+		_mm_loadl_epi64((const __m128i *)(src + 6 * srcStride)),
+		_mm_loadl_epi64((const __m128i *)(src + 7 * srcStride)),
+		dst, dstStride);
+}
+
+// De-interleave a row of 8 CbCr pairs: U in the low half, V in the high half.
+static inline __m128i LoadDeinterleavedUV_SSE2(const uint8_t *src)
+{
+	__m128i x = _mm_loadu_si128((const __m128i *)src);
+	return _mm_packus_epi16(_mm_and_si128(x, _mm_set1_epi16(0x00FF)), _mm_srli_epi16(x, 8));
+}
+
+static void TransposeUVTile_SSE2(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride)
+{
+	__m128i r0 = LoadDeinterleavedUV_SSE2(src);
+	__m128i r1 = LoadDeinterleavedUV_SSE2(src + srcStride);
+	__m128i r2 = LoadDeinterleavedUV_SSE2(src + 2 * srcStride);
+	__m128i r3 = LoadDeinterleavedUV_SSE2(src + 3 * srcStride);
+	__m128i r4 = LoadDeinterleavedUV_SSE2(src + 4 * srcStride);
+	__m128i r5 = LoadDeinterleavedUV_SSE2(src + 5 * srcStride);
+	__m128i r6 = LoadDeinterleavedUV_SSE2(src + 6 * srcStride);
+	__m128i r7 = LoadDeinterleavedUV_SSE2(src + 7 * srcStride);
+	Transpose8x8Store_SSE2(r0, r1, r2, r3, r4, r5, r6, r7, dstU, dstUStride);
+	Transpose8x8Store_SSE2(_mm_srli_si128(r0, 8), _mm_srli_si128(r1, 8), _mm_srli_si128(r2, 8), _mm_srli_si128(r3, 8),
+		_mm_srli_si128(r4, 8), _mm_srli_si128(r5, 8), _mm_srli_si128(r6, 8), _mm_srli_si128(r7, 8), dstV, dstVStride);
+}
+
+YUVCONVERTER_TARGET_AVX2 static void InterleaveUV_AVX2(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count)
+{
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		// Reorder the 64-bit lanes so that the per-128-bit-lane unpack produces contiguous output.
+		__m256i mu = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(u + i)), 0xD8);
+		__m256i mv = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(v + i)), 0xD8);
+		_mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_unpacklo_epi8(mu, mv));
+		_mm256_storeu_si256((__m256i *)(dst + 2 * i + 32), _mm256_unpackhi_epi8(mu, mv));
+	}
+	InterleaveUV_SSE2(dst + 2 * i, u + i, v + i, count - i);
+}
+#endif
+
+
+#ifdef YUVCONVERTER_NEON
+/******************************************************************************
+ * ARM NEON implementation                                                    *
+ *****************************************************************************/
+
+static void InterleaveUV_NEON(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x2_t uv;
+		uv.val[0] = vld1q_u8(u + i);
+		uv.val[1] = vld1q_u8(v + i);
+		vst2q_u8(dst + 2 * i, uv);
+	}
+	InterleaveUV_C(dst + 2 * i, u + i, v + i, count - i);
+}
+
+static void DeinterleaveUV_NEON(uint8_t *u, uint8_t *v, const uint8_t *src, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x2_t uv = vld2q_u8(src + 2 * i);
+		vst1q_u8(u + i, uv.val[0]);
+		vst1q_u8(v + i, uv.val[1]);
+	}
+	DeinterleaveUV_C(u + i, v + i, src + 2 * i, count - i);
+}
+
+static void Reverse_NEON(uint8_t *dst, const uint8_t *src, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t x = vrev64q_u8(vld1q_u8(src + count - 16 - i));
+		vst1q_u8(dst + i, vcombine_u8(vget_high_u8(x), vget_low_u8(x)));
+	}
+	Reverse_C(dst + i, src, count - i);
+}
+
+static void ReverseUV16_NEON(uint8_t *dst, const uint8_t *src, int count)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint16x8_t x = vrev64q_u16(vreinterpretq_u16_u8(vld1q_u8(src + 2 * (count - 8 - i))));
+		vst1q_u8(dst + 2 * i, vreinterpretq_u8_u16(vcombine_u16(vget_high_u16(x), vget_low_u16(x))));
+	}
+	ReverseUV16_C(dst + 2 * i, src, count - i);
+}
+
+static void ReverseDeinterleaveUV_NEON(uint8_t *u, uint8_t *v, const uint8_t *src, int count)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint8x8x2_t uv = vld2_u8(src + 2 * (count - 8 - i));
+		vst1_u8(u + i, vrev64_u8(uv.val[0]));
+		vst1_u8(v + i, vrev64_u8(uv.val[1]));
+	}
+	ReverseDeinterleaveUV_C(u + i, v + i, src, count - i);
+}
+
+// Transpose the 8x8 bytes held in r0..r7 and store the 8 resulting rows.
+static inline void Transpose8x8Store_NEON(uint8x8_t r0, uint8x8_t r1, uint8x8_t r2, uint8x8_t r3, uint8x8_t r4, uint8x8_t r5, uint8x8_t r6, uint8x8_t r7, uint8_t *dst, int dstStride)
+{
+	uint8x8x2_t s01 = vtrn_u8(r0, r1);
+	uint8x8x2_t s23 = vtrn_u8(r2, r3);
+	uint8x8x2_t s45 = vtrn_u8(r4, r5);
+	uint8x8x2_t s67 = vtrn_u8(r6, r7);
+	uint16x4x2_t t02 = vtrn_u16(vreinterpret_u16_u8(s01.val[0]), vreinterpret_u16_u8(s23.val[0]));
+	uint16x4x2_t t13 = vtrn_u16(vreinterpret_u16_u8(s01.val[1]), vreinterpret_u16_u8(s23.val[1]));
+	uint16x4x2_t t46 = vtrn_u16(vreinterpret_u16_u8(s45.val[0]), vreinterpret_u16_u8(s67.val[0]));
+	uint16x4x2_t t57 = vtrn_u16(vreinterpret_u16_u8(s45.val[1]), vreinterpret_u16_u8(s67.val[1]));
+	uint32x2x2_t q04 = vtrn_u32(vreinterpret_u32_u16(t02.val[0]), vreinterpret_u32_u16(t46.val[0]));
+	uint32x2x2_t q26 = vtrn_u32(vreinterpret_u32_u16(t02.val[1]), vreinterpret_u32_u16(t46.val[1]));
+	uint32x2x2_t q15 = vtrn_u32(vreinterpret_u32_u16(t13.val[0]), vreinterpret_u32_u16(t57.val[0]));
+	uint32x2x2_t q37 = vtrn_u32(vreinterpret_u32_u16(t13.val[1]), vreinterpret_u32_u16(t57.val[1]));
+	vst1_u8(dst, vreinterpret_u8_u32(q04.val[0]));
+	vst1_u8(dst + dstStride, vreinterpret_u8_u32(q15.val[0]));
+	vst1_u8(dst + 2 * dstStride, vreinterpret_u8_u32(q26.val[0]));
+	vst1_u8(dst + 3 * dstStride, vreinterpret_u8_u32(q37.val[0]));
+	vst1_u8(dst + 4 * dstStride, vreinterpret_u8_u32(q04.val[1]));
+	vst1_u8(dst + 5 * dstStride, vreinterpret_u8_u32(q15.val[1]));
+	vst1_u8(dst + 6 * dstStride, vreinterpret_u8_u32(q26.val[1]));
+	vst1_u8(dst + 7 * dstStride, vreinterpret_u8_u32(q37.val[1]));
+}
+
+static void TransposeTile_NEON(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride)
+{
+	Transpose8x8Store_NEON(vld1_u8(src), vld1_u8(src + srcStride), vld1_u8(src + 2 * srcStride), vld1_u8(src + 3 * srcStride),
+		vld1_u8(src + 4 * srcStride), vld1_u8(src + 5 * srcStride), vld1_u8(src + 6 * srcStride), vld1_u8(src + 7 * srcStride),
+		dst, dstStride);
+}
+
+static void TransposeUVTile_NEON(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride)
+{
+	uint8x8x2_t r0 = vld2_u8(src);
+	uint8x8x2_t r1 = vld2_u8(src + srcStride);
+	uint8x8x2_t r2 = vld2_u8(src + 2 * srcStride);
+	uint8x8x2_t r3 = vld2_u8(src + 3 * srcStride);
+	uint8x8x2_t r4 = vld2_u8(src + 4 * srcStride);
+	uint8x8x2_t r5 = vld2_u8(src + 5 * srcStride);
+	uint8x8x2_t r6 = vld2_u8(src + 6 * srcStride);
+	uint8x8x2_t r7 = vld2_u8(src + 7 * srcStride);
+	Transpose8x8Store_NEON(r0.val[0], r1.val[0], r2.val[0], r3.val[0], r4.val[0], r5.val[0], r6.val[0], r7.val[0], dstU, dstUStride);
+	Transpose8x8Store_NEON(r0.val[1], r1.val[1], r2.val[1], r3.val[1], r4.val[1], r5.val[1], r6.val[1], r7.val[1], dstV, dstVStride);
+}
+#endif
+
+
+
+YuvConverter::Kernels YuvConverter::SelectImplementation()
+{
+	Kernels kernels = { InterleaveUV_C, DeinterleaveUV_C, TransposeTile_C, TransposeUVTile_C, Reverse_C, ReverseUV16_C, ReverseDeinterleaveUV_C, "C" };
+#if defined(YUVCONVERTER_X86)
+	if (CpuHasSse2()) {
+		kernels.interleaveUV = InterleaveUV_SSE2;
+		kernels.deinterleaveUV = DeinterleaveUV_SSE2;
+		kernels.transposeTile = TransposeTile_SSE2;
+		kernels.transposeUVTile = TransposeUVTile_SSE2;
+		kernels.reverse = Reverse_SSE2;
+		kernels.reverseUV16 = ReverseUV16_SSE2;
+		kernels.reverseDeinterleaveUV = ReverseDeinterleaveUV_SSE2;
+		kernels.name = "SSE2";
+		if (CpuHasAvx2()) {
+			kernels.interleaveUV = InterleaveUV_AVX2;
+			kernels.name = "AVX2";
+		}
+	}
+#elif defined(YUVCONVERTER_NEON)
+	kernels.interleaveUV = InterleaveUV_NEON;
+	kernels.deinterleaveUV = DeinterleaveUV_NEON;
+	kernels.transposeTile = TransposeTile_NEON;
+	kernels.transposeUVTile = TransposeUVTile_NEON;
+	kernels.reverse = Reverse_NEON;
+	kernels.reverseUV16 = ReverseUV16_NEON;
+	kernels.reverseDeinterleaveUV = ReverseDeinterleaveUV_NEON;
+	kernels.name = "NEON";
+#endif
+	return kernels;
+}
+
+const YuvConverter::Kernels & YuvConverter::GetKernels()
+{
+	// The initialization of a function-local static is thread-safe, unlike a lazily filled table of pointers.
+	static const Kernels kernels = SelectImplementation();
+	return kernels;
+}
+
+const char * YuvConverter::GetImplementationName()
+{
+	return GetKernels().name;
+}
+
+void YuvConverter::InterleaveUV(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count)
+{
+	GetKernels().interleaveUV(dst, u, v, count);
+}
+
+void YuvConverter::I420ToNV12(const uint8_t *srcY, int srcYStride, const uint8_t *srcU, int srcUStride, const uint8_t *srcV, int srcVStride,
+	uint8_t *dstY, int dstYPitch, uint8_t *dstUV, int dstUVPitch, int width, int height)
+{
+	const Kernels &kernels = GetKernels();
+	int chromaWidth = width / 2;
+	int chromaHeight = height / 2;
+	RunSlices(width, height, [=](int first, int last) {
+		// Each tile holds TileRows luma rows and the TileRows / 2 chroma rows that go with them.
+		for (int row = first; row < last; row += TileRows) {
+			int rows = ((row + TileRows) <= last) ? TileRows : (last - row);
+			for (int i = row; i < row + rows; i++) {
+				memcpy(dstY + i * dstYPitch, srcY + i * srcYStride, width);
+			}
+			int chromaEnd = (row + rows) / 2;
+			if (chromaEnd > chromaHeight) chromaEnd = chromaHeight;
+			for (int i = row / 2; i < chromaEnd; i++) {
+				kernels.interleaveUV(dstUV + i * dstUVPitch, srcU + i * srcUStride, srcV + i * srcVStride, chromaWidth);
+			}
+		}
+	});
+}
+
+YuvConverter::YuvPlanes YuvConverter::I420Planes(uint8_t *y, int yStride, uint8_t *u, int uStride, uint8_t *v, int vStride, int width, int height)
+{
+	YuvPlanes planes = { y, yStride, u, uStride, v, vStride, 1, width, height };
+	return planes;
+}
+
+YuvConverter::YuvPlanes YuvConverter::NV12Planes(uint8_t *y, int yStride, uint8_t *uv, int uvStride, int width, int height)
+{
+	YuvPlanes planes = { y, yStride, uv, uvStride, uv + 1, uvStride, 2, width, height };
+	return planes;
+}
+
+void YuvConverter::NV12ToI420Rotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+	uint8_t *dstY, int dstYStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height, int rotation)
+{
+	bool transpose, flipX, flipY;
+	GetOrientation(rotation, transpose, flipX, flipY);
+	NV12ToI420ScaleRotate(srcY, srcYStride, srcUV, srcUVStride, transpose ? height : width, transpose ? width : height,
+		dstY, dstYStride, dstU, dstUStride, dstV, dstVStride, width, height, rotation);
+}
+
+void YuvConverter::NV12Rotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+	uint8_t *dstY, int dstYStride, uint8_t *dstUV, int dstUVStride, int width, int height, int rotation)
+{
+	bool transpose, flipX, flipY;
+	GetOrientation(rotation, transpose, flipX, flipY);
+	NV12ScaleRotate(srcY, srcYStride, srcUV, srcUVStride, transpose ? height : width, transpose ? width : height,
+		dstY, dstYStride, dstUV, dstUVStride, width, height, rotation);
+}
+
+void YuvConverter::NV12ToI420ScaleRotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+	uint8_t *dstY, int dstYStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height, int rotation, bool mirror)
+{
+	YuvPlanes dst = I420Planes(dstY, dstYStride, dstU, dstUStride, dstV, dstVStride, width, height);
+	RunSlices(width, height, MakeConversionJob(srcY, srcYStride, srcUV, srcUVStride, srcWidth, srcHeight, dst, rotation, mirror));
+}
+
+void YuvConverter::NV12ScaleRotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+	uint8_t *dstY, int dstYStride, uint8_t *dstUV, int dstUVStride, int width, int height, int rotation, bool mirror)
+{
+	YuvPlanes dst = NV12Planes(dstY, dstYStride, dstUV, dstUVStride, width, height);
+	RunSlices(width, height, MakeConversionJob(srcY, srcYStride, srcUV, srcUVStride, srcWidth, srcHeight, dst, rotation, mirror));
+}
+
+void YuvConverter::NV12ToPyramid(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+	const YuvPlanes *levels, int levelCount, int rotation, bool mirror)
+{
+	if (levelCount > MaxPyramidLevels) levelCount = MaxPyramidLevels;
+	SliceWorkerPool::SliceJob job = MakeConversionJob(srcY, srcYStride, srcUV, srcUVStride, srcWidth, srcHeight, levels[0], rotation, mirror);
+	RunSlices(levels[0].width, levels[0].height, [&](int first, int last) {
+		for (int row = first; row < last; row += TileRows) {
+			int rowEnd = ((row + TileRows) < last) ? (row + TileRows) : last;
+			job(row, rowEnd);
+			// The rows that have just been written are still in cache, reduce them right away.
+			for (int i = 1; i < levelCount; i++) {
+				HalveRows(levels[i - 1], levels[i], row >> (i - 1), rowEnd >> (i - 1));
+			}
+		}
+	});
+}
+
+bool YuvConverter::NV12ToPyramidOrCopy(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+	const YuvPlanes *levels, int levelCount, int rotation, bool mirror)
+{
+	const YuvPlanes &dst = levels[0];
+	if ((levelCount != 1) || (rotation != 0) || mirror || (dst.uvStep != 2) || (dst.width != srcWidth) || (dst.height != srcHeight)) {
+		NV12ToPyramid(srcY, srcYStride, srcUV, srcUVStride, srcWidth, srcHeight, levels, levelCount, rotation, mirror);
+		return false;
+	}
+	int uvBytes = srcWidth & ~1;
+	if ((srcYStride == srcWidth) && (dst.yStride == srcWidth) && (srcUV == srcY + srcWidth * srcHeight) && (dst.u == dst.y + srcWidth * srcHeight)
+		&& (srcUVStride == uvBytes) && (dst.uStride == uvBytes)) {
+		// Both pictures are contiguous, as the camera buffers and the mediastreamer2 ones are.
+		memcpy(dst.y, srcY, (size_t)srcWidth * srcHeight + (size_t)uvBytes * (srcHeight / 2));
+		return true;
+	}
+	for (int row = 0; row < srcHeight; row++) {
+		memcpy(dst.y + row * dst.yStride, srcY + row * srcYStride, srcWidth);
+	}
+	for (int row = 0; row < srcHeight / 2; row++) {
+		memcpy(dst.u + row * dst.uStride, srcUV + row * srcUVStride, uvBytes);
+	}
+	return true;
+}
+
+// first and last are luma rows of src. A tile of TileRows rows gives whole chroma rows down to the fourth level.
+void YuvConverter::HalveRows(const YuvPlanes &src, const YuvPlanes &dst, int first, int last)
+{
+	HalvePlane(src.y, src.yStride, 1, dst.y, dst.yStride, 1, dst.width, first / 2, last / 2);
+	HalvePlane(src.u, src.uStride, src.uvStep, dst.u, dst.uStride, dst.uvStep, dst.width / 2, first / 4, last / 4);
+	HalvePlane(src.v, src.vStride, src.uvStep, dst.v, dst.vStride, dst.uvStep, dst.width / 2, first / 4, last / 4);
+}
+
+// Build the job converting the destination rows [first, last), so that it can be split in slices or interleaved with other work.
+SliceWorkerPool::SliceJob YuvConverter::MakeConversionJob(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+	int srcWidth, int srcHeight, const YuvPlanes &dst, int rotation, bool mirror)
+{
+	bool transpose, flipX, flipY;
+	GetOrientation(rotation, transpose, flipX, flipY);
+	// Mirroring the rotated picture is flipping its columns.
+	if (mirror) flipX = !flipX;
+	int width = dst.width;
+	int height = dst.height;
+	int chromaWidth = width / 2;
+	int chromaHeight = height / 2;
+	uint8_t *dstY = dst.y;
+	uint8_t *dstU = dst.u;
+	uint8_t *dstV = dst.v;
+	int dstYStride = dst.yStride;
+	int dstUStride = dst.uStride;
+	int dstVStride = dst.vStride;
+	int dstUVStep = dst.uvStep;
+
+	if ((width == (transpose ? srcHeight : srcWidth)) && (height == (transpose ? srcWidth : srcHeight))) {
+		if (!transpose) {
+			// dst(x, y) = src(flipX ? width - 1 - x : x, flipY ? height - 1 - y : y)
+			if (flipY) {
+				srcY += (height - 1) * srcYStride;
+				srcYStride = -srcYStride;
+				srcUV += (chromaHeight - 1) * srcUVStride;
+				srcUVStride = -srcUVStride;
+			}
+			return [=](int first, int last) {
+				CopyPlane(srcY + first * srcYStride, srcYStride, dstY + first * dstYStride, dstYStride, width, last - first, flipX);
+				if (dstUVStep == 1) {
+					CopyUVPlane(srcUV + (first / 2) * srcUVStride, srcUVStride, dstU + (first / 2) * dstUStride, dstUStride,
+						dstV + (first / 2) * dstVStride, dstVStride, chromaWidth, (last / 2) - (first / 2), flipX);
+				} else {
+					// The CbCr pairs are moved as 16-bit samples.
+					CopyUV16Plane(srcUV + (first / 2) * srcUVStride, srcUVStride, dstU + (first / 2) * dstUStride, dstUStride,
+						chromaWidth, (last / 2) - (first / 2), flipX);
+				}
+			};
+		}
+
+		// dst(x, y) = src(flipY ? height - 1 - y : y, flipX ? width - 1 - x : x), the source having width rows.
+		// Walking the source rows and the destination rows backwards reduces both flips to a plain transpose.
+		if (flipX) {
+			srcY += (width - 1) * srcYStride;
+			srcYStride = -srcYStride;
+			srcUV += (chromaWidth - 1) * srcUVStride;
+			srcUVStride = -srcUVStride;
+		}
+		if (flipY) {
+			dstY += (height - 1) * dstYStride;
+			dstYStride = -dstYStride;
+			dstU += (chromaHeight - 1) * dstUStride;
+			dstUStride = -dstUStride;
+			dstV += (chromaHeight - 1) * dstVStride;
+			dstVStride = -dstVStride;
+		}
+		// A slice of destination rows is a slice of source columns. The range is given in actual destination rows,
+		// so it is mirrored when the destination is walked backwards.
+		return [=](int first, int last) {
+			int lumaFirst = flipY ? (height - last) : first;
+			int lumaLast = flipY ? (height - first) : last;
+			int chromaFirst = flipY ? (chromaHeight - (last / 2)) : (first / 2);
+			int chromaLast = flipY ? (chromaHeight - (first / 2)) : (last / 2);
+			TransposePlane(srcY + lumaFirst, srcYStride, dstY + lumaFirst * dstYStride, dstYStride, width, lumaLast - lumaFirst);
+			if (dstUVStep == 1) {
+				TransposeUVPlane(srcUV + 2 * chromaFirst, srcUVStride, dstU + chromaFirst * dstUStride, dstUStride,
+					dstV + chromaFirst * dstVStride, dstVStride, chromaWidth, chromaLast - chromaFirst);
+			} else {
+				TransposeUV16Plane(srcUV + 2 * chromaFirst, srcUVStride, dstU + chromaFirst * dstUStride, dstUStride,
+					chromaWidth, chromaLast - chromaFirst);
+			}
+		};
+	}
+
+	if (!transpose && !flipX && (srcWidth == 2 * width) && (srcHeight == 2 * height) && ((width % 2) == 0) && ((height % 2) == 0)) {
+		if (flipY) {
+			srcY += (srcHeight - 1) * srcYStride;
+			srcYStride = -srcYStride;
+			srcUV += ((srcHeight / 2) - 1) * srcUVStride;
+			srcUVStride = -srcUVStride;
+		}
+		return [=](int first, int last) {
+			HalvePlane(srcY, srcYStride, 1, dstY, dstYStride, 1, width, first, last);
+			HalvePlane(srcUV, srcUVStride, 2, dstU, dstUStride, dstUVStep, chromaWidth, first / 2, last / 2);
+			HalvePlane(srcUV + 1, srcUVStride, 2, dstV, dstVStride, dstUVStep, chromaWidth, first / 2, last / 2);
+		};
+	}
+
+	// The destination columns follow the source columns, or the source rows when transposing. The flips are folded in the taps.
+	int colSrcCount = transpose ? srcHeight : srcWidth;
+	int rowSrcCount = transpose ? srcWidth : srcHeight;
+	std::shared_ptr<std::vector<ScaleTap>> taps = std::make_shared<std::vector<ScaleTap>>(2 * (width + height));
+	ScaleTap *colTaps = taps->data();
+	ScaleTap *rowTaps = colTaps + width;
+	ScaleTap *chromaColTaps = rowTaps + height;
+	ScaleTap *chromaRowTaps = chromaColTaps + width;
+	BuildScaleTaps(colTaps, width, colSrcCount, flipX, transpose ? srcYStride : 1);
+	BuildScaleTaps(rowTaps, height, rowSrcCount, flipY, transpose ? 1 : srcYStride);
+	BuildScaleTaps(chromaColTaps, chromaWidth, colSrcCount / 2, flipX, transpose ? srcUVStride : 2);
+	BuildScaleTaps(chromaRowTaps, chromaHeight, rowSrcCount / 2, flipY, transpose ? 2 : srcUVStride);
+	return [=](int first, int last) {
+		(void)taps;
+		ScalePlane(srcY, colTaps, rowTaps, dstY, dstYStride, 1, width, first, last, transpose);
+		ScalePlane(srcUV, chromaColTaps, chromaRowTaps, dstU, dstUStride, dstUVStep, chromaWidth, first / 2, last / 2, transpose);
+		ScalePlane(srcUV + 1, chromaColTaps, chromaRowTaps, dstV, dstVStride, dstUVStep, chromaWidth, first / 2, last / 2, transpose);
+	};
+}
+
+// The centers of the samples are aligned: src = (dst + 0.5) * srcCount / dstCount - 0.5, computed in 16.16 fixed point.
+// For a 2:1 reduction both neighbours get a weight of 128, which is the 2x2 box filter.
+void YuvConverter::BuildScaleTaps(ScaleTap *taps, int dstCount, int srcCount, bool flip, int step)
+{
+	for (int i = 0; i < dstCount; i++) {
+		int64_t pos = ((((int64_t)(2 * i + 1) * srcCount) << 16) / (2 * dstCount)) - 32768;
+		int index = 0;
+		int weight = 0;
+		if (pos > 0) {
+			index = (int)(pos >> 16);
+			weight = (int)((pos >> 8) & 0xFF);
+		}
+		int next = ((index + 1) < srcCount) ? (index + 1) : (srcCount - 1);
+		ScaleTap &tap = taps[flip ? (dstCount - 1 - i) : i];
+		tap.offset0 = index * step;
+		tap.offset1 = next * step;
+		tap.weight = weight;
+	}
+}
+
+// Bilinear filter driven by the taps, whose offsets already include the source strides.
+void YuvConverter::ScalePlane(const uint8_t *src, const ScaleTap *colTaps, const ScaleTap *rowTaps, uint8_t *dst, int dstStride, int dstStep,
+	int width, int first, int last, bool transpose)
+{
+	// When transposing, consecutive destination columns walk down the source: work by blocks so that the source lines stay in cache.
+	int blockWidth = transpose ? ScaleBlockSize : width;
+	for (int by = first; by < last; by += TileRows) {
+		int byEnd = ((by + TileRows) < last) ? (by + TileRows) : last;
+		for (int bx = 0; bx < width; bx += blockWidth) {
+			int bxEnd = ((bx + blockWidth) < width) ? (bx + blockWidth) : width;
+			for (int y = by; y < byEnd; y++) {
+				const uint8_t *line0 = src + rowTaps[y].offset0;
+				const uint8_t *line1 = src + rowTaps[y].offset1;
+				int wy = rowTaps[y].weight;
+				uint8_t *d = dst + y * dstStride;
+				for (int x = bx; x < bxEnd; x++) {
+					const ScaleTap &tap = colTaps[x];
+					int top = line0[tap.offset0] * (256 - tap.weight) + line0[tap.offset1] * tap.weight;
+					int bottom = line1[tap.offset0] * (256 - tap.weight) + line1[tap.offset1] * tap.weight;
+					d[x * dstStep] = (uint8_t)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+				}
+			}
+		}
+	}
+}
+
+// Exact 2:1 reduction: average of 2x2 source samples, srcStep being the distance between two samples of a row.
+// With the steps known at compile time the compiler vectorizes the row, which it does not do for variable steps.
+template <int SRC_STEP, int DST_STEP>
+static void HalveRow(const uint8_t *s0, const uint8_t *s1, uint8_t *d, int width)
+{
+	for (int x = 0; x < width; x++) {
+		int a = 2 * x * SRC_STEP;
+		int b = a + SRC_STEP;
+		d[x * DST_STEP] = (uint8_t)((s0[a] + s0[b] + s1[a] + s1[b] + 2) >> 2);
+	}
+}
+
+void YuvConverter::HalvePlane(const uint8_t *src, int srcStride, int srcStep, uint8_t *dst, int dstStride, int dstStep, int width, int first, int last)
+{
+	// Luma and I420 chroma planes have a step of 1, NV12 chroma planes a step of 2.
+	void (*halveRow)(const uint8_t *, const uint8_t *, uint8_t *, int) = nullptr;
+	if ((srcStep == 1) && (dstStep == 1)) halveRow = HalveRow<1, 1>;
+	else if ((srcStep == 2) && (dstStep == 2)) halveRow = HalveRow<2, 2>;
+	else if ((srcStep == 2) && (dstStep == 1)) halveRow = HalveRow<2, 1>;
+	else if ((srcStep == 1) && (dstStep == 2)) halveRow = HalveRow<1, 2>;
+	for (int y = first; y < last; y++) {
+		const uint8_t *s0 = src + 2 * y * srcStride;
+		const uint8_t *s1 = s0 + srcStride;
+		uint8_t *d = dst + y * dstStride;
+		if (halveRow) {
+			halveRow(s0, s1, d, width);
+			continue;
+		}
+		for (int x = 0; x < width; x++) {
+			int a = 2 * x * srcStep;
+			int b = a + srcStep;
+			d[x * dstStep] = (uint8_t)((s0[a] + s0[b] + s1[a] + s1[b] + 2) >> 2);
+		}
+	}
+}
+
+// Slices are made of whole tiles so that they keep an even number of luma rows and stay aligned on the SIMD tiles.
+void YuvConverter::RunSlices(int width, int height, const SliceWorkerPool::SliceJob &job)
+{
+	if (SliceWorkerPool::ShouldParallelize(width, height)) {
+		SliceWorkerPool::GetInstance()->Run(height, TileRows, job);
+	} else {
+		job(0, height);
+	}
+}
+
+void YuvConverter::GetOrientation(int rotation, bool &transpose, bool &flipX, bool &flipY)
+{
+	rotation = ((rotation % 360) + 360) % 360;
+	transpose = (rotation == 90) || (rotation == 270);
+	flipX = (rotation == 90) || (rotation == 180);
+	flipY = (rotation == 180) || (rotation == 270);
+}
+
+void YuvConverter::CopyPlane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, bool flipX)
+{
+	const Kernels &kernels = GetKernels();
+	for (int i = 0; i < height; i++) {
+		const uint8_t *s = src + i * srcStride;
+		uint8_t *d = dst + i * dstStride;
+		if (flipX) {
+			kernels.reverse(d, s, width);
+		} else {
+			memcpy(d, s, width);
+		}
+	}
+}
+
+void YuvConverter::CopyUVPlane(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height, bool flipX)
+{
+	const Kernels &kernels = GetKernels();
+	for (int i = 0; i < height; i++) {
+		const uint8_t *s = src + i * srcStride;
+		uint8_t *u = dstU + i * dstUStride;
+		uint8_t *v = dstV + i * dstVStride;
+		if (flipX) {
+			kernels.reverseDeinterleaveUV(u, v, s, width);
+		} else {
+			kernels.deinterleaveUV(u, v, s, width);
+		}
+	}
+}
+
+// dst(x, y) = src(y, x): the source has width rows of height samples.
+void YuvConverter::TransposePlane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height)
+{
+	const Kernels &kernels = GetKernels();
+	const int ts = TransposeTileSize;
+	const int bs = TransposeBlockSize;
+	int tiledWidth = width - (width % ts);
+	int tiledHeight = height - (height % ts);
+	for (int bx = 0; bx < tiledWidth; bx += bs) {
+		int bxEnd = ((bx + bs) < tiledWidth) ? (bx + bs) : tiledWidth;
+		for (int by = 0; by < tiledHeight; by += bs) {
+			int byEnd = ((by + bs) < tiledHeight) ? (by + bs) : tiledHeight;
+			for (int x = bx; x < bxEnd; x += ts) {
+				for (int y = by; y < byEnd; y += ts) {
+					kernels.transposeTile(src + x * srcStride + y, srcStride, dst + y * dstStride + x, dstStride);
+				}
+			}
+		}
+	}
+	for (int y = 0; y < height; y++) {
+		int xStart = (y < tiledHeight) ? tiledWidth : 0;
+		for (int x = xStart; x < width; x++) {
+			dst[y * dstStride + x] = src[x * srcStride + y];
+		}
+	}
+}
+
+// dstU(x, y) = src(2 * y, x), dstV(x, y) = src(2 * y + 1, x): the source has width rows of height CbCr pairs.
+void YuvConverter::TransposeUVPlane(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height)
+{
+	const Kernels &kernels = GetKernels();
+	const int ts = TransposeTileSize;
+	const int bs = TransposeBlockSize;
+	int tiledWidth = width - (width % ts);
+	int tiledHeight = height - (height % ts);
+	for (int bx = 0; bx < tiledWidth; bx += bs) {
+		int bxEnd = ((bx + bs) < tiledWidth) ? (bx + bs) : tiledWidth;
+		for (int by = 0; by < tiledHeight; by += bs) {
+			int byEnd = ((by + bs) < tiledHeight) ? (by + bs) : tiledHeight;
+			for (int x = bx; x < bxEnd; x += ts) {
+				for (int y = by; y < byEnd; y += ts) {
+					kernels.transposeUVTile(src + x * srcStride + 2 * y, srcStride, dstU + y * dstUStride + x, dstUStride, dstV + y * dstVStride + x, dstVStride);
+				}
+			}
+		}
+	}
+	for (int y = 0; y < height; y++) {
+		int xStart = (y < tiledHeight) ? tiledWidth : 0;
+		for (int x = xStart; x < width; x++) {
+			dstU[y * dstUStride + x] = src[x * srcStride + 2 * y];
+			dstV[y * dstVStride + x] = src[x * srcStride + 2 * y + 1];
+		}
+	}
+}
+
+void YuvConverter::CopyUV16Plane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, bool flipX)
+{
+	const Kernels &kernels = GetKernels();
+	for (int i = 0; i < height; i++) {
+		const uint8_t *s = src + i * srcStride;
+		uint8_t *d = dst + i * dstStride;
+		if (flipX) {
+			kernels.reverseUV16(d, s, width);
+		} else {
+			memcpy(d, s, 2 * width);
+		}
+	}
+}
+
+// dst(x, y) = src(y, x) on CbCr pairs: the source has width rows of height pairs.
+void YuvConverter::TransposeUV16Plane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height)
+{
+	const int bs = TransposeBlockSize / 2;
+	for (int bx = 0; bx < width; bx += bs) {
+		int bxEnd = ((bx + bs) < width) ? (bx + bs) : width;
+		for (int by = 0; by < height; by += bs) {
+			int byEnd = ((by + bs) < height) ? (by + bs) : height;
+			for (int y = by; y < byEnd; y++) {
+				uint8_t *d = dst + y * dstStride;
+				for (int x = bx; x < bxEnd; x++) {
+					d[2 * x] = src[x * srcStride + 2 * y];
+					d[2 * x + 1] = src[x * srcStride + 2 * y + 1];
+				}
+			}
+		}
+	}
+}
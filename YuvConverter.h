@@ -0,0 +1,155 @@
+/*
+YuvConverter.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "SliceWorkerPool.h"
+
+
+namespace libmswinrtvid
+{
+	/// <summary>
+	/// Pixel format conversion kernels used by the capture and display filters.
+	/// The SIMD implementation (SSE2, AVX2 or NEON) is selected at runtime, with a scalar fallback.
+	/// Frames above the SliceWorkerPool threshold are converted by horizontal slices on the shared worker pool.
+	/// </summary>
+	class YuvConverter
+	{
+	public:
+		/// Interleave count samples of the U and V planes into a semi-planar UV row (U first).
+		static void InterleaveUV(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count);
+
+		/// Convert an I420 picture to NV12. Source strides and destination pitches are independent so that padded
+		/// destinations (eg. locked IMF2DBuffer2) can be written directly. As in mediastreamer2, the chroma planes
+		/// are (width / 2) x (height / 2). Rows are processed by tiles so that a tile stays cache resident.
+		static void I420ToNV12(const uint8_t *srcY, int srcYStride, const uint8_t *srcU, int srcUStride, const uint8_t *srcV, int srcVStride,
+			uint8_t *dstY, int dstYPitch, uint8_t *dstUV, int dstUVPitch, int width, int height);
+
+		/// Convert a NV12 camera frame to I420 while rotating it clockwise by 0, 90, 180 or 270 degrees.
+		/// width and height are the dimensions of the destination picture, the source dimensions are swapped for 90 and 270.
+		/// The rotated cases are handled by 64x64 cache blocks made of 8x8 SIMD transposes, de-interleaving CbCr on the fly.
+		static void NV12ToI420Rotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+			uint8_t *dstY, int dstYStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height, int rotation);
+
+		/// Copy a NV12 camera frame to a NV12 picture while rotating it clockwise by 0, 90, 180 or 270 degrees.
+		/// width and height are the dimensions of the destination picture. With no rotation this is a plain copy.
+		static void NV12Rotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+			uint8_t *dstY, int dstYStride, uint8_t *dstUV, int dstUVStride, int width, int height, int rotation);
+
+		/// Convert a NV12 camera frame of srcWidth x srcHeight to a width x height I420 picture, rotating and scaling it in the same pass.
+		/// srcWidth and srcHeight are the dimensions before rotation. Exact 2:1 reductions use a 2x2 box filter, other ratios a
+		/// bilinear filter. When no scaling is needed this is NV12ToI420Rotate. With mirror, the rotated picture is also flipped
+		/// horizontally, which only changes the direction in which the rows are walked.
+		static void NV12ToI420ScaleRotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+			uint8_t *dstY, int dstYStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height, int rotation, bool mirror = false);
+
+		/// Same as NV12ToI420ScaleRotate with a NV12 destination picture.
+		static void NV12ScaleRotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+			uint8_t *dstY, int dstYStride, uint8_t *dstUV, int dstUVStride, int width, int height, int rotation, bool mirror = false);
+
+		/// Planes of a destination picture. For NV12, u and v point in the same interleaved plane and uvStep is 2.
+		struct YuvPlanes {
+			uint8_t *y;
+			int yStride;
+			uint8_t *u;
+			int uStride;
+			uint8_t *v;
+			int vStride;
+			int uvStep;
+			int width;
+			int height;
+		};
+
+		static YuvPlanes I420Planes(uint8_t *y, int yStride, uint8_t *u, int uStride, uint8_t *v, int vStride, int width, int height);
+		static YuvPlanes NV12Planes(uint8_t *y, int yStride, uint8_t *uv, int uvStride, int width, int height);
+
+		static const int MaxPyramidLevels = 3;
+
+		/// Convert, rotate and scale a NV12 camera frame into levels[0], then fill each following level with a 2:1 box reduction of
+		/// the previous one. Each level must be half the size of the previous one (rounded down). The reductions are computed tile
+		/// by tile, right after the rows they read have been converted, so that they are taken from the cache and not from memory.
+		static void NV12ToPyramid(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+			const YuvPlanes *levels, int levelCount, int rotation, bool mirror = false);
+
+		/// NV12ToPyramid, unless the frame can be passed through: when there is a single level, a NV12 picture of the size of the
+		/// camera frame, with neither rotation nor mirroring, the rows are copied as they are and no conversion is done.
+		/// Returns true if the frame has been passed through.
+		static bool NV12ToPyramidOrCopy(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight,
+			const YuvPlanes *levels, int levelCount, int rotation, bool mirror = false);
+
+		/// Name of the implementation selected for the running CPU, for logging purpose.
+		static const char * GetImplementationName();
+
+	private:
+		typedef void (*InterleaveUVFunc)(uint8_t *dst, const uint8_t *u, const uint8_t *v, int count);
+		typedef void (*DeinterleaveUVFunc)(uint8_t *u, uint8_t *v, const uint8_t *src, int count);
+		typedef void (*ReverseFunc)(uint8_t *dst, const uint8_t *src, int count);
+		typedef void (*TransposeTileFunc)(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride);
+		typedef void (*TransposeUVTileFunc)(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride);
+
+		/// Source samples used for one destination row or column: the offsets of the two neighbours and the 8-bit weight of the second one.
+		struct ScaleTap {
+			int offset0;
+			int offset1;
+			int weight;
+		};
+
+		static const int TileRows = 16;
+		static const int TransposeTileSize = 8;
+		static const int TransposeBlockSize = 64;
+		static const int ScaleBlockSize = 64;
+
+		static void CopyPlane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, bool flipX);
+		static void CopyUVPlane(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height, bool flipX);
+		static void TransposePlane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height);
+		static void TransposeUVPlane(const uint8_t *src, int srcStride, uint8_t *dstU, int dstUStride, uint8_t *dstV, int dstVStride, int width, int height);
+		static void CopyUV16Plane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height, bool flipX);
+		static void TransposeUV16Plane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height);
+		static void BuildScaleTaps(ScaleTap *taps, int dstCount, int srcCount, bool flip, int step);
+		static void ScalePlane(const uint8_t *src, const ScaleTap *colTaps, const ScaleTap *rowTaps, uint8_t *dst, int dstStride, int dstStep,
+			int width, int first, int last, bool transpose);
+		static void HalvePlane(const uint8_t *src, int srcStride, int srcStep, uint8_t *dst, int dstStride, int dstStep, int width, int first, int last);
+		static void HalveRows(const YuvPlanes &src, const YuvPlanes &dst, int first, int last);
+		static SliceWorkerPool::SliceJob MakeConversionJob(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+			int srcWidth, int srcHeight, const YuvPlanes &dst, int rotation, bool mirror);
+		static void GetOrientation(int rotation, bool &transpose, bool &flipX, bool &flipY);
+		static void RunSlices(int width, int height, const SliceWorkerPool::SliceJob &job);
+
+		/// Kernels of the implementation selected for the running CPU.
+		struct Kernels {
+			InterleaveUVFunc interleaveUV;
+			DeinterleaveUVFunc deinterleaveUV;
+			TransposeTileFunc transposeTile;
+			TransposeUVTileFunc transposeUVTile;
+			ReverseFunc reverse;
+			ReverseFunc reverseUV16;
+			DeinterleaveUVFunc reverseDeinterleaveUV;
+			const char *name;
+		};
+
+		/// The selection is done once, by the first caller, and is then seen complete by all the threads.
+		static const Kernels & GetKernels();
+		static Kernels SelectImplementation();
+	};
+}
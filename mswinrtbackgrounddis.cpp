@@ -30,7 +30,8 @@ using namespace libmswinrtvid;
 
 
 MSWinRTBackgroundDis::MSWinRTBackgroundDis()
-	: mIsActivated(false), mIsStarted(false)
+	: mIsActivated(false), mIsStarted(false), mAsyncConversion(false), mUseFrameTimestamps(false), mConversionStage(ConversionQueueDepth, freemsg),
+	mDejitter(false), mDejitterBuffer(DejitterCapacity, freemsg), mReportedDrops(0)
 {
 	mRenderer = ref new MSWinRTRenderer();
 }
@@ -57,29 +58,88 @@ void MSWinRTBackgroundDis::start()
 {
 	if (!mIsStarted && mIsActivated) {
 		mIsStarted = mRenderer->Start();
+		if (mIsStarted && mAsyncConversion) startConversionStage();
 	}
 }
 
 void MSWinRTBackgroundDis::stop()
 {
 	if (mIsStarted) {
+		// The worker must be done with the renderer before it is stopped.
+		stopConversionStage();
+		clearDejitterBuffer();
 		mRenderer->Stop();
 		mIsStarted = false;
 	}
 }
 
+void MSWinRTBackgroundDis::enableAsyncConversion(bool enable)
+{
+	if (enable) {
+		mAsyncConversion = true;
+		if (mIsStarted) startConversionStage();
+	} else {
+		// The worker is joined before the ticker goes back to rendering the frames itself.
+		stopConversionStage();
+		mAsyncConversion = false;
+	}
+	ms_message("[MSWinRTBackgroundDis] Asynchronous conversion %s", enable ? "enabled" : "disabled");
+}
+
+void MSWinRTBackgroundDis::enableFrameTimestamps(bool enable)
+{
+	mUseFrameTimestamps = enable;
+	ms_message("[MSWinRTBackgroundDis] Frame timestamps %s", enable ? "used" : "ignored");
+}
+
+int MSWinRTBackgroundDis::setRenderAheadBounds(int minMs, int maxMs)
+{
+	if (!mRenderer->GetRenderAheadEstimator()->SetBounds(minMs, maxMs)) {
+		ms_error("[MSWinRTBackgroundDis] Invalid render-ahead bounds [%d, %d] ms", minMs, maxMs);
+		return -1;
+	}
+	ms_message("[MSWinRTBackgroundDis] Render-ahead bounded to [%d, %d] ms", minMs, maxMs);
+	return 0;
+}
+
+void MSWinRTBackgroundDis::getRenderAheadStats(MSWinRTRenderAheadStats *stats)
+{
+	static_assert(RenderAheadEstimator::BucketCount == MS_WINRTDIS_JITTER_HISTOGRAM_SIZE, "jitter histogram size mismatch");
+	static_assert(RenderAheadEstimator::BucketWidthMs == MS_WINRTDIS_JITTER_BUCKET_WIDTH_MS, "jitter bucket width mismatch");
+	std::shared_ptr<RenderAheadEstimator> estimator = mRenderer->GetRenderAheadEstimator();
+	stats->render_ahead_ms = estimator->GetRenderAheadMs();
+	estimator->GetHistogram(stats->jitter_histogram);
+}
+
+void MSWinRTBackgroundDis::startConversionStage()
+{
+	mConversionStage.Start([this](mblk_t *im) {
+		std::lock_guard<std::mutex> lock(mRenderMutex);
+		renderFrame(im);
+	});
+}
+
+void MSWinRTBackgroundDis::stopConversionStage()
+{
+	if (!mConversionStage.IsRunning()) return;
+	mConversionStage.Stop();
+	ms_message("[MSWinRTBackgroundDis] %llu frames converted asynchronously, %llu dropped",
+		mConversionStage.GetProcessedCount(), mConversionStage.GetDroppedCount());
+}
+
 int MSWinRTBackgroundDis::feed(MSFilter *f)
 {
 	if (mIsStarted) {
 		mblk_t *im;
 
-		if ((f->inputs[0] != NULL) && ((im = ms_queue_peek_last(f->inputs[0])) != NULL)) {
-			MSPicture buf;
-			if (ms_yuv_buf_init_from_mblk(&buf, im) == 0) {
+		if (mDejitter) {
+			if (f->inputs[0] != NULL) feedDejitterBuffer(f);
+		} else {
+			// The de-jitter buffer may have been disabled with frames in it.
+			if (mDejitterBuffer.GetCount() > 0) clearDejitterBuffer();
+			if ((f->inputs[0] != NULL) && ((im = ms_queue_peek_last(f->inputs[0])) != NULL)) {
 				ms_queue_remove(f->inputs[0], im);
-				Microsoft::WRL::ComPtr<VideoBuffer> spVideoBuffer = NULL;
-				Microsoft::WRL::MakeAndInitialize<VideoBuffer>(&spVideoBuffer, buf.planes[0], (int)msgdsize(im), im);
-				mRenderer->Feed(VideoBuffer::GetIBuffer(spVideoBuffer), buf.w, buf.h);
+				presentFrame(im);
 			}
 		}
 	}
@@ -94,6 +154,79 @@ int MSWinRTBackgroundDis::feed(MSFilter *f)
 	return 0;
 }
 
+void MSWinRTBackgroundDis::enableDejitter(bool enable)
+{
+	mDejitter = enable;
+	ms_message("[MSWinRTBackgroundDis] De-jitter buffer %s", enable ? "enabled" : "disabled");
+}
+
+int MSWinRTBackgroundDis::setLatencyBudget(int ms)
+{
+	if (ms <= 0) {
+		ms_error("[MSWinRTBackgroundDis] Invalid latency budget %d ms", ms);
+		return -1;
+	}
+	mDejitterBuffer.SetLatencyBudget(ms);
+	ms_message("[MSWinRTBackgroundDis] De-jitter latency budget set to %d ms", mDejitterBuffer.GetLatencyBudget());
+	return 0;
+}
+
+void MSWinRTBackgroundDis::getDejitterStats(MSWinRTDejitterStats *stats)
+{
+	stats->rendered_frames = (int)mDejitterBuffer.GetReleasedCount();
+	stats->late_frames = (int)mDejitterBuffer.GetLateCount();
+	stats->overflow_frames = (int)mDejitterBuffer.GetOverflowCount();
+	stats->resyncs = (int)mDejitterBuffer.GetResyncCount();
+}
+
+void MSWinRTBackgroundDis::feedDejitterBuffer(MSFilter *f)
+{
+	mblk_t *im;
+	while ((im = ms_queue_get(f->inputs[0])) != NULL) {
+		mDejitterBuffer.Push(im, mblk_get_timestamp_info(im), f->ticker->time);
+	}
+	if ((im = mDejitterBuffer.Pop(f->ticker->time)) != NULL) {
+		presentFrame(im);
+	}
+	uint64_t lateCount = mDejitterBuffer.GetLateCount();
+	uint64_t overflowCount = mDejitterBuffer.GetOverflowCount();
+	if ((lateCount + overflowCount) != mReportedDrops) {
+		ms_warning("[MSWinRTBackgroundDis] De-jitter buffer dropped %llu frames, %llu late and %llu overflowing in total",
+			lateCount + overflowCount - mReportedDrops, lateCount, overflowCount);
+		mReportedDrops = lateCount + overflowCount;
+	}
+}
+
+void MSWinRTBackgroundDis::clearDejitterBuffer()
+{
+	if (mDejitterBuffer.GetCount() > 0) {
+		ms_message("[MSWinRTBackgroundDis] Discarding %u frames of the de-jitter buffer", (unsigned int)mDejitterBuffer.GetCount());
+	}
+	mDejitterBuffer.Clear();
+}
+
+void MSWinRTBackgroundDis::presentFrame(mblk_t *im)
+{
+	if (!mAsyncConversion || !mConversionStage.Push(im)) {
+		std::lock_guard<std::mutex> lock(mRenderMutex);
+		renderFrame(im);
+	}
+}
+
+void MSWinRTBackgroundDis::renderFrame(mblk_t *im)
+{
+	MSPicture buf;
+	if (ms_yuv_buf_init_from_mblk(&buf, im) == 0) {
+		int64 timestamp = mUseFrameTimestamps ? (int64)mblk_get_timestamp_info(im) : -1;
+		// The video buffer takes the ownership of the frame.
+		Microsoft::WRL::ComPtr<VideoBuffer> spVideoBuffer = NULL;
+		Microsoft::WRL::MakeAndInitialize<VideoBuffer>(&spVideoBuffer, buf.planes[0], (int)msgdsize(im), im);
+		mRenderer->Feed(VideoBuffer::GetIBuffer(spVideoBuffer), buf.w, buf.h, timestamp);
+	} else {
+		freemsg(im);
+	}
+}
+
 MSVideoSize MSWinRTBackgroundDis::getVideoSize()
 {
 	MSVideoSize vs;
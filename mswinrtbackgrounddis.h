@@ -23,9 +23,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <string>
 
 #include "mswinrtvid.h"
+#include "AsyncFrameStage.h"
+#include "DejitterBuffer.h"
 #include "Renderer.h"
 
 
@@ -44,10 +48,45 @@ namespace libmswinrtvid
 		int feed(MSFilter *f);
 		MSVideoSize getVideoSize();
 		void setSwapChainPanel(Platform::String ^swapChainPanelName);
+		bool isAsyncConversion() { return mAsyncConversion; }
+		void enableAsyncConversion(bool enable);
+		int getDroppedFrames() { return (int)mConversionStage.GetDroppedCount(); }
+		bool isUsingFrameTimestamps() { return mUseFrameTimestamps; }
+		void enableFrameTimestamps(bool enable);
+		int setRenderAheadBounds(int minMs, int maxMs);
+		void getRenderAheadBounds(int &minMs, int &maxMs) { mRenderer->GetRenderAheadEstimator()->GetBounds(minMs, maxMs); }
+		void getRenderAheadStats(MSWinRTRenderAheadStats *stats);
+		bool isDejittering() { return mDejitter; }
+		void enableDejitter(bool enable);
+		int getLatencyBudget() { return mDejitterBuffer.GetLatencyBudget(); }
+		int setLatencyBudget(int ms);
+		void getDejitterStats(MSWinRTDejitterStats *stats);
+
+		/// Frames waiting for the worker in asynchronous conversion.
+		static const int ConversionQueueDepth = 2;
+		/// Frames held by the de-jitter buffer at most, 500 ms at 30 fps.
+		static const int DejitterCapacity = 16;
 
 	private:
+		void renderFrame(mblk_t *im);
+		void presentFrame(mblk_t *im);
+		void feedDejitterBuffer(MSFilter *f);
+		void clearDejitterBuffer();
+		void startConversionStage();
+		void stopConversionStage();
+
 		bool mIsActivated;
 		bool mIsStarted;
 		MSWinRTRenderer^ mRenderer;
+		// Switched by the application thread, read by the ticker.
+		std::atomic<bool> mAsyncConversion;
+		// Serializes renderFrame between the ticker and the worker, that may both render while the stage stops
+		// since Push is then refused.
+		std::mutex mRenderMutex;
+		bool mUseFrameTimestamps;
+		AsyncFrameStage<mblk_t *> mConversionStage;
+		bool mDejitter;
+		DejitterBuffer<mblk_t *> mDejitterBuffer;
+		uint64_t mReportedDrops;
 	};
 }
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 
 #include "mswinrtcap.h"
+#include "YuvConverter.h"
 
 using namespace Microsoft::WRL;
 using namespace Windows::Foundation;
@@ -35,9 +36,20 @@ bctbx_list_t *MSWinRTCap::smCameras = NULL;
 
 
 MSWinRTCapHelper::MSWinRTCapHelper() :
-	mRotationKey({ 0xC380465D, 0x2271, 0x428C,{ 0x9B, 0x83, 0xEC, 0xEA, 0x3B, 0x4A, 0x85, 0xC1 } }),
-	mDeviceOrientation(0), mAllocator(NULL)
+	mRotationKey({ 0xC380465D, 0x2271, 0x428C,{ 0x9B, 0x83, 0xEC, 0xEA, 0x3B, 0x4A, 0x85, 0xC1 } })
 {
+	for (int i = 0; i < MaxOutputs; i++) {
+		mAllocators[i] = NULL;
+		mSamplesRings[i] = new SpscRing<mblk_t *>(MaxQueueDepth, freemsg);
+		mSamplesRings[i]->SetDepth(DefaultQueueDepth);
+		mPacers[i] = new CapturePacer<mblk_t *>(freemsg);
+	}
+	mSettings.Size.width = MS_VIDEO_SIZE_CIF_W;
+	mSettings.Size.height = MS_VIDEO_SIZE_CIF_H;
+	mSettings.PixFmt = MS_YUV420P;
+	mSettings.SimulcastLayers = 0;
+	mSettings.Mirror = false;
+	mSettings.DeviceOrientation = 0;
 	mInitializationCompleted = CreateEventEx(NULL, L"Local\\MSWinRTCapInitialization", 0, EVENT_ALL_ACCESS);
 	if (!mInitializationCompleted) {
 		ms_error("[MSWinRTCap] Could not create initialization event [%i]", GetLastError());
@@ -54,9 +66,9 @@ MSWinRTCapHelper::MSWinRTCapHelper() :
 		return;
 	}
 
-	ms_mutex_init(&mMutex, NULL);
-	mAllocator = ms_yuv_buf_allocator_new();
-	ms_queue_init(&mSamplesQueue);
+	for (int i = 0; i < MaxOutputs; i++) {
+		mAllocators[i] = ms_yuv_buf_allocator_new();
+	}
 }
 
 MSWinRTCapHelper::~MSWinRTCapHelper()
@@ -76,12 +88,17 @@ MSWinRTCapHelper::~MSWinRTCapHelper()
 		CloseHandle(mInitializationCompleted);
 		mInitializationCompleted = NULL;
 	}
-	if (mAllocator != NULL) {
-		ms_yuv_buf_allocator_free(mAllocator);
-		mAllocator = NULL;
+	for (int i = 0; i < MaxOutputs; i++) {
+		delete mSamplesRings[i];
+		mSamplesRings[i] = NULL;
+		delete mPacers[i];
+		mPacers[i] = NULL;
+		if (mAllocators[i] != NULL) {
+			ms_yuv_buf_allocator_free(mAllocators[i]);
+			mAllocators[i] = NULL;
+		}
 	}
 	mEncodingProfile = nullptr;
-	ms_mutex_destroy(&mMutex);
 }
 
 void MSWinRTCapHelper::OnCaptureFailed(MediaCapture^ sender, MediaCaptureFailedEventArgs^ errorEventArgs)
@@ -125,6 +142,10 @@ bool MSWinRTCapHelper::StartCapture(MediaEncodingProfile^ EncodingProfile)
 {
 	bool isStarted = false;
 	mEncodingProfile = EncodingProfile;
+	mAdmission.Reset();
+	for (int i = 0; i < MaxOutputs; i++) {
+		mSamplesRings[i]->Open();
+	}
 	MakeAndInitialize<MSWinRTMediaSink>(&mMediaSink, EncodingProfile->Video);
 	static_cast<MSWinRTMediaSink *>(mMediaSink.Get())->SetCaptureFilter(this);
 	ComPtr<IInspectable> spInspectable;
@@ -149,6 +170,18 @@ bool MSWinRTCapHelper::StartCapture(MediaEncodingProfile^ EncodingProfile)
 
 void MSWinRTCapHelper::StopCapture()
 {
+	ms_message("[MSWinRTCap] %llu camera frames admitted, %llu skipped before conversion",
+		(unsigned long long)mAdmission.GetAdmittedCount(), (unsigned long long)mAdmission.GetSkippedCount());
+	for (int i = 0; i < MaxOutputs; i++) {
+		if ((mPacers[i]->GetSupersededCount() > 0) || (mPacers[i]->GetStaleCount() > 0)) {
+			ms_message("[MSWinRTCap] Pacing dropped %llu superseded and %llu stale frames on output %i",
+				(unsigned long long)mPacers[i]->GetSupersededCount(), (unsigned long long)mPacers[i]->GetStaleCount(), i);
+		}
+	}
+	// A camera thread waiting for room in a queue must not hold up the stop.
+	for (int i = 0; i < MaxOutputs; i++) {
+		mSamplesRings[i]->Close();
+	}
 	static_cast<MSWinRTMediaSink *>(mMediaSink.Get())->SetCaptureFilter(nullptr);
 	IAsyncAction^ action = mCapture->StopRecordAsync();
 	action->Completed = ref new AsyncActionCompletedHandler([this](IAsyncAction^ asyncAction, Windows::Foundation::AsyncStatus asyncStatus) {
@@ -167,33 +200,133 @@ void MSWinRTCapHelper::StopCapture()
 
 void MSWinRTCapHelper::OnSampleAvailable(BYTE *buf, DWORD bufLen, LONGLONG presentationTime)
 {
-	mblk_t *m;
+	// Skip the frames in excess of the target frame rate before any pixel work.
+	if (!mAdmission.Admit(presentationTime)) return;
+
+	// The settings may be changed by the application thread meanwhile: the frame is converted with a snapshot of them.
+	MSWinRTCapOutputSettings settings;
+	{
+		std::lock_guard<std::mutex> lock(mSettingsMutex);
+		settings = mSettings;
+	}
+
 	uint32_t timestamp = (uint32_t)((presentationTime / 10000LL) * 90LL);
+	uint64_t now = ms_get_cur_time_ms();
+	for (int i = 0; i < MaxOutputs; i++) {
+		mPacers[i]->OnFrameArrival(timestamp, now);
+	}
 
-	int w = mEncodingProfile->Video->Width;
-	int h = mEncodingProfile->Video->Height;
-	if ((mDeviceOrientation % 180) == 90) {
-		w = mEncodingProfile->Video->Height;
-		h = mEncodingProfile->Video->Width;
+	// The camera delivers frames of the capture size, that are scaled down to the output size if it is smaller.
+	int srcWidth = mEncodingProfile->Video->Width;
+	int srcHeight = mEncodingProfile->Video->Height;
+	int w = settings.Size.width;
+	int h = settings.Size.height;
+	if ((settings.DeviceOrientation % 180) == 90) {
+		w = settings.Size.height;
+		h = settings.Size.width;
+	}
+	if (bufLen < (DWORD)((srcWidth * srcHeight * 3) / 2)) {
+		ms_warning("[MSWinRTCap] Dropping a too small sample of %u bytes for %ix%i", (unsigned int)bufLen, srcWidth, srcHeight);
+		return;
 	}
 	uint8_t *y = (uint8_t *)buf;
-	uint8_t *cbcr = (uint8_t *)(buf + w * h);
-	m = copy_ycbcrbiplanar_to_true_yuv_with_rotation(mAllocator, y, cbcr, mDeviceOrientation, w, h, mEncodingProfile->Video->Width, mEncodingProfile->Video->Width, TRUE);
-	mblk_set_timestamp_info(m, timestamp);
+	uint8_t *cbcr = (uint8_t *)(buf + srcWidth * srcHeight);
+	int srcStride = srcWidth;
+
+	// Crop the centre of the frame to the aspect ratio of the output size, both taken before rotation, for the
+	// scaling not to distort the picture. The offsets are even to stay on the chroma samples.
+	int ow = settings.Size.width;
+	int oh = settings.Size.height;
+	if ((int64_t)srcWidth * oh > (int64_t)srcHeight * ow) {
+		int cropWidth = (int)(((int64_t)srcHeight * ow / oh) & ~1);
+		int x = ((srcWidth - cropWidth) / 2) & ~1;
+		y += x;
+		cbcr += x;
+		srcWidth = cropWidth;
+	} else if ((int64_t)srcWidth * oh < (int64_t)srcHeight * ow) {
+		int cropHeight = (int)(((int64_t)srcWidth * oh / ow) & ~1);
+		int top = ((srcHeight - cropHeight) / 2) & ~1;
+		y += top * srcStride;
+		cbcr += (top / 2) * srcStride;
+		srcHeight = cropHeight;
+	}
+
+	// The quarter resolution layer is computed from the half resolution one, that is then needed even if it is not output.
+	int layers = settings.SimulcastLayers;
+	int levelCount = 1;
+	if (layers & MS_WINRTCAP_LAYER_QUARTER) levelCount = 3;
+	else if (layers & MS_WINRTCAP_LAYER_HALF) levelCount = 2;
+
+	mblk_t *levels[MaxOutputs];
+	YuvConverter::YuvPlanes planes[MaxOutputs];
+	for (int i = 0; i < levelCount; i++) {
+		MSPicture pict;
+		int lw = w >> i;
+		int lh = h >> i;
+		levels[i] = ms_yuv_buf_allocator_get(mAllocators[i], &pict, lw, lh);
+		if (settings.PixFmt == MS_NV12) {
+			// The I420 and NV12 buffers have the same size, only the chroma layout differs: the interleaved chroma
+			// plane takes the place of the U and V ones, its rows being as wide as the luma ones.
+			planes[i] = YuvConverter::NV12Planes(pict.planes[0], pict.strides[0], pict.planes[1], pict.strides[0], lw, lh);
+		} else {
+			planes[i] = YuvConverter::I420Planes(pict.planes[0], pict.strides[0], pict.planes[1], pict.strides[1], pict.planes[2], pict.strides[2], lw, lh);
+		}
+	}
+	// A NV12 output of the camera size is passed through as it is, with no conversion.
+	YuvConverter::NV12ToPyramidOrCopy(y, srcStride, cbcr, srcStride, srcWidth, srcHeight, planes, levelCount, settings.DeviceOrientation, settings.Mirror);
 
-	ms_mutex_lock(&mMutex);
-	ms_queue_put(&mSamplesQueue, m);
-	ms_mutex_unlock(&mMutex);
+	for (int i = 0; i < levelCount; i++) {
+		if ((i == 1) && !(layers & MS_WINRTCAP_LAYER_HALF)) {
+			freemsg(levels[i]);
+			continue;
+		}
+		mblk_set_timestamp_info(levels[i], timestamp);
+		mSamplesRings[i]->Push(levels[i]);
+	}
 }
 
-mblk_t * MSWinRTCapHelper::GetSample()
+mblk_t * MSWinRTCapHelper::GetSample(int output)
 {
-	ms_mutex_lock(&mMutex);
-	mblk_t *m = ms_queue_get(&mSamplesQueue);
-	ms_mutex_unlock(&mMutex);
+	mblk_t *m;
+	if (!mSamplesRings[output]->Pop(m)) return NULL;
 	return m;
 }
 
+mblk_t * MSWinRTCapHelper::GetPacedSample(int output, uint64_t now)
+{
+	SpscRing<mblk_t *> *ring = mSamplesRings[output];
+	return mPacers[output]->Select([ring](mblk_t *&m) { return ring->Pop(m); },
+		[](mblk_t *m) { return mblk_get_timestamp_info(m); }, now);
+}
+
+void MSWinRTCapHelper::ClearSamples()
+{
+	for (int i = 0; i < MaxOutputs; i++) {
+		mSamplesRings[i]->Clear();
+	}
+}
+
+void MSWinRTCapHelper::MaxLatency::set(int value)
+{
+	for (int i = 0; i < MaxOutputs; i++) {
+		mPacers[i]->SetMaxLatency(value);
+	}
+}
+
+void MSWinRTCapHelper::QueueDepth::set(int value)
+{
+	for (int i = 0; i < MaxOutputs; i++) {
+		mSamplesRings[i]->SetDepth((size_t)value);
+	}
+}
+
+void MSWinRTCapHelper::OverflowPolicy::set(int value)
+{
+	for (int i = 0; i < MaxOutputs; i++) {
+		mSamplesRings[i]->SetOverflowPolicy((SpscRing<mblk_t *>::OverflowPolicy)value);
+	}
+}
+
 MSVideoSize MSWinRTCapHelper::SelectBestVideoSize(MSVideoSize vs)
 {
 	if ((CaptureDevice == nullptr) || (CaptureDevice->VideoDeviceController == nullptr)) {
@@ -231,8 +364,13 @@ MSVideoSize MSWinRTCapHelper::SelectBestVideoSize(MSVideoSize vs)
 	}
 
 	if ((bestFoundSize.width == 0) && bestFoundSize.height == 0) {
-		ms_warning("[MSWinRTCap] This camera does not support our video size, use requested size");
-		return vs;
+		if ((minSize.width == 65536) && (minSize.height == 65536)) {
+			ms_warning("[MSWinRTCap] This camera does not support our video size, use requested size");
+			return vs;
+		}
+		// Capture with the smallest mode the camera has, the frames will be scaled down to the requested size.
+		ms_warning("[MSWinRTCap] This camera does not support our video size, capture at %ix%i", minSize.width, minSize.height);
+		return minSize;
 	}
 
 	ms_message("[MSWinRTCap] Best video size is %ix%i", bestFoundSize.width, bestFoundSize.height);
@@ -241,7 +379,7 @@ MSVideoSize MSWinRTCapHelper::SelectBestVideoSize(MSVideoSize vs)
 
 
 MSWinRTCap::MSWinRTCap()
-	: mIsInitialized(false), mIsActivated(false), mIsStarted(false), mFps(15), mStartTime(0)
+	: mIsInitialized(false), mIsActivated(false), mIsStarted(false), mPacing(false), mFrameRate(FrameRate::FromFraction(15, 1)), mStartTime(0), mWebcam(NULL)
 {
 	if (smInstantiated) {
 		ms_error("[MSWinRTCap] A video capture filter is already instantiated. A second one can not be created.");
@@ -250,6 +388,7 @@ MSWinRTCap::MSWinRTCap()
 
 	mVideoSize.width = MS_VIDEO_SIZE_CIF_W;
 	mVideoSize.height = MS_VIDEO_SIZE_CIF_H;
+	mCaptureSize = mVideoSize;
 	mHelper = ref new MSWinRTCapHelper();
 	smInstantiated = true;
 }
@@ -271,8 +410,8 @@ int MSWinRTCap::activate()
 {
 	if (!mIsInitialized) initialize();
 
-	ms_average_fps_init(&mAvgFps, "[MSWinRTCap] fps=%f");
-	ms_video_init_framerate_controller(&mFpsControl, mFps);
+	mFpsMeter.Reset();
+	mFpsControl.Init(mFrameRate);
 	configure();
 	applyVideoSize();
 	applyFps();
@@ -296,27 +435,48 @@ void MSWinRTCap::start()
 
 void MSWinRTCap::stop()
 {
-	mblk_t *m;
-
 	if (!mIsStarted) return;
 	mHelper->StopCapture();
 
 	// Free the samples that have not been sent yet
-	while ((m = mHelper->GetSample()) != NULL) {
-		freemsg(m);
-	}
+	mHelper->ClearSamples();
 	mIsStarted = false;
 }
 
 int MSWinRTCap::feed(MSFilter *f)
 {
-	if (ms_video_capture_new_frame(&mFpsControl, f->ticker->time)) {
-		mblk_t *im;
-		
+	mblk_t *im;
+
+	if (mPacing) {
+		// The frames have been admitted at the target frame rate on arrival, so each tick sends the newest sample
+		// of each output, if any, without the frame rate controller: the frames leave at the ticker pace.
+		uint64_t now = ms_get_cur_time_ms();
+		for (int i = 0; i < MSWinRTCapHelper::MaxOutputs; i++) {
+			if ((im = mHelper->GetPacedSample(i, now)) == NULL) continue;
+			if (f->outputs[i] != NULL) {
+				ms_queue_put(f->outputs[i], im);
+				if (i == 0) {
+					mFpsMeter.Update(f->ticker->time);
+				}
+			} else {
+				freemsg(im);
+			}
+		}
+		return 0;
+	}
+
+	// The frame rate controller is only asked when there is a frame, see FrameRateController.
+	if (mHelper->HasSample(0) && mFpsControl.IsFrameDue(f->ticker->time)) {
 		// Send queued samples
-		while ((im = mHelper->GetSample()) != NULL) {
+		while ((im = mHelper->GetSample(0)) != NULL) {
 			ms_queue_put(f->outputs[0], im);
-			ms_average_fps_update(&mAvgFps, (uint32_t)f->ticker->time);
+			mFpsMeter.Update(f->ticker->time);
+		}
+		for (int i = 1; i < MSWinRTCapHelper::MaxOutputs; i++) {
+			while ((im = mHelper->GetSample(i)) != NULL) {
+				if (f->outputs[i] != NULL) ms_queue_put(f->outputs[i], im);
+				else freemsg(im);
+			}
 		}
 	}
 
@@ -326,15 +486,97 @@ int MSWinRTCap::feed(MSFilter *f)
 
 void MSWinRTCap::setFps(float fps)
 {
-	mFps = fps;
-	ms_average_fps_init(&mAvgFps, "[MSWinRTCap] fps=%f");
-	ms_video_init_framerate_controller(&mFpsControl, fps);
+	setFrameRate(FrameRate::FromFloat(fps));
+}
+
+int MSWinRTCap::setFrameRate(FrameRate rate)
+{
+	if (!rate.IsValid() || (rate.ToFloat() > 1000.f)) {
+		ms_error("[MSWinRTCap] Invalid frame rate %u/%u", rate.Numerator, rate.Denominator);
+		return -1;
+	}
+	mFrameRate = rate;
+	mFpsMeter.Reset();
+	mFpsControl.Init(rate);
 	applyFps();
+	ms_message("[MSWinRTCap] Frame rate set to %u/%u (%f fps)", rate.Numerator, rate.Denominator, rate.ToFloat());
+	return 0;
+}
+
+int MSWinRTCap::setPixFmt(MSPixFmt fmt)
+{
+	if ((fmt != MS_YUV420P) && (fmt != MS_NV12)) {
+		ms_error("[MSWinRTCap] Unsupported output pixel format %i", fmt);
+		return -1;
+	}
+	mHelper->PixFmt = fmt;
+	ms_message("[MSWinRTCap] Output pixel format set to %s", (fmt == MS_NV12) ? "NV12" : "YUV420P");
+	return 0;
+}
+
+void MSWinRTCap::setWebcam(WinRTWebcam *webcam)
+{
+	mWebcam = webcam;
+	mHelper->Mirror = (webcam->mirror == TRUE);
+}
+
+void MSWinRTCap::enableMirroring(bool enable)
+{
+	mHelper->Mirror = enable;
+	if (mWebcam != NULL) {
+		mWebcam->mirror = enable ? TRUE : FALSE;
+	}
+	ms_message("[MSWinRTCap] Mirroring %s", enable ? "enabled" : "disabled");
+}
+
+void MSWinRTCap::setSimulcastLayers(int layers)
+{
+	mHelper->SimulcastLayers = layers & (MS_WINRTCAP_LAYER_HALF | MS_WINRTCAP_LAYER_QUARTER);
+	ms_message("[MSWinRTCap] Simulcast layers:%s%s", (layers & MS_WINRTCAP_LAYER_HALF) ? " half" : "", (layers & MS_WINRTCAP_LAYER_QUARTER) ? " quarter" : "");
+}
+
+int MSWinRTCap::setQueueDepth(int depth)
+{
+	if ((depth < 1) || (depth > MSWinRTCapHelper::MaxQueueDepth)) {
+		ms_error("[MSWinRTCap] Invalid queue depth %i", depth);
+		return -1;
+	}
+	mHelper->QueueDepth = depth;
+	ms_message("[MSWinRTCap] Queue depth set to %i", depth);
+	return 0;
+}
+
+int MSWinRTCap::setOverflowPolicy(int policy)
+{
+	if ((policy != MS_WINRTCAP_OVERFLOW_DROP_OLDEST) && (policy != MS_WINRTCAP_OVERFLOW_DROP_NEWEST) && (policy != MS_WINRTCAP_OVERFLOW_BLOCK)) {
+		ms_error("[MSWinRTCap] Invalid queue overflow policy %i", policy);
+		return -1;
+	}
+	mHelper->OverflowPolicy = policy;
+	ms_message("[MSWinRTCap] Queue overflow policy set to %i", policy);
+	return 0;
+}
+
+void MSWinRTCap::enablePacing(bool enable)
+{
+	mPacing = enable;
+	ms_message("[MSWinRTCap] Output pacing %s", enable ? "enabled" : "disabled");
+}
+
+int MSWinRTCap::setMaxLatency(int ms)
+{
+	if (ms <= 0) {
+		ms_error("[MSWinRTCap] Invalid maximum latency %i ms", ms);
+		return -1;
+	}
+	mHelper->MaxLatency = ms;
+	ms_message("[MSWinRTCap] Maximum latency set to %i ms", ms);
+	return 0;
 }
 
 float MSWinRTCap::getAverageFps()
 {
-	return ms_average_fps_get(&mAvgFps);
+	return mFpsMeter.Get();
 }
 
 MSVideoSize MSWinRTCap::getVideoSize()
@@ -357,7 +599,25 @@ void MSWinRTCap::setVideoSize(MSVideoSize vs)
 
 void MSWinRTCap::selectBestVideoSize(MSVideoSize vs)
 {
-	mVideoSize = mHelper->SelectBestVideoSize(vs);
+	mCaptureSize = mHelper->SelectBestVideoSize(vs);
+	mVideoSize = mCaptureSize;
+	if ((mCaptureSize.width > vs.width) || (mCaptureSize.height > vs.height)) {
+		// Output the requested size, shrunk with its aspect ratio kept if the capture size is smaller in one dimension.
+		// The frames are cropped to this aspect ratio before being scaled down, so that they are not distorted.
+		mVideoSize = vs;
+		if ((mVideoSize.width > mCaptureSize.width) || (mVideoSize.height > mCaptureSize.height)) {
+			if ((int64_t)vs.width * mCaptureSize.height > (int64_t)vs.height * mCaptureSize.width) {
+				mVideoSize.width = mCaptureSize.width;
+				mVideoSize.height = (int)(((int64_t)vs.height * mCaptureSize.width / vs.width) & ~1);
+			} else {
+				mVideoSize.width = (int)(((int64_t)vs.width * mCaptureSize.height / vs.height) & ~1);
+				mVideoSize.height = mCaptureSize.height;
+			}
+		}
+	}
+	if (!ms_video_size_equal(mVideoSize, mCaptureSize)) {
+		ms_message("[MSWinRTCap] Capturing at %ix%i, scaling to %ix%i", mCaptureSize.width, mCaptureSize.height, mVideoSize.width, mVideoSize.height);
+	}
 }
 
 void MSWinRTCap::setDeviceOrientation(int degrees)
@@ -372,16 +632,18 @@ void MSWinRTCap::setDeviceOrientation(int degrees)
 
 void MSWinRTCap::applyFps()
 {
+	mHelper->AdmissionRate = mFrameRate;
 	if (mEncodingProfile != nullptr) {
-		mEncodingProfile->Video->FrameRate->Numerator = (unsigned int)mFps;
-		mEncodingProfile->Video->FrameRate->Denominator = 1;
+		mEncodingProfile->Video->FrameRate->Numerator = mFrameRate.Numerator;
+		mEncodingProfile->Video->FrameRate->Denominator = mFrameRate.Denominator;
 	}
 }
 
 void MSWinRTCap::applyVideoSize()
 {
+	mHelper->OutputSize = mVideoSize;
 	if (mEncodingProfile != nullptr) {
-		MSVideoSize vs = mVideoSize;
+		MSVideoSize vs = mCaptureSize;
 		mEncodingProfile->Video->Width = vs.width;
 		mEncodingProfile->Video->Height = vs.height;
 		mEncodingProfile->Video->PixelAspectRatio->Numerator = 1;
@@ -394,7 +656,7 @@ void MSWinRTCap::configure()
 	mEncodingProfile = ref new MediaEncodingProfile();
 	mEncodingProfile->Audio = nullptr;
 	mEncodingProfile->Container = nullptr;
-	MSVideoSize vs = mVideoSize;
+	MSVideoSize vs = mCaptureSize;
 	mEncodingProfile->Video = VideoEncodingProperties::CreateUncompressed(MediaEncodingSubtypes::Nv12, vs.width, vs.height);
 }
 
@@ -424,6 +686,7 @@ void MSWinRTCap::addCamera(MSWebCamManager *manager, MSWebCamDesc *desc, DeviceI
 	winrtwebcam->id_vector = new std::vector<wchar_t>(wcslen(id) + 1);
 	wcscpy_s(&winrtwebcam->id_vector->front(), winrtwebcam->id_vector->size(), id);
 	winrtwebcam->id = &winrtwebcam->id_vector->front();
+	winrtwebcam->mirror = FALSE;
 	cam->data = winrtwebcam;
 	if (DeviceInfo->EnclosureLocation != nullptr) {
 		if (DeviceInfo->EnclosureLocation->Panel == Windows::Devices::Enumeration::Panel::Front) {
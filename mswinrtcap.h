@@ -30,9 +30,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "mswinrtvid.h"
 #include "mswinrtmediasink.h"
+#include "CapturePacer.h"
+#include "FrameAdmission.h"
+#include "FrameRate.h"
+#include "SpscRing.h"
 
 #include <wrl\implements.h>
 #include <ppltasks.h>
+#include <mutex>
 
 using namespace Windows::Media::Capture;
 using namespace Windows::Media::Devices;
@@ -41,6 +46,16 @@ using namespace Windows::Media::MediaProperties;
 
 namespace libmswinrtvid
 {
+	/// Output settings of the capture, written by the application thread and read once per frame by the camera thread.
+	struct MSWinRTCapOutputSettings
+	{
+		MSVideoSize Size;
+		MSPixFmt PixFmt;
+		int SimulcastLayers;
+		bool Mirror;
+		int DeviceOrientation;
+	};
+
 	ref class MSWinRTCapHelper sealed {
 	internal:
 		MSWinRTCapHelper();
@@ -49,7 +64,14 @@ namespace libmswinrtvid
 		void StopCapture();
 		void MSWinRTCapHelper::OnSampleAvailable(BYTE *buf, DWORD bufLen, LONGLONG presentationTime);
 		MSVideoSize SelectBestVideoSize(MSVideoSize vs);
-		mblk_t * GetSample();
+		bool HasSample(int output) { return !mSamplesRings[output]->IsEmpty(); }
+		mblk_t * GetSample(int output);
+		mblk_t * GetPacedSample(int output, uint64_t now);
+		void ClearSamples();
+
+		static const int MaxOutputs = 3;
+		static const int MaxQueueDepth = 16;
+		static const int DefaultQueueDepth = 4;
 
 		property Platform::Agile<MediaCapture^> CaptureDevice
 		{
@@ -58,8 +80,63 @@ namespace libmswinrtvid
 
 		property int DeviceOrientation
 		{
-			int get() { return mDeviceOrientation; }
-			void set(int value) { mDeviceOrientation = value; }
+			int get() { std::lock_guard<std::mutex> lock(mSettingsMutex); return mSettings.DeviceOrientation; }
+			void set(int value) { std::lock_guard<std::mutex> lock(mSettingsMutex); mSettings.DeviceOrientation = value; }
+		}
+
+		property MSPixFmt PixFmt
+		{
+			MSPixFmt get() { std::lock_guard<std::mutex> lock(mSettingsMutex); return mSettings.PixFmt; }
+			void set(MSPixFmt value) { std::lock_guard<std::mutex> lock(mSettingsMutex); mSettings.PixFmt = value; }
+		}
+
+		property bool Mirror
+		{
+			bool get() { std::lock_guard<std::mutex> lock(mSettingsMutex); return mSettings.Mirror; }
+			void set(bool value) { std::lock_guard<std::mutex> lock(mSettingsMutex); mSettings.Mirror = value; }
+		}
+
+		property int SimulcastLayers
+		{
+			int get() { std::lock_guard<std::mutex> lock(mSettingsMutex); return mSettings.SimulcastLayers; }
+			void set(int value) { std::lock_guard<std::mutex> lock(mSettingsMutex); mSettings.SimulcastLayers = value; }
+		}
+
+		property MSVideoSize OutputSize
+		{
+			MSVideoSize get() { std::lock_guard<std::mutex> lock(mSettingsMutex); return mSettings.Size; }
+			void set(MSVideoSize value) { std::lock_guard<std::mutex> lock(mSettingsMutex); mSettings.Size = value; }
+		}
+
+		/// Frame rate the camera frames are decimated to, before being converted.
+		property FrameRate AdmissionRate
+		{
+			FrameRate get() { return mAdmission.GetFrameRate(); }
+			void set(FrameRate value) { mAdmission.SetFrameRate(value); }
+		}
+
+		/// Maximum age in ms of the frames sent in pacing mode.
+		property int MaxLatency
+		{
+			int get() { return mPacers[0]->GetMaxLatency(); }
+			void set(int value);
+		}
+
+		property int QueueDepth
+		{
+			int get() { return (int)mSamplesRings[0]->GetDepth(); }
+			void set(int value);
+		}
+
+		property int OverflowPolicy
+		{
+			int get() { return (int)mSamplesRings[0]->GetOverflowPolicy(); }
+			void set(int value);
+		}
+
+		property int DroppedSamples
+		{
+			int get() { return (int)mSamplesRings[0]->GetDroppedCount(); }
 		}
 
 	private:
@@ -74,10 +151,16 @@ namespace libmswinrtvid
 		Windows::Foundation::EventRegistrationToken mMediaCaptureFailedEventRegistrationToken;
 		ComPtr<IMFMediaSink> mMediaSink;
 		MediaEncodingProfile^ mEncodingProfile;
-		int mDeviceOrientation;
-		ms_mutex_t mMutex;
-		MSYuvBufAllocator *mAllocator;
-		MSQueue mSamplesQueue;
+		// Guards mSettings, that the camera thread copies at the start of each frame so that a frame never pairs
+		// a new size with an old format.
+		std::mutex mSettingsMutex;
+		MSWinRTCapOutputSettings mSettings;
+		FrameAdmission mAdmission;
+		MSYuvBufAllocator *mAllocators[MaxOutputs];
+		// Filled by the media sink work queue thread, emptied by the ticker thread.
+		SpscRing<mblk_t *> *mSamplesRings[MaxOutputs];
+		// One pacer per output, so that selecting the frame of an output does not change the state of the others.
+		CapturePacer<mblk_t *> *mPacers[MaxOutputs];
 	};
 
 	class MSWinRTCap {
@@ -98,10 +181,27 @@ namespace libmswinrtvid
 		void setDeviceId(Platform::String^ id) { mDeviceId = id; }
 		void setFront(bool front) { mFront = front; }
 		void setExternal(bool external) { mExternal = external; }
-		MSPixFmt getPixFmt() { return MS_YUV420P; }
-		float getFps() { return mFps; }
+		void setWebcam(WinRTWebcam *webcam);
+		bool isMirroring() { return mHelper->Mirror; }
+		void enableMirroring(bool enable);
+		MSPixFmt getPixFmt() { return mHelper->PixFmt; }
+		int setPixFmt(MSPixFmt fmt);
+		int getSimulcastLayers() { return mHelper->SimulcastLayers; }
+		void setSimulcastLayers(int layers);
+		int getQueueDepth() { return mHelper->QueueDepth; }
+		int setQueueDepth(int depth);
+		int getOverflowPolicy() { return mHelper->OverflowPolicy; }
+		int setOverflowPolicy(int policy);
+		int getDroppedFrames() { return mHelper->DroppedSamples; }
+		bool isPacing() { return mPacing; }
+		void enablePacing(bool enable);
+		int getMaxLatency() { return mHelper->MaxLatency; }
+		int setMaxLatency(int ms);
+		float getFps() { return mFrameRate.ToFloat(); }
 		float getAverageFps();
 		void setFps(float fps);
+		FrameRate getFrameRate() { return mFrameRate; }
+		int setFrameRate(FrameRate rate);
 		MSVideoSize getVideoSize();
 		void setVideoSize(MSVideoSize vs);
 		int getDeviceOrientation() { return mHelper->DeviceOrientation; }
@@ -122,16 +222,19 @@ namespace libmswinrtvid
 		bool mIsInitialized;
 		bool mIsActivated;
 		bool mIsStarted;
-		float mFps;
-		MSAverageFPS mAvgFps;
+		bool mPacing;
+		FrameRate mFrameRate;
+		FrameRateMeter mFpsMeter;
 		MSVideoSize mVideoSize;
+		MSVideoSize mCaptureSize;
 		uint64_t mStartTime;
 		MSVideoStarter mStarter;
 		Platform::String^ mDeviceId;
 		bool mFront;
 		bool mExternal;
+		WinRTWebcam *mWebcam;
 		MSWinRTCapHelper^ mHelper;
 		MediaEncodingProfile^ mEncodingProfile;
-		MSFrameRateController mFpsControl;
+		FrameRateController mFpsControl;
 	};
 }
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "mswinrtdis.h"
 #include "VideoBuffer.h"
+#include "YuvConverter.h"
 
 using namespace libmswinrtvid;
 using namespace Microsoft::WRL;
@@ -50,9 +51,8 @@ static void _stopMediaElement(Windows::UI::Xaml::Controls::MediaElement^ mediaEl
 
 
 MSWinRTDisSampleHandler::MSWinRTDisSampleHandler() :
-	mSample(nullptr), mReferenceTime(0), mPixFmt(MS_YUV420P), mWidth(MS_VIDEO_SIZE_CIF_W), mHeight(MS_VIDEO_SIZE_CIF_H), mStarted(false)
+	mSample(nullptr), mSampleArrival(0), mLastSample(nullptr), mDeferralQueue(MaxPendingRequests), mPixFmt(MS_YUV420P), mWidth(MS_VIDEO_SIZE_CIF_W), mHeight(MS_VIDEO_SIZE_CIF_H), mStarted(false)
 {
-	mDeferralQueue = ref new Platform::Collections::Vector<MSWinRTDisDeferral^>();
 }
 
 MSWinRTDisSampleHandler::~MSWinRTDisSampleHandler()
@@ -69,7 +69,7 @@ void MSWinRTDisSampleHandler::StartMediaElement()
 		mediaStreamSource->SampleRequested += ref new Windows::Foundation::TypedEventHandler<Windows::Media::Core::MediaStreamSource ^, Windows::Media::Core::MediaStreamSourceSampleRequestedEventArgs ^>(this, &MSWinRTDisSampleHandler::OnSampleRequested);
 		Windows::UI::Xaml::Controls::MediaElement^ mediaElement = mMediaElement;
 		bool inUIThread = mediaElement->Dispatcher->HasThreadAccess;
-		mReferenceTime = 0;
+		mSampleClock.Reset();
 		if (inUIThread) {
 			// We are in the UI thread
 			_startMediaElement(mediaElement, mediaStreamSource);
@@ -79,7 +79,9 @@ void MSWinRTDisSampleHandler::StartMediaElement()
 			// Ask the dispatcher to run this code in the UI thread
 			mediaElement->Dispatcher->RunAsync(Windows::UI::Core::CoreDispatcherPriority::Normal, ref new Windows::UI::Core::DispatchedHandler([mediaElement, mediaStreamSource, this]() {
 				_startMediaElement(mediaElement, mediaStreamSource);
+				mMutex.lock();
 				mStarted = true;
+				mMutex.unlock();
 			}));
 		}
 	}
@@ -92,39 +94,37 @@ void MSWinRTDisSampleHandler::StopMediaElement()
 		if (mediaElement->Dispatcher->HasThreadAccess) {
 			// We are in the UI thread
 			_stopMediaElement(mediaElement, this);
-			mDeferralQueue->Clear();
-			mStarted = false;
+			ClearSampleRequests();
 		}
 		else {
 			// Ask the dispatcher to run this code in the UI thread
 			mediaElement->Dispatcher->RunAsync(Windows::UI::Core::CoreDispatcherPriority::Normal, ref new Windows::UI::Core::DispatchedHandler([mediaElement, this]() {
 				_stopMediaElement(mediaElement, this);
-				mDeferralQueue->Clear();
-				mStarted = false;
+				ClearSampleRequests();
 			}));
 		}
 	}
 	else {
-		mDeferralQueue->Clear();
-		mStarted = false;
+		ClearSampleRequests();
 	}
 }
 
 void MSWinRTDisSampleHandler::Feed(Windows::Storage::Streams::IBuffer^ pBuffer)
 {
+	int64_t arrival = MonotonicClock::Now();
 	mMutex.lock();
 	if (!mStarted) {
 		StartMediaElement();
 	}
 	mSample = pBuffer;
-	if (mDeferralQueue->Size > 0) {
+	mSampleArrival = arrival;
+	MSWinRTDisDeferral deferral;
+	if (mDeferralQueue.Pop(deferral)) {
 #ifdef MSWINRTDIS_DEBUG
 		ms_message("[MSWinRTDis] Feed answer deferral");
 #endif
-		MSWinRTDisDeferral^ deferral = mDeferralQueue->GetAt(0);
-		mDeferralQueue->RemoveAt(0);
-		AnswerSampleRequest(deferral->Request);
-		deferral->Deferral->Complete();
+		AnswerSampleRequest(deferral.Request);
+		deferral.Deferral->Complete();
 	}
 #ifdef MSWINRTDIS_DEBUG
 	else {
@@ -142,12 +142,14 @@ void MSWinRTDisSampleHandler::OnSampleRequested(Windows::Media::Core::MediaStrea
 		ms_warning("[MSWinRTDis] OnSampleRequested not for a video stream!");
 		return;
 	}
+	MSWinRTDisDeferral evicted;
+	bool hasEvicted = false;
 	mMutex.lock();
 	if (mSample == nullptr) {
 #ifdef MSWINRTDIS_DEBUG
 		ms_message("[MSWinRTDis] OnSampleRequested defer");
 #endif
-		mDeferralQueue->Append(ref new MSWinRTDisDeferral(request, request->GetDeferral()));
+		hasEvicted = DeferSampleRequest(request, evicted);
 	} else {
 #ifdef MSWINRTDIS_DEBUG
 		ms_message("[MSWinRTDis] OnSampleRequested answer");
@@ -155,37 +157,85 @@ void MSWinRTDisSampleHandler::OnSampleRequested(Windows::Media::Core::MediaStrea
 		AnswerSampleRequest(request);
 	}
 	mMutex.unlock();
+	// Completed without the mutex held, completing a request may raise a new one.
+	if (hasEvicted) {
+		evicted.Deferral->Complete();
+	}
+}
+
+bool MSWinRTDisSampleHandler::DeferSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest, MSWinRTDisDeferral &evicted)
+{
+	MSWinRTDisDeferral deferral = { sampleRequest, sampleRequest->GetDeferral() };
+	if (!mDeferralQueue.Push(deferral, evicted)) return false;
+	// Completing the request without a sample would end the stream, repeat the last frame instead.
+	ms_warning("[MSWinRTDis] %u sample requests pending, answering the oldest one with the last frame (%llu overflows)",
+		(unsigned int)mDeferralQueue.GetCapacity(), mDeferralQueue.GetEvictedCount());
+	mSample = (mLastSample != nullptr) ? mLastSample : VideoBuffer::CreateBlackFrame(mWidth, mHeight);
+	// The repeated frame has not arrived again, it is shown from now on.
+	mSampleArrival = MonotonicClock::Now();
+	AnswerSampleRequest(evicted.Request);
+	return true;
+}
+
+void MSWinRTDisSampleHandler::ClearSampleRequests()
+{
+	// The MediaElement is stopped, its pending requests are not waiting for a frame anymore.
+	// They are completed without the mutex held, completing a request may raise a new one.
+	std::vector<MSWinRTDisDeferral> deferrals;
+	mMutex.lock();
+	mDeferralQueue.Clear([&deferrals](MSWinRTDisDeferral &deferral) {
+		deferrals.push_back(deferral);
+	});
+	mLastSample = nullptr;
+	mStarted = false;
+	mMutex.unlock();
+	for (MSWinRTDisDeferral &deferral : deferrals) {
+		deferral.Deferral->Complete();
+	}
 }
 
 void MSWinRTDisSampleHandler::AnswerSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest)
 {
+	int64_t sampleTime;
+	int64_t duration;
+	// Stamped from the arrival of the frame, the time it waited for a request must not skew the durations.
+	mSampleClock.Stamp(mSampleArrival, sampleTime, duration);
 	TimeSpan ts;
-	UINT64 CurrentTime = GetTickCount64() * 10000LL;
-	if (mReferenceTime == 0) {
-		mReferenceTime = CurrentTime;
-	}
-	ts.Duration = CurrentTime - mReferenceTime;
-	sampleRequest->Sample = MediaStreamSample::CreateFromBuffer(mSample, ts);
+	ts.Duration = sampleTime;
+	MediaStreamSample^ sample = MediaStreamSample::CreateFromBuffer(mSample, ts);
+	TimeSpan sampleDuration;
+	sampleDuration.Duration = duration;
+	sample->Duration = sampleDuration;
+	sampleRequest->Sample = sample;
+	mLastSample = mSample;
 	mSample = nullptr;
 }
 
 void MSWinRTDisSampleHandler::RequestMediaElementRestart()
 {
-	mMutex.lock();
 	ms_message("[MSWinRTDis] RequestMediaElementRestart");
-	if (mReferenceTime != 0) {
-		StopMediaElement();
-		mReferenceTime = 0;
+	mMutex.lock();
+	bool started = mSampleClock.IsStarted();
+	if (started) {
+		mSampleClock.Reset();
 	}
 	mMutex.unlock();
+	// StopMediaElement takes the mutex to clear the sample requests.
+	if (started) {
+		StopMediaElement();
+	}
 }
 
 
 
 MSWinRTDis::MSWinRTDis()
-	: mIsInitialized(false), mIsActivated(false), mIsStarted(false), mSampleHandler(nullptr)
+	: mIsInitialized(false), mIsActivated(false), mIsStarted(false), mSampleHandler(nullptr),
+	mAsyncConversion(false), mConversionStage(ConversionQueueDepth, freemsg),
+	mDejitter(false), mDejitterBuffer(DejitterCapacity, freemsg), mReportedDrops(0)
 {
 	mSampleHandler = ref new MSWinRTDisSampleHandler();
+	mBufferPool = std::make_shared<FrameBufferPool>(BufferPoolSize);
+	ms_message("[MSWinRTDis] Using %s pixel conversion", YuvConverter::GetImplementationName());
 	mIsInitialized = true;
 }
 
@@ -211,6 +261,7 @@ void MSWinRTDis::start()
 {
 	if (!mIsStarted && mIsActivated) {
 		mIsStarted = true;
+		if (mAsyncConversion) startConversionStage();
 	}
 }
 
@@ -218,38 +269,63 @@ void MSWinRTDis::stop()
 {
 	if (mIsStarted) {
 		mIsStarted = false;
+		// The worker must be done with the MediaElement before it is stopped.
+		stopConversionStage();
+		clearDejitterBuffer();
 		mSampleHandler->StopMediaElement();
 	}
 }
 
+void MSWinRTDis::enableAsyncConversion(bool enable)
+{
+	if (enable) {
+		mAsyncConversion = true;
+		if (mIsStarted) startConversionStage();
+	} else {
+		// The worker is joined before the ticker goes back to rendering the frames itself.
+		stopConversionStage();
+		mAsyncConversion = false;
+	}
+	ms_message("[MSWinRTDis] Asynchronous conversion %s", enable ? "enabled" : "disabled");
+}
+
+void MSWinRTDis::startConversionStage()
+{
+	mConversionStage.Start([this](mblk_t *im) {
+		{
+			std::lock_guard<std::mutex> lock(mRenderMutex);
+			renderFrame(im);
+		}
+		freemsg(im);
+	});
+}
+
+void MSWinRTDis::stopConversionStage()
+{
+	if (!mConversionStage.IsRunning()) return;
+	mConversionStage.Stop();
+	ms_message("[MSWinRTDis] %llu frames converted asynchronously, %llu dropped",
+		mConversionStage.GetProcessedCount(), mConversionStage.GetDroppedCount());
+}
+
 int MSWinRTDis::feed(MSFilter *f)
 {
 	if (mIsStarted) {
 		mblk_t *im;
-		mblk_t *om;
-
-		if ((f->inputs[0] != NULL) && ((im = ms_queue_peek_last(f->inputs[0])) != NULL)) {
-			int size = 0;
-			MSPicture inbuf;
-			MSPicture outbuf;
-			if (ms_yuv_buf_init_from_mblk(&inbuf, im) == 0) {
-				if ((inbuf.w != mSampleHandler->Width) || (inbuf.h != mSampleHandler->Height)) {
-					mSampleHandler->Width = inbuf.w;
-					mSampleHandler->Height = inbuf.h;
-					mSampleHandler->RequestMediaElementRestart();
-				}
-				om = ms_yuv_buf_alloc(&outbuf, inbuf.w, inbuf.h);
-				int ysize = inbuf.w * inbuf.h;
-				int usize = ysize / 4;
-				uint8_t *buffer = outbuf.planes[0];
-				memcpy(buffer, inbuf.planes[0], ysize);
-				for (int i = 0; i < usize; i++) {
-					buffer[ysize + (i * 2)] = inbuf.planes[1][i];
-					buffer[ysize + (i * 2) + 1] = inbuf.planes[2][i];
+
+		if (mDejitter) {
+			if (f->inputs[0] != NULL) feedDejitterBuffer(f);
+		} else {
+			// The de-jitter buffer may have been disabled with frames in it.
+			if (mDejitterBuffer.GetCount() > 0) clearDejitterBuffer();
+			if ((f->inputs[0] != NULL) && ((im = ms_queue_peek_last(f->inputs[0])) != NULL)) {
+				if (mAsyncConversion) {
+					ms_queue_remove(f->inputs[0], im);
+					presentFrame(im);
+				} else {
+					std::lock_guard<std::mutex> lock(mRenderMutex);
+					renderFrame(im);
 				}
-				Microsoft::WRL::ComPtr<VideoBuffer> spVideoBuffer = NULL;
-				Microsoft::WRL::MakeAndInitialize<VideoBuffer>(&spVideoBuffer, buffer, (int)msgdsize(om), om);
-				mSampleHandler->Feed(VideoBuffer::GetIBuffer(spVideoBuffer));
 			}
 		}
 	}
@@ -264,6 +340,89 @@ int MSWinRTDis::feed(MSFilter *f)
 	return 0;
 }
 
+void MSWinRTDis::enableDejitter(bool enable)
+{
+	mDejitter = enable;
+	ms_message("[MSWinRTDis] De-jitter buffer %s", enable ? "enabled" : "disabled");
+}
+
+int MSWinRTDis::setLatencyBudget(int ms)
+{
+	if (ms <= 0) {
+		ms_error("[MSWinRTDis] Invalid latency budget %d ms", ms);
+		return -1;
+	}
+	mDejitterBuffer.SetLatencyBudget(ms);
+	ms_message("[MSWinRTDis] De-jitter latency budget set to %d ms", mDejitterBuffer.GetLatencyBudget());
+	return 0;
+}
+
+void MSWinRTDis::getDejitterStats(MSWinRTDejitterStats *stats)
+{
+	stats->rendered_frames = (int)mDejitterBuffer.GetReleasedCount();
+	stats->late_frames = (int)mDejitterBuffer.GetLateCount();
+	stats->overflow_frames = (int)mDejitterBuffer.GetOverflowCount();
+	stats->resyncs = (int)mDejitterBuffer.GetResyncCount();
+}
+
+void MSWinRTDis::feedDejitterBuffer(MSFilter *f)
+{
+	mblk_t *im;
+	while ((im = ms_queue_get(f->inputs[0])) != NULL) {
+		mDejitterBuffer.Push(im, mblk_get_timestamp_info(im), f->ticker->time);
+	}
+	if ((im = mDejitterBuffer.Pop(f->ticker->time)) != NULL) {
+		presentFrame(im);
+	}
+	uint64_t lateCount = mDejitterBuffer.GetLateCount();
+	uint64_t overflowCount = mDejitterBuffer.GetOverflowCount();
+	if ((lateCount + overflowCount) != mReportedDrops) {
+		ms_warning("[MSWinRTDis] De-jitter buffer dropped %llu frames, %llu late and %llu overflowing in total",
+			lateCount + overflowCount - mReportedDrops, lateCount, overflowCount);
+		mReportedDrops = lateCount + overflowCount;
+	}
+}
+
+void MSWinRTDis::clearDejitterBuffer()
+{
+	if (mDejitterBuffer.GetCount() > 0) {
+		ms_message("[MSWinRTDis] Discarding %u frames of the de-jitter buffer", (unsigned int)mDejitterBuffer.GetCount());
+	}
+	mDejitterBuffer.Clear();
+}
+
+void MSWinRTDis::presentFrame(mblk_t *im)
+{
+	if (!mAsyncConversion || !mConversionStage.Push(im)) {
+		{
+			std::lock_guard<std::mutex> lock(mRenderMutex);
+			renderFrame(im);
+		}
+		freemsg(im);
+	}
+}
+
+void MSWinRTDis::renderFrame(mblk_t *im)
+{
+	MSPicture inbuf;
+	if (ms_yuv_buf_init_from_mblk(&inbuf, im) == 0) {
+		if ((inbuf.w != mSampleHandler->Width) || (inbuf.h != mSampleHandler->Height)) {
+			mSampleHandler->Width = inbuf.w;
+			mSampleHandler->Height = inbuf.h;
+			mSampleHandler->RequestMediaElementRestart();
+			mBufferPool->Reset();
+		}
+		// Same size as the I420 picture, the chroma planes being interleaved.
+		int size = (inbuf.w * inbuf.h * 3) / 2;
+		uint8_t *buffer = mBufferPool->Get(size);
+		YuvConverter::I420ToNV12(inbuf.planes[0], inbuf.strides[0], inbuf.planes[1], inbuf.strides[1], inbuf.planes[2], inbuf.strides[2],
+			buffer, inbuf.w, buffer + inbuf.w * inbuf.h, inbuf.w, inbuf.w, inbuf.h);
+		Microsoft::WRL::ComPtr<VideoBuffer> spVideoBuffer = NULL;
+		Microsoft::WRL::MakeAndInitialize<VideoBuffer>(&spVideoBuffer, buffer, size, mBufferPool);
+		mSampleHandler->Feed(VideoBuffer::GetIBuffer(spVideoBuffer));
+	}
+}
+
 MSVideoSize MSWinRTDis::getVideoSize()
 {
 	MSVideoSize vs;
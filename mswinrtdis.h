@@ -25,12 +25,19 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
 #include "mswinrtvid.h"
+#include "AsyncFrameStage.h"
+#include "DejitterBuffer.h"
+#include "FrameBufferPool.h"
+#include "MonotonicClock.h"
+#include "PendingRequestRing.h"
 
 #include <mediastreamer2/rfc3984.h>
 
 #include <collection.h>
 #include <ppltasks.h>
+#include <atomic>
 #include <mutex>
+#include <vector>
 #include <robuffer.h>
 #include <windows.storage.streams.h>
 
@@ -39,32 +46,11 @@ namespace libmswinrtvid
 {
 	class MSWinRTDis;
 
-	private ref class MSWinRTDisDeferral sealed
+	/// A sample request waiting for a frame, with the deferral to complete once it has been answered.
+	struct MSWinRTDisDeferral
 	{
-	public:
-		MSWinRTDisDeferral(Windows::Media::Core::MediaStreamSourceSampleRequest^ request, Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ deferral)
-		{
-			this->Request = request;
-			this->Deferral = deferral;
-		}
-
-		property Windows::Media::Core::MediaStreamSourceSampleRequest^ Request
-		{
-			Windows::Media::Core::MediaStreamSourceSampleRequest^ get() { return mRequest; }
-			void set(Windows::Media::Core::MediaStreamSourceSampleRequest^ value) { mRequest = value; }
-		}
-
-		property Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ Deferral
-		{
-			Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ get() { return mDeferral; }
-			void set(Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ value) { mDeferral = value; }
-		}
-
-	private:
-		~MSWinRTDisDeferral() {};
-
-		Windows::Media::Core::MediaStreamSourceSampleRequest^ mRequest;
-		Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ mDeferral;
+		Windows::Media::Core::MediaStreamSourceSampleRequest^ Request;
+		Windows::Media::Core::MediaStreamSourceSampleRequestDeferral^ Deferral;
 	};
 
 	private ref class MSWinRTDisSampleHandler sealed
@@ -104,11 +90,21 @@ namespace libmswinrtvid
 
 	private:
 		void AnswerSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest);
+		// Returns true if the oldest request was evicted and answered, the caller completes it once the mutex is released.
+		bool DeferSampleRequest(Windows::Media::Core::MediaStreamSourceSampleRequest^ sampleRequest, MSWinRTDisDeferral &evicted);
+		// Completes the pending requests and marks the MediaElement as stopped, takes the mutex.
+		void ClearSampleRequests();
+
+		static const size_t MaxPendingRequests = 4;
 
 		Windows::Storage::Streams::IBuffer^ mSample;
-		Platform::Collections::Vector<MSWinRTDisDeferral^>^ mDeferralQueue;
+		// MonotonicClock time at which mSample was fed.
+		int64_t mSampleArrival;
+		// Last frame answered, repeated for an evicted request.
+		Windows::Storage::Streams::IBuffer^ mLastSample;
+		PendingRequestRing<MSWinRTDisDeferral> mDeferralQueue;
 		Windows::UI::Xaml::Controls::MediaElement^ mMediaElement;
-		UINT64 mReferenceTime;
+		SampleClock mSampleClock;
 		std::mutex mMutex;
 		MSPixFmt mPixFmt;
 		int mWidth;
@@ -119,6 +115,13 @@ namespace libmswinrtvid
 
 	class MSWinRTDis {
 	public:
+		/// Buffers kept for reuse: the MediaElement holds a couple of frames at most.
+		static const int BufferPoolSize = 4;
+		/// Frames waiting for the worker in asynchronous conversion.
+		static const int ConversionQueueDepth = 2;
+		/// Frames held by the de-jitter buffer at most, 500 ms at 30 fps.
+		static const int DejitterCapacity = 16;
+
 		MSWinRTDis();
 		virtual ~MSWinRTDis();
 
@@ -131,12 +134,37 @@ namespace libmswinrtvid
 		MSVideoSize getVideoSize();
 		void setVideoSize(MSVideoSize vs);
 		void setMediaElement(Windows::UI::Xaml::Controls::MediaElement^ mediaElement) { mSampleHandler->MediaElement = mediaElement; }
+		bool isAsyncConversion() { return mAsyncConversion; }
+		void enableAsyncConversion(bool enable);
+		int getDroppedFrames() { return (int)mConversionStage.GetDroppedCount(); }
+		bool isDejittering() { return mDejitter; }
+		void enableDejitter(bool enable);
+		int getLatencyBudget() { return mDejitterBuffer.GetLatencyBudget(); }
+		int setLatencyBudget(int ms);
+		void getDejitterStats(MSWinRTDejitterStats *stats);
 
 	private:
+		void renderFrame(mblk_t *im);
+		void presentFrame(mblk_t *im);
+		void feedDejitterBuffer(MSFilter *f);
+		void clearDejitterBuffer();
+		void startConversionStage();
+		void stopConversionStage();
+
 		bool mIsInitialized;
 		bool mIsActivated;
 		bool mIsStarted;
 		MSWinRTDisSampleHandler^ mSampleHandler;
 		Windows::Media::Core::MediaStreamSource^ mMediaStreamSource;
+		std::shared_ptr<FrameBufferPool> mBufferPool;
+		// Switched by the application thread, read by the ticker.
+		std::atomic<bool> mAsyncConversion;
+		// Serializes renderFrame between the ticker and the worker, that may both render while the stage stops
+		// since Push is then refused.
+		std::mutex mRenderMutex;
+		AsyncFrameStage<mblk_t *> mConversionStage;
+		bool mDejitter;
+		DejitterBuffer<mblk_t *> mDejitterBuffer;
+		uint64_t mReportedDrops;
 	};
 }
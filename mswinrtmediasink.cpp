@@ -190,10 +190,19 @@ MSWinRTStreamSink::MSWinRTStreamSink(DWORD dwIdentifier)
 #pragma warning(push)
 #pragma warning(disable:4355)
 	, _WorkQueueCB(this, &MSWinRTStreamSink::OnDispatchWorkItem)
+	, _QueueDispatcher([this]() { return SUCCEEDED(QueueAsyncOperation(OpProcessSample)); })
 #pragma warning(pop)
+	, _cSampleRequests(0)
+	, _fCaptureShutdown(false)
 {
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	_LockHolds.SetFrequency(frequency.QuadPart);
+	_LockWaits.SetFrequency(frequency.QuadPart);
 	ZeroMemory(&_guiCurrentSubtype, sizeof(_guiCurrentSubtype));
 	_guiCurrentFrameSize = 0;
+	for (int op = 0; op < Op_Count; op++)
+		_AsyncOperations[op].Initialize(this, (StreamOperation)op);
 	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink constructor");
 }
 
@@ -203,27 +212,27 @@ MSWinRTStreamSink::~MSWinRTStreamSink()
 }
 
 
-MSWinRTStreamSink::MSWinRTAsyncOperation::MSWinRTAsyncOperation(StreamOperation op)
-	: _cRef(1), m_op(op)
+MSWinRTStreamSink::MSWinRTAsyncOperation::MSWinRTAsyncOperation()
+	: m_op(OpSetMediaType), m_pParent(nullptr)
 {
 }
 
-MSWinRTStreamSink::MSWinRTAsyncOperation::~MSWinRTAsyncOperation()
+void MSWinRTStreamSink::MSWinRTAsyncOperation::Initialize(MSWinRTStreamSink *pParent, StreamOperation op)
 {
+	m_pParent = pParent;
+	m_op = op;
 }
 
 ULONG MSWinRTStreamSink::MSWinRTAsyncOperation::AddRef()
 {
-	return InterlockedIncrement(&_cRef);
+	// Delegate to the parent stream.
+	return m_pParent->AddRef();
 }
 
 ULONG MSWinRTStreamSink::MSWinRTAsyncOperation::Release()
 {
-	ULONG cRef = InterlockedDecrement(&_cRef);
-	if (cRef == 0) {
-		delete this;
-	}
-	return cRef;
+	// Delegate to the parent stream.
+	return m_pParent->Release();
 }
 
 HRESULT MSWinRTStreamSink::MSWinRTAsyncOperation::QueryInterface(REFIID iid, void **ppv)
@@ -405,7 +414,11 @@ IFACEMETHODIMP MSWinRTStreamSink::ProcessSample(IMFSample *pSample)
 		RETURN_HR(E_INVALIDARG)
 
 	HRESULT hr = S_OK;
+	LARGE_INTEGER waitStart, waitEnd;
+	QueryPerformanceCounter(&waitStart);
 	AutoLock lock(_critSec);
+	QueryPerformanceCounter(&waitEnd);
+	_LockWaits.Record(waitEnd.QuadPart - waitStart.QuadPart);
 	hr = CheckShutdown();
 	// Validate the operation.
 	if (SUCCEEDED(hr))
@@ -420,11 +433,12 @@ IFACEMETHODIMP MSWinRTStreamSink::ProcessSample(IMFSample *pSample)
 		if (SUCCEEDED(hr))
 			hr = _SampleQueue.InsertBack(pSample);
 
-		// Unless we are paused, start an async operation to dispatch the next sample.
+		// Unless we are paused, make sure an async operation will dispatch the queued samples.
 		if (SUCCEEDED(hr)) {
 			if (_state != State_Paused) {
-				// Queue the operation.
-				hr = QueueAsyncOperation(OpProcessSample);
+				// One sample will be requested in return, once the queue has been drained.
+				_cSampleRequests++;
+				hr = ScheduleQueueDrain();
 			}
 		}
 	}
@@ -458,8 +472,8 @@ IFACEMETHODIMP MSWinRTStreamSink::PlaceMarker(MFSTREAMSINK_MARKER_TYPE eMarkerTy
 	// Unless we are paused, start an async operation to dispatch the next sample/marker.
 	if (SUCCEEDED(hr)) {
 		if (_state != State_Paused) {
-			// Queue the operation.
-			hr = QueueAsyncOperation(OpPlaceMarker); // Increments ref count on pOp.
+			// Queue the operation, unless one is already pending.
+			hr = ScheduleQueueDrain();
 		}
 	}
 	RETURN_HR(hr)
@@ -775,11 +789,19 @@ HRESULT MSWinRTStreamSink::Shutdown()
 	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::Shutdown");
 	AutoLock lock(_critSec);
 	if (!_IsShutdown) {
+		{
+			// Wait for the conversion in progress, the next ones are skipped.
+			AutoLock captureLock(_captureCritSec);
+			_fCaptureShutdown = true;
+		}
+		if (_LockHolds.GetCount() > 0)
+			ReportLockHolds();
 		if (_spEventQueue)
 			_spEventQueue->Shutdown();
 
 		MFUnlockWorkQueue(_WorkQueueId);
 		_SampleQueue.Clear();
+		_ReadyQueue.Clear();
 		_spSink.Reset();
 		_spEventQueue.Reset();
 		_spByteStream.Reset();
@@ -793,13 +815,19 @@ HRESULT MSWinRTStreamSink::Shutdown()
 HRESULT MSWinRTStreamSink::QueueAsyncOperation(StreamOperation op)
 {
 	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::QueueAsyncOperation");
+	// The preallocated operation object holds a reference on the stream until the work item is dispatched.
+	HRESULT hr = MFPutWorkItem2(_WorkQueueId, 0, &_WorkQueueCB, &_AsyncOperations[op]);
+	RETURN_HR(hr)
+}
+
+// Samples, markers and format changes are all drained from _SampleQueue by a single pending work item,
+// so a burst of samples results in one work queue callback.
+HRESULT MSWinRTStreamSink::ScheduleQueueDrain()
+{
+	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::ScheduleQueueDrain");
 	HRESULT hr = S_OK;
-	ComPtr<MSWinRTAsyncOperation> spOp;
-	spOp.Attach(new MSWinRTAsyncOperation(op)); // Created with ref count = 1
-	if (!spOp)
-		hr = E_OUTOFMEMORY;
-	if (SUCCEEDED(hr))
-		hr = MFPutWorkItem2(_WorkQueueId, 0, &_WorkQueueCB, spOp.Get());
+	if (!_QueueDispatcher.Schedule())
+		hr = E_FAIL;
 	RETURN_HR(hr)
 }
 
@@ -807,7 +835,9 @@ HRESULT MSWinRTStreamSink::OnDispatchWorkItem(IMFAsyncResult *pAsyncResult)
 {
 	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::OnDispatchWorkItem");
 	// Called by work queue thread. Need to hold the critical section.
-	AutoLock lock(_critSec);
+	LARGE_INTEGER lockStart, lockEnd;
+	_critSec.Lock();
+	QueryPerformanceCounter(&lockStart);
 
 	try {
 		ComPtr<IUnknown> spState;
@@ -862,29 +892,34 @@ HRESULT MSWinRTStreamSink::OnDispatchWorkItem(IMFAsyncResult *pAsyncResult)
 		case OpProcessSample:
 		case OpPlaceMarker:
 		case OpSetMediaType:
-			DispatchProcessSample(pOp);
+			DispatchProcessSample();
 			break;
 		}
 	} catch (Exception ^exc) {
 		HandleError(exc->HResult);
 	}
 
+	QueryPerformanceCounter(&lockEnd);
+	RecordLockHold(lockEnd.QuadPart - lockStart.QuadPart);
+	_critSec.Unlock();
+
+	DeliverReadySamples();
 	return S_OK;
 }
 
-// Complete a ProcessSample or PlaceMarker request.
-void MSWinRTStreamSink::DispatchProcessSample(MSWinRTAsyncOperation *pOp)
+// Complete the ProcessSample, PlaceMarker and format change requests queued so far.
+void MSWinRTStreamSink::DispatchProcessSample()
 {
 	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::DispatchProcessSample");
-	bool fRequestMoreSamples = SendSampleFromQueue();
+	_QueueDispatcher.BeginDrain();
 
-	// Ask for another sample
-	if (fRequestMoreSamples) {
-		if (pOp->m_op == OpProcessSample) {
-			HRESULT hr = QueueEvent(MEStreamSinkRequestSample, GUID_NULL, S_OK, nullptr);
-			if (FAILED(hr))
-				throw ref new Exception(hr);
-		}
+	SendSampleFromQueue();
+
+	// Ask for another sample for each sample that has been processed.
+	for (; _cSampleRequests > 0; _cSampleRequests--) {
+		HRESULT hr = QueueEvent(MEStreamSinkRequestSample, GUID_NULL, S_OK, nullptr);
+		if (FAILED(hr))
+			throw ref new Exception(hr);
 	}
 }
 
@@ -909,7 +944,18 @@ bool MSWinRTStreamSink::ProcessSamplesFromQueue(bool fFlush)
 	bool fNeedMoreSamples = false;
 	ComPtr<IUnknown> spunkSample;
 	bool fSendSamples = true;
-	bool fSendEOS = false;
+
+	if (fFlush) {
+		// Wait for the conversion in progress, so that no marker event is sent before the sample ahead of it.
+		// Same lock order as Shutdown, DeliverReadySamples never takes _critSec with _captureCritSec held.
+		AutoLock captureLock(_captureCritSec);
+		// Drop the samples handed over to DeliverReadySamples but not taken yet, and send the events of the
+		// markers queued between them, so that they go before the markers still in _SampleQueue.
+		ComPtr<IMFSample> spDropped;
+		while (TakeReadySample(spDropped)) {
+			spDropped.Reset();
+		}
+	}
 
 	if (FAILED(_SampleQueue.RemoveFront(&spunkSample))) {
 		fNeedMoreSamples = true;
@@ -920,34 +966,23 @@ bool MSWinRTStreamSink::ProcessSamplesFromQueue(bool fFlush)
 		ComPtr<IMFSample> spSample;
 
 		// Figure out if this is a marker or a sample.
-		// If this is a sample, write it to the file.
 		// Now handle the sample/marker appropriately.
 		if (SUCCEEDED(spunkSample.As(&spSample))) {
 			if (!fFlush) {
-				// Prepare sample for sending
-				if (FAILED(PrepareSample(spSample.Get()))) {
-					fSendSamples = false;
-				}
+				// Hand the sample over to DeliverReadySamples, it is converted once the critical section is released.
+				HRESULT hr = _ReadyQueue.InsertBack(spSample.Get());
+				if (FAILED(hr)) throw ref new Exception(hr);
 			}
 		} else {
 			ComPtr<IMarker> spMarker;
 			// Check if it is a marker
 			if (SUCCEEDED(spunkSample.As(&spMarker))) {
-				MFSTREAMSINK_MARKER_TYPE markerType;
-				PROPVARIANT var;
-				HRESULT hr;
-				PropVariantInit(&var);
-				hr = spMarker->GetMarkerType(&markerType);
-				if (FAILED(hr)) throw ref new Exception(hr);
-				// Get the context data.
-				hr = spMarker->GetContext(&var);
-				if (FAILED(hr)) throw ref new Exception(hr);
-				hr = QueueEvent(MEStreamSinkMarker, GUID_NULL, S_OK, &var);
-				PropVariantClear(&var);
-				if (FAILED(hr)) throw ref new Exception(hr);
-
-				if (markerType == MFSTREAMSINK_MARKER_ENDOFSEGMENT) {
-					fSendEOS = true;
+				if (fFlush) {
+					ProcessMarker(spMarker.Get());
+				} else {
+					// Keep the marker behind the samples handed over before it.
+					HRESULT hr = _ReadyQueue.InsertBack(spMarker.Get());
+					if (FAILED(hr)) throw ref new Exception(hr);
 				}
 			}
 #if 0 // TODO
@@ -970,14 +1005,96 @@ bool MSWinRTStreamSink::ProcessSamplesFromQueue(bool fFlush)
 		}
 	}
 
-	if (fSendEOS)
-	{
+	return fNeedMoreSamples;
+}
+
+// Send the event of a marker, once all the samples received before it have been processed.
+void MSWinRTStreamSink::ProcessMarker(IMarker *pMarker)
+{
+	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::ProcessMarker");
+	MFSTREAMSINK_MARKER_TYPE markerType;
+	PROPVARIANT var;
+	HRESULT hr;
+	PropVariantInit(&var);
+	hr = pMarker->GetMarkerType(&markerType);
+	if (FAILED(hr)) throw ref new Exception(hr);
+	// Get the context data.
+	hr = pMarker->GetContext(&var);
+	if (FAILED(hr)) throw ref new Exception(hr);
+	hr = QueueEvent(MEStreamSinkMarker, GUID_NULL, S_OK, &var);
+	PropVariantClear(&var);
+	if (FAILED(hr)) throw ref new Exception(hr);
+
+	if (markerType == MFSTREAMSINK_MARKER_ENDOFSEGMENT) {
 		ComPtr<MSWinRTMediaSink> spParent = _pParent;
 		concurrency::create_task([spParent]() {
 			spParent->ReportEndOfStream();
 		});
 	}
-	return fNeedMoreSamples;
+}
+
+// Called by the work queue thread after it has released the critical section: convert the samples and
+// send the marker events handed over by ProcessSamplesFromQueue, in their order of arrival.
+// The items are taken under the critical section, for a flush not to reorder the markers, but only the
+// capture lock is held during a conversion, so that Shutdown can wait for it to complete.
+void MSWinRTStreamSink::DeliverReadySamples()
+{
+	MSWINRTMEDIASINK_DEBUG("MSWinRTStreamSink::DeliverReadySamples");
+	for (;;) {
+		ComPtr<IMFSample> spSample;
+		_critSec.Lock();
+		bool fSample = TakeReadySample(spSample);
+		_critSec.Unlock();
+		if (!fSample)
+			break;
+		AutoLock captureLock(_captureCritSec);
+		if (_fCaptureShutdown)
+			continue;
+		// Stop sending samples on a failure, the items left are delivered by the next work item or dropped by a flush.
+		if (FAILED(PrepareSample(spSample.Get())))
+			break;
+	}
+}
+
+// Send the events of the markers at the front of _ReadyQueue, then take the sample behind them, if any.
+// Called with _critSec held. Returns false once _ReadyQueue is empty.
+bool MSWinRTStreamSink::TakeReadySample(ComPtr<IMFSample> &spSample)
+{
+	ComPtr<IUnknown> spunkItem;
+	while (SUCCEEDED(_ReadyQueue.RemoveFront(spunkItem.ReleaseAndGetAddressOf()))) {
+		ComPtr<IMarker> spMarker;
+		if (SUCCEEDED(spunkItem.As(&spSample))) {
+			return true;
+		} else if (SUCCEEDED(spunkItem.As(&spMarker))) {
+			try {
+				ProcessMarker(spMarker.Get());
+			} catch (Exception ^exc) {
+				HandleError(exc->HResult);
+			}
+		}
+	}
+	return false;
+}
+
+// Called with _critSec held.
+void MSWinRTStreamSink::RecordLockHold(LONGLONG ticks)
+{
+	_LockHolds.Record(ticks);
+	if (_LockHolds.GetCount() >= LockReportInterval)
+		ReportLockHolds();
+}
+
+// Called with _critSec held.
+void MSWinRTStreamSink::ReportLockHolds()
+{
+	ms_message("MSWinRTStreamSink: work item critical section held %u times, %.1f us on average, %.1f us at most",
+		_LockHolds.GetCount(), _LockHolds.GetAverageUs(), _LockHolds.GetMaxUs());
+	if (_LockWaits.GetCount() > 0) {
+		ms_message("MSWinRTStreamSink: ProcessSample waited %u times for the critical section, %.1f us on average, %.1f us at most",
+			_LockWaits.GetCount(), _LockWaits.GetAverageUs(), _LockWaits.GetMaxUs());
+	}
+	_LockHolds.Reset();
+	_LockWaits.Reset();
 }
 
 // Processing format change
@@ -991,7 +1108,7 @@ void MSWinRTStreamSink::ProcessFormatChange(IMFMediaType *pMediaType)
 
 	// Unless we are paused, start an async operation to dispatch the next sample.
 	// Queue the operation.
-	hr = QueueAsyncOperation(OpSetMediaType);
+	hr = ScheduleQueueDrain();
 	if (FAILED(hr))
 		throw ref new Exception(hr);
 }
@@ -1304,9 +1421,18 @@ void MSWinRTMediaSink::ReportEndOfStream()
 	++_cStreamsEnded;
 }
 
+void MSWinRTMediaSink::SetCaptureFilter(MSWinRTCapHelper^ capture)
+{
+	MSWINRTMEDIASINK_DEBUG("MSWinRTMediaSink::SetCaptureFilter");
+	// Wait for the conversion in progress, if any, before the capture filter is changed.
+	AutoLock lock(_captureCritSec);
+	_capture = capture;
+}
+
 void MSWinRTMediaSink::OnSampleAvailable(BYTE *buf, DWORD bufLen, LONGLONG presentationTime)
 {
 	MSWINRTMEDIASINK_DEBUG("MSWinRTMediaSink::OnSampleAvailable");
+	AutoLock lock(_captureCritSec);
 	if (_capture != nullptr) {
 		_capture->OnSampleAvailable(buf, bufLen, presentationTime);
 	}
@@ -16,7 +16,9 @@
 #include <wrl\ftm.h>
 #include <ppltasks.h>
 
-#include "LinkList.h"
+#include "CoalescingDispatcher.h"
+#include "ComPtrRingQueue.h"
+#include "LockHoldMeter.h"
 
 using namespace Platform;
 using namespace Microsoft::WRL;
@@ -207,11 +209,15 @@ namespace libmswinrtvid {
 		// Used to queue asynchronous operations. When we call MFPutWorkItem, we use this
 		// object for the callback state (pState). Then, when the callback is invoked,
 		// we can use the object to determine which asynchronous operation to perform.
+		// The stream owns one operation object per StreamOperation, reused by every work item
+		// of this type. It has no state of its own, so several of them can be in flight at once,
+		// and its reference count is the one of the stream.
 
 		class MSWinRTAsyncOperation : public IUnknown
 		{
 		public:
-			MSWinRTAsyncOperation(StreamOperation op);
+			MSWinRTAsyncOperation();
+			void Initialize(MSWinRTStreamSink *pParent, StreamOperation op);
 
 			StreamOperation m_op;   // The operation to perform.
 
@@ -221,8 +227,7 @@ namespace libmswinrtvid {
 			STDMETHODIMP_(ULONG) Release();
 
 		private:
-			long _cRef;
-			virtual ~MSWinRTAsyncOperation();
+			MSWinRTStreamSink *m_pParent;
 		};
 
 	public:
@@ -257,6 +262,9 @@ namespace libmswinrtvid {
 		// are valid from which states.
 		static BOOL ValidStateMatrix[State_Count][Op_Count];
 
+		// Work items between two reports of the lock hold times, about 30 s of 30 fps video.
+		static const unsigned int LockReportInterval = 900;
+
 
 		MSWinRTStreamSink(DWORD dwIdentifier);
 		virtual ~MSWinRTStreamSink();
@@ -278,11 +286,17 @@ namespace libmswinrtvid {
 	private:
 		HRESULT     ValidateOperation(StreamOperation op);
 		HRESULT     QueueAsyncOperation(StreamOperation op);
+		HRESULT     ScheduleQueueDrain();
 		HRESULT     OnDispatchWorkItem(IMFAsyncResult *pAsyncResult);
-		void        DispatchProcessSample(MSWinRTAsyncOperation *pOp);
+		void        DispatchProcessSample();
 		bool        DropSamplesFromQueue();
 		bool        SendSampleFromQueue();
 		bool        ProcessSamplesFromQueue(bool fFlush);
+		void        ProcessMarker(IMarker *pMarker);
+		void        DeliverReadySamples();
+		bool        TakeReadySample(ComPtr<IMFSample> &spSample);
+		void        RecordLockHold(LONGLONG ticks);
+		void        ReportLockHolds();
 		void        ProcessFormatChange(IMFMediaType *pMediaType);
 		HRESULT		PrepareSample(IMFSample *pSample);
 		void        HandleError(HRESULT hr);
@@ -311,10 +325,22 @@ namespace libmswinrtvid {
 		ComPtr<IMFMediaType>        _spCurrentType;
 		ComPtr<IMFSample>           _spFirstVideoSample;
 
-		ComPtrList<IUnknown>        _SampleQueue;               // Queue to hold samples and markers.
+		ComPtrRingQueue<IUnknown>   _SampleQueue;               // Queue to hold samples and markers.
 																// Applies to: ProcessSample, PlaceMarker
 
 		AsyncCallback<MSWinRTStreamSink>  _WorkQueueCB;              // Callback for the work queue.
+		MSWinRTAsyncOperation       _AsyncOperations[Op_Count]; // State objects of the work items, one per operation.
+		CoalescingDispatcher        _QueueDispatcher;           // At most one pending work item draining _SampleQueue.
+		DWORD                       _cSampleRequests;           // Samples to request once _SampleQueue is drained.
+
+		ComPtrRingQueue<IUnknown>   _ReadyQueue;                // Samples and markers taken out of _SampleQueue, to convert outside _critSec. Guarded by _critSec.
+		CritSec                     _captureCritSec;            // Held while a sample is converted, Shutdown waits for it.
+		bool                        _fCaptureShutdown;          // Set by Shutdown under _captureCritSec, no more sample is converted.
+
+		// Time the work queue callback holds _critSec and time ProcessSample waits for it, in QueryPerformanceCounter ticks.
+		// Both are guarded by _critSec and logged every LockReportInterval work items.
+		LockHoldMeter               _LockHolds;
+		LockHoldMeter               _LockWaits;
 
 		ComPtr<IUnknown>            _spFTM;
 	};
@@ -360,7 +386,7 @@ namespace libmswinrtvid {
 		LONGLONG GetStartTime() const { return _llStartTime; }
 
 		void ReportEndOfStream();
-		void SetCaptureFilter(MSWinRTCapHelper^ capture) { _capture = capture; }
+		void SetCaptureFilter(MSWinRTCapHelper^ capture);
 		void OnSampleAvailable(BYTE *buf, DWORD bufLen, LONGLONG presentationTime);
 
 	private:
@@ -378,6 +404,7 @@ namespace libmswinrtvid {
 	private:
 		ComPtr<IMFStreamSink> _stream;
 		MSWinRTCapHelper^ _capture;
+		CritSec _captureCritSec;    // Guards _capture, held while a sample is converted so that the filter is not cleared meanwhile.
 
 		long                            _cRef;                      // reference count
 		CritSec							_critSec;                   // critical section for thread safety
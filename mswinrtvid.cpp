@@ -91,6 +91,21 @@ static int ms_winrtcap_set_fps(MSFilter *f, void *arg) {
 	return 0;
 }
 
+static int ms_winrtcap_get_frame_rate(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	MSWinRTFrameRate *rate = (MSWinRTFrameRate *)arg;
+	FrameRate frameRate = r->getFrameRate();
+	rate->numerator = frameRate.Numerator;
+	rate->denominator = frameRate.Denominator;
+	return 0;
+}
+
+static int ms_winrtcap_set_frame_rate(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	MSWinRTFrameRate *rate = (MSWinRTFrameRate *)arg;
+	return r->setFrameRate(FrameRate::FromFraction(rate->numerator, rate->denominator));
+}
+
 static int ms_winrtcap_get_pix_fmt(MSFilter *f, void *arg) {
 	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
 	MSPixFmt *fmt = static_cast<MSPixFmt *>(arg);
@@ -98,6 +113,87 @@ static int ms_winrtcap_get_pix_fmt(MSFilter *f, void *arg) {
 	return 0;
 }
 
+static int ms_winrtcap_set_pix_fmt(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	MSPixFmt *fmt = static_cast<MSPixFmt *>(arg);
+	return r->setPixFmt(*fmt);
+}
+
+static int ms_winrtcap_get_simulcast_layers(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((int *)arg) = r->getSimulcastLayers();
+	return 0;
+}
+
+static int ms_winrtcap_set_simulcast_layers(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	r->setSimulcastLayers(*((int *)arg));
+	return 0;
+}
+
+static int ms_winrtcap_is_mirroring(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((bool_t *)arg) = r->isMirroring() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtcap_enable_mirroring(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	r->enableMirroring(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtcap_get_queue_depth(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((int *)arg) = r->getQueueDepth();
+	return 0;
+}
+
+static int ms_winrtcap_set_queue_depth(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	return r->setQueueDepth(*((int *)arg));
+}
+
+static int ms_winrtcap_get_overflow_policy(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((int *)arg) = r->getOverflowPolicy();
+	return 0;
+}
+
+static int ms_winrtcap_set_overflow_policy(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	return r->setOverflowPolicy(*((int *)arg));
+}
+
+static int ms_winrtcap_get_dropped_frames(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((int *)arg) = r->getDroppedFrames();
+	return 0;
+}
+
+static int ms_winrtcap_is_pacing(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((bool_t *)arg) = r->isPacing() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtcap_enable_pacing(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	r->enablePacing(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtcap_get_max_latency(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	*((int *)arg) = r->getMaxLatency();
+	return 0;
+}
+
+static int ms_winrtcap_set_max_latency(MSFilter *f, void *arg) {
+	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
+	return r->setMaxLatency(*((int *)arg));
+}
+
 static int ms_winrtcap_get_vsize(MSFilter *f, void *arg) {
 	MSWinRTCap *r = static_cast<MSWinRTCap *>(f->data);
 	MSVideoSize *vs = static_cast<MSVideoSize *>(arg);
@@ -125,9 +221,25 @@ static MSFilterMethod ms_winrtcap_read_methods[] = {
 	{ MS_FILTER_GET_FPS,                           ms_winrtcap_get_fps                    },
 	{ MS_FILTER_SET_FPS,                           ms_winrtcap_set_fps                    },
 	{ MS_FILTER_GET_PIX_FMT,                       ms_winrtcap_get_pix_fmt                },
+	{ MS_FILTER_SET_PIX_FMT,                       ms_winrtcap_set_pix_fmt                },
 	{ MS_FILTER_GET_VIDEO_SIZE,                    ms_winrtcap_get_vsize                  },
 	{ MS_FILTER_SET_VIDEO_SIZE,                    ms_winrtcap_set_vsize                  },
 	{ MS_VIDEO_CAPTURE_SET_DEVICE_ORIENTATION,     ms_winrtcap_set_device_orientation     },
+	{ MS_WINRTCAP_GET_SIMULCAST_LAYERS,            ms_winrtcap_get_simulcast_layers       },
+	{ MS_WINRTCAP_SET_SIMULCAST_LAYERS,            ms_winrtcap_set_simulcast_layers       },
+	{ MS_WINRTCAP_IS_MIRRORING,                    ms_winrtcap_is_mirroring               },
+	{ MS_WINRTCAP_ENABLE_MIRRORING,                ms_winrtcap_enable_mirroring           },
+	{ MS_WINRTCAP_GET_QUEUE_DEPTH,                 ms_winrtcap_get_queue_depth            },
+	{ MS_WINRTCAP_SET_QUEUE_DEPTH,                 ms_winrtcap_set_queue_depth            },
+	{ MS_WINRTCAP_GET_OVERFLOW_POLICY,             ms_winrtcap_get_overflow_policy        },
+	{ MS_WINRTCAP_SET_OVERFLOW_POLICY,             ms_winrtcap_set_overflow_policy        },
+	{ MS_WINRTCAP_GET_DROPPED_FRAMES,              ms_winrtcap_get_dropped_frames         },
+	{ MS_WINRTCAP_IS_PACING,                       ms_winrtcap_is_pacing                  },
+	{ MS_WINRTCAP_ENABLE_PACING,                   ms_winrtcap_enable_pacing              },
+	{ MS_WINRTCAP_GET_MAX_LATENCY,                 ms_winrtcap_get_max_latency            },
+	{ MS_WINRTCAP_SET_MAX_LATENCY,                 ms_winrtcap_set_max_latency            },
+	{ MS_WINRTCAP_GET_FRAME_RATE,                  ms_winrtcap_get_frame_rate             },
+	{ MS_WINRTCAP_SET_FRAME_RATE,                  ms_winrtcap_set_frame_rate             },
 	{ 0,                                           NULL                                   }
 };
 
@@ -142,7 +254,7 @@ static MSFilterMethod ms_winrtcap_read_methods[] = {
 #define MS_WINRTCAP_READ_CATEGORY    MS_FILTER_OTHER
 #define MS_WINRTCAP_READ_ENC_FMT     NULL
 #define MS_WINRTCAP_READ_NINPUTS     0
-#define MS_WINRTCAP_READ_NOUTPUTS    1
+#define MS_WINRTCAP_READ_NOUTPUTS    3
 #define MS_WINRTCAP_READ_FLAGS       0
 
 MSFilterDesc ms_winrtcap_read_desc = {
@@ -180,6 +292,7 @@ static MSFilter *ms_winrtcap_create_reader(MSWebCam *cam) {
 	r->setDeviceId(ref new Platform::String(winrtcam->id));
 	r->setFront(winrtcam->front == TRUE);
 	r->setExternal(winrtcam->external == TRUE);
+	r->setWebcam(winrtcam);
 	return f;
 }
 
@@ -252,10 +365,65 @@ static int ms_winrtdis_set_native_window_id(MSFilter *f, void *arg) {
 	return 0;
 }
 
+static int ms_winrtdis_is_async_conversion(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	*((bool_t *)arg) = w->isAsyncConversion() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtdis_enable_async_conversion(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	w->enableAsyncConversion(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtdis_get_dropped_frames(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	*((int *)arg) = w->getDroppedFrames();
+	return 0;
+}
+
+static int ms_winrtdis_is_dejittering(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	*((bool_t *)arg) = w->isDejittering() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtdis_enable_dejitter(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	w->enableDejitter(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtdis_get_latency_budget(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	*((int *)arg) = w->getLatencyBudget();
+	return 0;
+}
+
+static int ms_winrtdis_set_latency_budget(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	return w->setLatencyBudget(*((int *)arg));
+}
+
+static int ms_winrtdis_get_dejitter_stats(MSFilter *f, void *arg) {
+	MSWinRTDis *w = static_cast<MSWinRTDis *>(f->data);
+	w->getDejitterStats((MSWinRTDejitterStats *)arg);
+	return 0;
+}
+
 static MSFilterMethod ms_winrtdis_methods[] = {
-	{ MS_FILTER_GET_VIDEO_SIZE,              ms_winrtdis_get_vsize            },
-	{ MS_VIDEO_DISPLAY_SET_NATIVE_WINDOW_ID, ms_winrtdis_set_native_window_id },
-	{ 0,                                     NULL                             }
+	{ MS_FILTER_GET_VIDEO_SIZE,              ms_winrtdis_get_vsize               },
+	{ MS_VIDEO_DISPLAY_SET_NATIVE_WINDOW_ID, ms_winrtdis_set_native_window_id    },
+	{ MS_WINRTDIS_IS_ASYNC_CONVERSION,       ms_winrtdis_is_async_conversion     },
+	{ MS_WINRTDIS_ENABLE_ASYNC_CONVERSION,   ms_winrtdis_enable_async_conversion },
+	{ MS_WINRTDIS_GET_DROPPED_FRAMES,        ms_winrtdis_get_dropped_frames      },
+	{ MS_WINRTDIS_IS_DEJITTERING,            ms_winrtdis_is_dejittering          },
+	{ MS_WINRTDIS_ENABLE_DEJITTER,           ms_winrtdis_enable_dejitter         },
+	{ MS_WINRTDIS_GET_LATENCY_BUDGET,        ms_winrtdis_get_latency_budget      },
+	{ MS_WINRTDIS_SET_LATENCY_BUDGET,        ms_winrtdis_set_latency_budget      },
+	{ MS_WINRTDIS_GET_DEJITTER_STATS,        ms_winrtdis_get_dejitter_stats      },
+	{ 0,                                     NULL                                }
 };
 
 
@@ -346,9 +514,100 @@ static int ms_winrtbackgrounddis_set_native_window_id(MSFilter *f, void *arg) {
 	return 0;
 }
 
+static int ms_winrtbackgrounddis_is_async_conversion(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	*((bool_t *)arg) = w->isAsyncConversion() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_enable_async_conversion(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	w->enableAsyncConversion(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_get_dropped_frames(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	*((int *)arg) = w->getDroppedFrames();
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_is_using_frame_timestamps(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	*((bool_t *)arg) = w->isUsingFrameTimestamps() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_enable_frame_timestamps(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	w->enableFrameTimestamps(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_set_render_ahead_bounds(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	MSWinRTRenderAheadBounds *bounds = (MSWinRTRenderAheadBounds *)arg;
+	return w->setRenderAheadBounds(bounds->min_ms, bounds->max_ms);
+}
+
+static int ms_winrtbackgrounddis_get_render_ahead_bounds(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	MSWinRTRenderAheadBounds *bounds = (MSWinRTRenderAheadBounds *)arg;
+	w->getRenderAheadBounds(bounds->min_ms, bounds->max_ms);
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_get_render_ahead_stats(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	w->getRenderAheadStats((MSWinRTRenderAheadStats *)arg);
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_is_dejittering(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	*((bool_t *)arg) = w->isDejittering() ? TRUE : FALSE;
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_enable_dejitter(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	w->enableDejitter(*((bool_t *)arg) == TRUE);
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_get_latency_budget(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	*((int *)arg) = w->getLatencyBudget();
+	return 0;
+}
+
+static int ms_winrtbackgrounddis_set_latency_budget(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	return w->setLatencyBudget(*((int *)arg));
+}
+
+static int ms_winrtbackgrounddis_get_dejitter_stats(MSFilter *f, void *arg) {
+	MSWinRTBackgroundDis *w = static_cast<MSWinRTBackgroundDis *>(f->data);
+	w->getDejitterStats((MSWinRTDejitterStats *)arg);
+	return 0;
+}
+
 static MSFilterMethod ms_winrtbackgrounddis_methods[] = {
 	{ MS_FILTER_GET_VIDEO_SIZE,              ms_winrtbackgrounddis_get_vsize },
 	{ MS_VIDEO_DISPLAY_SET_NATIVE_WINDOW_ID, ms_winrtbackgrounddis_set_native_window_id },
+	{ MS_WINRTDIS_IS_ASYNC_CONVERSION,       ms_winrtbackgrounddis_is_async_conversion },
+	{ MS_WINRTDIS_ENABLE_ASYNC_CONVERSION,   ms_winrtbackgrounddis_enable_async_conversion },
+	{ MS_WINRTDIS_GET_DROPPED_FRAMES,        ms_winrtbackgrounddis_get_dropped_frames },
+	{ MS_WINRTDIS_IS_USING_FRAME_TIMESTAMPS, ms_winrtbackgrounddis_is_using_frame_timestamps },
+	{ MS_WINRTDIS_ENABLE_FRAME_TIMESTAMPS,   ms_winrtbackgrounddis_enable_frame_timestamps },
+	{ MS_WINRTDIS_SET_RENDER_AHEAD_BOUNDS,   ms_winrtbackgrounddis_set_render_ahead_bounds },
+	{ MS_WINRTDIS_GET_RENDER_AHEAD_BOUNDS,   ms_winrtbackgrounddis_get_render_ahead_bounds },
+	{ MS_WINRTDIS_GET_RENDER_AHEAD_STATS,    ms_winrtbackgrounddis_get_render_ahead_stats },
+	{ MS_WINRTDIS_IS_DEJITTERING,            ms_winrtbackgrounddis_is_dejittering },
+	{ MS_WINRTDIS_ENABLE_DEJITTER,           ms_winrtbackgrounddis_enable_dejitter },
+	{ MS_WINRTDIS_GET_LATENCY_BUDGET,        ms_winrtbackgrounddis_get_latency_budget },
+	{ MS_WINRTDIS_SET_LATENCY_BUDGET,        ms_winrtbackgrounddis_set_latency_budget },
+	{ MS_WINRTDIS_GET_DEJITTER_STATS,        ms_winrtbackgrounddis_get_dejitter_stats },
 	{ 0,                                     NULL }
 };
 
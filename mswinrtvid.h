@@ -33,11 +33,167 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include <agile.h>
 
+/**
+ * Simulcast layers of the capture filter. The half and quarter resolution layers are
+ * output on the outputs 1 and 2, their sizes being the video size divided by 2 and 4.
+ */
+#define MS_WINRTCAP_LAYER_HALF       (1 << 0)
+#define MS_WINRTCAP_LAYER_QUARTER    (1 << 1)
+
+/** Set the simulcast layers emitted by the capture filter, as a mask of MS_WINRTCAP_LAYER_* values. */
+#define MS_WINRTCAP_SET_SIMULCAST_LAYERS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 0, int)
+
+/** Get the simulcast layers emitted by the capture filter. */
+#define MS_WINRTCAP_GET_SIMULCAST_LAYERS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 1, int)
+
+/** Enable or disable the horizontal mirroring of the captured frames. The setting is remembered for the camera. */
+#define MS_WINRTCAP_ENABLE_MIRRORING    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 2, bool_t)
+
+/** Get whether the captured frames are mirrored. */
+#define MS_WINRTCAP_IS_MIRRORING    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 3, bool_t)
+
+/**
+ * Policies of the capture filter when its queue of frames waiting to be sent is full.
+ * With MS_WINRTCAP_OVERFLOW_BLOCK, the camera thread waits for the ticker to take a frame.
+ */
+#define MS_WINRTCAP_OVERFLOW_DROP_OLDEST    0
+#define MS_WINRTCAP_OVERFLOW_DROP_NEWEST    1
+#define MS_WINRTCAP_OVERFLOW_BLOCK          2
+
+/** Set the maximum number of frames queued per output of the capture filter, between 1 and 16. */
+#define MS_WINRTCAP_SET_QUEUE_DEPTH    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 4, int)
+
+/** Get the maximum number of frames queued per output of the capture filter. */
+#define MS_WINRTCAP_GET_QUEUE_DEPTH    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 5, int)
+
+/** Set the policy applied when the queue of the capture filter is full, as a MS_WINRTCAP_OVERFLOW_* value. */
+#define MS_WINRTCAP_SET_OVERFLOW_POLICY    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 6, int)
+
+/** Get the policy applied when the queue of the capture filter is full. */
+#define MS_WINRTCAP_GET_OVERFLOW_POLICY    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 7, int)
+
+/** Get the number of frames of the main output dropped because the queue of the capture filter was full. */
+#define MS_WINRTCAP_GET_DROPPED_FRAMES    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 8, int)
+
+/**
+ * Enable or disable the pacing of the capture filter output. When enabled, at most one frame per output is sent
+ * at each tick where a frame is due, the newest one, and the frames older than the maximum latency are dropped.
+ */
+#define MS_WINRTCAP_ENABLE_PACING    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 9, bool_t)
+
+/** Get whether the output of the capture filter is paced. */
+#define MS_WINRTCAP_IS_PACING    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 10, bool_t)
+
+/** Set the maximum age in ms, measured on the camera clock, of the frames sent in pacing mode. Defaults to 200 ms. */
+#define MS_WINRTCAP_SET_MAX_LATENCY    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 11, int)
+
+/** Get the maximum age in ms of the frames sent in pacing mode. */
+#define MS_WINRTCAP_GET_MAX_LATENCY    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 12, int)
+
+/**
+ * Enable or disable the asynchronous conversion of a display filter (MSWinRTDis or MSWinRTBackgroundDis).
+ * When enabled, the filter only queues the frames on the ticker thread, and a worker thread of the display
+ * converts them and hands them to the renderer. The queue keeps the 2 newest frames, older ones are dropped.
+ */
+#define MS_WINRTDIS_ENABLE_ASYNC_CONVERSION    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 13, bool_t)
+
+/** Get whether the frames of a display filter are converted asynchronously. */
+#define MS_WINRTDIS_IS_ASYNC_CONVERSION    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 14, bool_t)
+
+/** Get the number of frames a display filter dropped because its asynchronous conversion queue was full. */
+#define MS_WINRTDIS_GET_DROPPED_FRAMES    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 15, int)
+
+/**
+ * Enable or disable the presentation of the frames on the cadence of their 90 kHz timestamps, mapped to the
+ * local clock, instead of the time they are rendered at. Only supported by MSWinRTBackgroundDis.
+ */
+#define MS_WINRTDIS_ENABLE_FRAME_TIMESTAMPS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 16, bool_t)
+
+/** Get whether the frames are presented on the cadence of their timestamps. */
+#define MS_WINRTDIS_IS_USING_FRAME_TIMESTAMPS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 17, bool_t)
+
+#define MS_WINRTDIS_JITTER_HISTOGRAM_SIZE    128
+#define MS_WINRTDIS_JITTER_BUCKET_WIDTH_MS    2
+
+typedef struct MSWinRTRenderAheadBounds {
+	int min_ms;
+	int max_ms;
+} MSWinRTRenderAheadBounds;
+
+typedef struct MSWinRTRenderAheadStats {
+	/** Current render-ahead in ms. */
+	int render_ahead_ms;
+	/** Count of the recent frames per 2 ms jitter bucket, the last bucket counting all the frames above. */
+	unsigned int jitter_histogram[MS_WINRTDIS_JITTER_HISTOGRAM_SIZE];
+} MSWinRTRenderAheadStats;
+
+/**
+ * Set the bounds in ms of the render-ahead, the delay the frames are scheduled after the local clock at.
+ * It follows the 95th percentile of the jitter of the recent frames within these bounds, 10 to 200 ms by default.
+ * Only supported by MSWinRTBackgroundDis.
+ */
+#define MS_WINRTDIS_SET_RENDER_AHEAD_BOUNDS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 18, MSWinRTRenderAheadBounds)
+
+/** Get the bounds in ms of the render-ahead. */
+#define MS_WINRTDIS_GET_RENDER_AHEAD_BOUNDS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 19, MSWinRTRenderAheadBounds)
+
+/** Get the current render-ahead and the histogram of the jitter it is estimated from. */
+#define MS_WINRTDIS_GET_RENDER_AHEAD_STATS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 20, MSWinRTRenderAheadStats)
+
+typedef struct MSWinRTDejitterStats {
+	/** Frames rendered from the de-jitter buffer. */
+	int rendered_frames;
+	/** Frames dropped because they could not be rendered within the latency budget. */
+	int late_frames;
+	/** Frames dropped because the de-jitter buffer was full. */
+	int overflow_frames;
+	/** Restarts of the mapping of the timestamps to the local clock. */
+	int resyncs;
+} MSWinRTDejitterStats;
+
+/**
+ * Enable or disable the de-jitter buffer of a display filter (MSWinRTDis or MSWinRTBackgroundDis). When enabled,
+ * the frames are held in the order of their 90 kHz timestamps and rendered on their cadence, instead of only
+ * rendering the newest frame received at each tick. The frames must be timestamped.
+ */
+#define MS_WINRTDIS_ENABLE_DEJITTER    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 21, bool_t)
+
+/** Get whether the frames of a display filter go through the de-jitter buffer. */
+#define MS_WINRTDIS_IS_DEJITTERING    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 22, bool_t)
+
+/**
+ * Set the latency budget in ms of the de-jitter buffer. A frame is rendered half of it after the time it would
+ * have arrived without network delay, and dropped if it cannot be rendered within it. Defaults to 100 ms.
+ */
+#define MS_WINRTDIS_SET_LATENCY_BUDGET    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 23, int)
+
+/** Get the latency budget in ms of the de-jitter buffer. */
+#define MS_WINRTDIS_GET_LATENCY_BUDGET    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 24, int)
+
+/** Get the counters of the de-jitter buffer. */
+#define MS_WINRTDIS_GET_DEJITTER_STATS    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 25, MSWinRTDejitterStats)
+
+typedef struct MSWinRTFrameRate {
+	unsigned int numerator;
+	unsigned int denominator;
+} MSWinRTFrameRate;
+
+/**
+ * Set the frame rate of the capture filter as a fraction, eg. 30000/1001 for 29.97 fps or 15/2 for 7.5 fps.
+ * MS_FILTER_SET_FPS maps its value to the closest such fraction.
+ */
+#define MS_WINRTCAP_SET_FRAME_RATE    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 26, MSWinRTFrameRate)
+
+/** Get the frame rate of the capture filter as a fraction. */
+#define MS_WINRTCAP_GET_FRAME_RATE    MS_FILTER_METHOD(MS_FILTER_PLUGIN_ID, 27, MSWinRTFrameRate)
+
+
 typedef struct WinRTWebcam {
 	std::vector<wchar_t> *id_vector;
 	LPWSTR id;
 	bool_t external;
 	bool_t front;
+	bool_t mirror;
 } WinRTWebcam;
 
 template <class T> class RefToPtrProxy
@@ -0,0 +1,97 @@
+/*
+AsyncFrameStageBenchmark.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "AsyncFrameStage.h"
+#include "YuvConverter.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	/// A decoded I420 picture, recycled by the benchmark instead of being freed.
+	struct Picture
+	{
+		Picture(int width, int height) : Width(width), Height(height), Bytes(RandomBytes(width * height * 3 / 2)) {}
+
+		int Width;
+		int Height;
+		std::vector<uint8_t> Bytes;
+	};
+
+	void KeepPicture(Picture *)
+	{
+	}
+
+	/// The conversion done by the display for each frame, into the NV12 buffer of the MediaElement.
+	void ConvertPicture(const Picture *picture, std::vector<uint8_t> &nv12)
+	{
+		int w = picture->Width;
+		int h = picture->Height;
+		const uint8_t *y = picture->Bytes.data();
+		YuvConverter::I420ToNV12(y, w, y + w * h, w / 2, y + w * h * 5 / 4, w / 2, nv12.data(), w, nv12.data() + w * h, w, w, h);
+	}
+}
+
+
+TEST(AsyncFrameStageBenchmark, TickerTimePerFrame)
+{
+	printf("Time spent by the ticker thread per displayed frame, conversion on the ticker against the conversion stage\n");
+	ParallelThreshold parallel(ParallelThreshold::Never);
+	struct Size { const char *name; int width; int height; };
+	const Size sizes[] = { { "VGA", 640, 480 }, { "720p", 1280, 720 }, { "1080p", 1920, 1080 } };
+	for (const Size &size : sizes) {
+		const int frames = 200;
+		std::vector<Picture> pictures(4, Picture(size.width, size.height));
+		std::vector<uint8_t> nv12(size.width * size.height * 3 / 2);
+
+		double syncMs = MeasureMs(frames, [&]() { ConvertPicture(&pictures[0], nv12); });
+
+		std::atomic<int> converted(0);
+		AsyncFrameStage<Picture *> stage(2, KeepPicture);
+		stage.Start([&](Picture *picture) {
+			ConvertPicture(picture, nv12);
+			converted++;
+		});
+		// The ticker pushes a frame every 33 ms; only the time spent in Push is on the ticker thread.
+		double pushMs = 0;
+		for (int i = 0; i < frames / 4; i++) {
+			pushMs += MeasureMs(1, [&]() { stage.Push(&pictures[i % pictures.size()]); });
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			while (converted < (i + 1) - (int)stage.GetDroppedCount()) std::this_thread::yield();
+		}
+		stage.Stop();
+		pushMs /= frames / 4;
+		printf("  %-6s on the ticker %7.3f ms, pushed to the stage %7.4f ms, x%.0f\n", size.name, syncMs, pushMs, syncMs / pushMs);
+		EXPECT_LT(pushMs, syncMs);
+	}
+}
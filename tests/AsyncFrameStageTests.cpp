@@ -0,0 +1,238 @@
+/*
+AsyncFrameStageTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AsyncFrameStage.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	std::atomic<int> sLiveFrames(0);
+	std::atomic<int> sDisposedFrames(0);
+
+	struct Frame
+	{
+		Frame(int number) : Number(number) { sLiveFrames++; }
+		~Frame() { sLiveFrames--; }
+
+		int Number;
+	};
+
+	void DisposeFrame(Frame *frame)
+	{
+		sDisposedFrames++;
+		delete frame;
+	}
+
+	typedef AsyncFrameStage<Frame *> FrameStage;
+
+	/// Holds the worker in the process function until it is opened, so that the frames pile up in the queue.
+	class Gate
+	{
+	public:
+		Gate() : mOpen(false), mWaiting(0) {}
+
+		void Pass()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWaiting++;
+			mChanged.notify_all();
+			mChanged.wait(lock, [this]() { return mOpen; });
+		}
+
+		void WaitForWorker()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mChanged.wait(lock, [this]() { return mWaiting > 0; });
+		}
+
+		void Open()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mOpen = true;
+			mChanged.notify_all();
+		}
+
+	private:
+		std::mutex mMutex;
+		std::condition_variable mChanged;
+		bool mOpen;
+		int mWaiting;
+	};
+}
+
+
+TEST(AsyncFrameStageTest, FramesAreProcessedInOrder)
+{
+	sLiveFrames = 0;
+	std::vector<int> processed;
+	{
+		FrameStage stage(64, DisposeFrame);
+		std::mutex mutex;
+		std::condition_variable done;
+		stage.Start([&](Frame *frame) {
+			std::lock_guard<std::mutex> lock(mutex);
+			processed.push_back(frame->Number);
+			delete frame;
+			done.notify_one();
+		});
+		for (int i = 0; i < 50; i++) EXPECT_TRUE(stage.Push(new Frame(i)));
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() { return processed.size() == 50; });
+	}
+	for (int i = 0; i < 50; i++) EXPECT_EQ(i, processed[i]);
+	EXPECT_EQ(0, sLiveFrames.load());
+}
+
+TEST(AsyncFrameStageTest, FullQueueDropsTheOldestFrame)
+{
+	sLiveFrames = 0;
+	sDisposedFrames = 0;
+	Gate gate;
+	std::vector<int> processed;
+	FrameStage stage(2, DisposeFrame);
+	stage.Start([&](Frame *frame) {
+		gate.Pass();
+		processed.push_back(frame->Number);
+		delete frame;
+	});
+	stage.Push(new Frame(0));
+	gate.WaitForWorker();
+	// The worker holds frame 0, frames 1 to 4 go to a queue of 2.
+	for (int i = 1; i <= 4; i++) EXPECT_TRUE(stage.Push(new Frame(i)));
+	EXPECT_EQ(2u, stage.GetDroppedCount());
+	EXPECT_EQ(2, sDisposedFrames.load());
+	gate.Open();
+	while (stage.GetProcessedCount() < 3) std::this_thread::yield();
+	stage.Stop();
+	EXPECT_EQ((std::vector<int>{ 0, 3, 4 }), processed);
+	EXPECT_EQ(0, sLiveFrames.load());
+}
+
+TEST(AsyncFrameStageTest, StopReleasesTheQueuedFrames)
+{
+	sLiveFrames = 0;
+	Gate gate;
+	FrameStage stage(8, DisposeFrame);
+	stage.Start([&](Frame *frame) {
+		gate.Pass();
+		delete frame;
+	});
+	stage.Push(new Frame(0));
+	gate.WaitForWorker();
+	for (int i = 1; i <= 5; i++) stage.Push(new Frame(i));
+	std::thread opener([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		gate.Open();
+	});
+	// Stop waits for the frame being processed, then disposes of the queued ones.
+	stage.Stop();
+	opener.join();
+	EXPECT_FALSE(stage.IsRunning());
+	EXPECT_EQ(0, sLiveFrames.load());
+
+	// A stopped stage leaves the frame to the caller.
+	Frame frame(6);
+	EXPECT_FALSE(stage.Push(&frame));
+}
+
+TEST(AsyncFrameStageTest, ConcurrentStopsReturnOnceTheWorkerIsDone)
+{
+	sLiveFrames = 0;
+	FrameStage stage(4, DisposeFrame);
+	std::atomic<int> processing(0);
+	std::atomic<int> earlyReturns(0);
+	for (int cycle = 0; cycle < 200; cycle++) {
+		stage.Start([&](Frame *frame) {
+			processing++;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			delete frame;
+			processing--;
+		});
+		for (int i = 0; i < 8; i++) stage.Push(new Frame(i));
+		// The display is stopped by the filter and by the restart of the MediaElement at the same time, each
+		// tearing down the renderer once Stop has returned.
+		std::atomic<bool> go(false);
+		std::vector<std::thread> stoppers;
+		for (int t = 0; t < 3; t++) {
+			stoppers.emplace_back([&]() {
+				while (!go) std::this_thread::yield();
+				stage.Stop();
+				if ((processing != 0) || stage.IsRunning()) earlyReturns++;
+			});
+		}
+		go = true;
+		for (std::thread &stopper : stoppers) stopper.join();
+		ASSERT_EQ(0, earlyReturns.load()) << "cycle " << cycle;
+		ASSERT_EQ(0, sLiveFrames.load()) << "cycle " << cycle;
+	}
+}
+
+TEST(AsyncFrameStageTest, StartWaitsForAStopInProgress)
+{
+	sLiveFrames = 0;
+	Gate gate;
+	FrameStage stage(4, DisposeFrame);
+	stage.Start([&](Frame *frame) {
+		gate.Pass();
+		delete frame;
+	});
+	stage.Push(new Frame(0));
+	gate.WaitForWorker();
+	std::thread stopper([&]() { stage.Stop(); });
+	// The stage refuses the frames once the stop has begun, while the worker is still held.
+	for (;;) {
+		Frame *probe = new Frame(1);
+		if (!stage.Push(probe)) {
+			delete probe;
+			break;
+		}
+		std::this_thread::yield();
+	}
+	std::thread opener([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		gate.Open();
+	});
+	std::atomic<int> restarted(0);
+	stage.Start([&](Frame *frame) {
+		restarted++;
+		delete frame;
+	});
+	stopper.join();
+	opener.join();
+	ASSERT_TRUE(stage.IsRunning());
+	ASSERT_TRUE(stage.Push(new Frame(2)));
+	while (restarted == 0) std::this_thread::yield();
+	stage.Stop();
+	EXPECT_EQ(0, sLiveFrames.load());
+}
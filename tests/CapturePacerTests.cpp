@@ -0,0 +1,249 @@
+/*
+CapturePacerTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "CapturePacer.h"
+#include "FrameAdmission.h"
+#include "FrameRate.h"
+#include "SpscRing.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	struct Frame
+	{
+		uint32_t Timestamp;
+	};
+
+	void DisposeFrame(Frame *frame)
+	{
+		delete frame;
+	}
+
+	/// A camera frame: the local time in ms it is delivered at, and its camera time in ms.
+	struct Arrival
+	{
+		uint64_t Time;
+		double CameraTime;
+	};
+
+	/// 30 fps camera delivering its frames 15 ms after their timestamp plus a jitter.
+	std::vector<Arrival> JitteredCamera(double jitterMs)
+	{
+		std::vector<Arrival> arrivals;
+		std::mt19937 generator(1);
+		std::normal_distribution<double> jitter(0, jitterMs);
+		for (int i = 0; i < 1500; i++) {
+			double t = 100 + i * 33.333;
+			arrivals.push_back({ (uint64_t)(t + 15 + fabs(jitter(generator))), t });
+		}
+		return arrivals;
+	}
+
+	/// 30 fps camera delivering every other second its frames by bursts of 3.
+	std::vector<Arrival> BurstyCamera()
+	{
+		std::vector<Arrival> arrivals;
+		for (int i = 0; i < 1500; i++) {
+			double t = 100 + i * 33.333;
+			uint64_t time = (uint64_t)t + 15;
+			if ((i / 30) % 2) time = (uint64_t)(100 + ((i / 3) * 3 + 2) * 33.333) + 15;
+			arrivals.push_back({ time, t });
+		}
+		return arrivals;
+	}
+
+	/// 30 fps camera stalling 300 ms every 5 s, then delivering the frames of the stall at once.
+	std::vector<Arrival> StallingCamera()
+	{
+		std::vector<Arrival> arrivals;
+		for (int i = 0; i < 1500; i++) {
+			double t = 100 + i * 33.333;
+			uint64_t time = (uint64_t)t + 15;
+			if ((i % 150) >= 140) time = (uint64_t)(100 + 150 * 33.333 * (i / 150) + 149 * 33.333) + 15 + 400;
+			arrivals.push_back({ time, t });
+		}
+		return arrivals;
+	}
+
+	/// Frames sent to the encoder: the intervals between them and their age when sent.
+	struct Output
+	{
+		Output() : Bursts(0), Stale(0) {}
+
+		void Send(uint64_t now, int64_t age)
+		{
+			if (!Times.empty() && (now == Times.back())) Bursts++;
+			Times.push_back(now);
+			Ages.push_back(age);
+		}
+
+		double GetFps() const { return (Times.size() - 1) * 1000.0 / (double)(Times.back() - Times.front()); }
+
+		double GetIntervalDeviation() const
+		{
+			double sum = 0;
+			double sum2 = 0;
+			size_t n = Times.size() - 1;
+			for (size_t i = 1; i < Times.size(); i++) {
+				double d = (double)(Times[i] - Times[i - 1]);
+				sum += d;
+				sum2 += d * d;
+			}
+			double mean = sum / n;
+			return sqrt(sum2 / n - mean * mean);
+		}
+
+		int64_t GetMaxAge() const
+		{
+			int64_t max = 0;
+			for (int64_t age : Ages) max = (age > max) ? age : max;
+			return max;
+		}
+
+		std::vector<uint64_t> Times;
+		std::vector<int64_t> Ages;
+		int Bursts;
+		uint64_t Stale;
+	};
+
+	const int TickMs = 10;
+	const size_t QueueDepth = 4;
+
+	/// The feed of MSWinRTCap with pacing: frames admitted on arrival, queued in a ring, newest one sent at each tick.
+	Output RunPaced(const std::vector<Arrival> &arrivals, FrameRate rate, int maxLatency)
+	{
+		FrameAdmission admission;
+		admission.SetFrameRate(rate);
+		SpscRing<Frame *> ring(16, DisposeFrame);
+		ring.SetDepth(QueueDepth);
+		CapturePacer<Frame *> pacer(DisposeFrame);
+		pacer.SetMaxLatency(maxLatency);
+		Output output;
+		size_t next = 0;
+		for (uint64_t now = 0; now < arrivals.back().Time + 100; now++) {
+			for (; (next < arrivals.size()) && (arrivals[next].Time <= now); next++) {
+				uint32_t timestamp = (uint32_t)(arrivals[next].CameraTime * 90);
+				pacer.OnFrameArrival(timestamp, now);
+				if (!admission.Admit((int64_t)(arrivals[next].CameraTime * 10000))) continue;
+				ring.Push(new Frame{ timestamp });
+			}
+			if ((now % TickMs) != 0) continue;
+			Frame *frame = pacer.Select([&ring](Frame *&f) { return ring.Pop(f); }, [](Frame *f) { return f->Timestamp; }, now);
+			if (frame == nullptr) continue;
+			output.Send(now, pacer.GetAge(frame->Timestamp, now));
+			delete frame;
+		}
+		output.Stale = pacer.GetStaleCount();
+		return output;
+	}
+
+	/// The feed of MSWinRTCap without pacing: every frame queued, all of them sent when the frame rate controller says so.
+	Output RunFlushed(const std::vector<Arrival> &arrivals, FrameRate rate)
+	{
+		FrameRateController controller;
+		controller.Init(rate);
+		CapturePacer<Frame *> clock(DisposeFrame);
+		std::deque<Frame *> queue;
+		Output output;
+		size_t next = 0;
+		for (uint64_t now = 0; now < arrivals.back().Time + 100; now++) {
+			for (; (next < arrivals.size()) && (arrivals[next].Time <= now); next++) {
+				uint32_t timestamp = (uint32_t)(arrivals[next].CameraTime * 90);
+				clock.OnFrameArrival(timestamp, now);
+				queue.push_back(new Frame{ timestamp });
+				if (queue.size() > QueueDepth) {
+					delete queue.front();
+					queue.pop_front();
+				}
+			}
+			if (((now % TickMs) != 0) || queue.empty() || !controller.IsFrameDue(now)) continue;
+			for (; !queue.empty(); queue.pop_front()) {
+				output.Send(now, clock.GetAge(queue.front()->Timestamp, now));
+				delete queue.front();
+			}
+		}
+		return output;
+	}
+
+	void Report(const char *name, double targetFps, const Output &flushed, const Output &paced)
+	{
+		printf("%-18s %4.1f fps: flushed %5.2f fps, interval sd %5.1f ms, %3d bursts, max age %3lld ms; "
+			"paced %5.2f fps, interval sd %5.1f ms, %d bursts, max age %3lld ms, %llu stale\n",
+			name, targetFps, flushed.GetFps(), flushed.GetIntervalDeviation(), flushed.Bursts, (long long)flushed.GetMaxAge(),
+			paced.GetFps(), paced.GetIntervalDeviation(), paced.Bursts, (long long)paced.GetMaxAge(), (unsigned long long)paced.Stale);
+	}
+}
+
+
+TEST(CapturePacerTest, JitteredCameraIsSentAtAnEvenPace)
+{
+	for (float fps : { 15.f, 30.f }) {
+		std::vector<Arrival> arrivals = JitteredCamera(6);
+		Output flushed = RunFlushed(arrivals, FrameRate::FromFloat(fps));
+		Output paced = RunPaced(arrivals, FrameRate::FromFloat(fps), 200);
+		Report("jitter 6 ms", fps, flushed, paced);
+		EXPECT_EQ(0, paced.Bursts);
+		// What is left of the camera jitter is the rounding to the ticks.
+		EXPECT_LT(paced.GetIntervalDeviation(), (double)TickMs);
+		EXPECT_NEAR(fps, paced.GetFps(), fps * 0.03);
+	}
+}
+
+TEST(CapturePacerTest, BurstsAreNotForwarded)
+{
+	for (float fps : { 15.f, 30.f }) {
+		std::vector<Arrival> arrivals = BurstyCamera();
+		Output flushed = RunFlushed(arrivals, FrameRate::FromFloat(fps));
+		Output paced = RunPaced(arrivals, FrameRate::FromFloat(fps), 200);
+		Report("bursts of 3", fps, flushed, paced);
+		// The encoder never gets two frames at the same tick: the newest frame of a burst is sent, the others are superseded.
+		EXPECT_EQ(0, paced.Bursts);
+		EXPECT_LT(paced.GetMaxAge(), flushed.GetMaxAge());
+		EXPECT_LT(paced.GetIntervalDeviation(), flushed.GetIntervalDeviation());
+	}
+}
+
+TEST(CapturePacerTest, FramesOfAStallAreDroppedAsStale)
+{
+	for (float fps : { 15.f, 30.f }) {
+		std::vector<Arrival> arrivals = StallingCamera();
+		Output flushed = RunFlushed(arrivals, FrameRate::FromFloat(fps));
+		Output paced = RunPaced(arrivals, FrameRate::FromFloat(fps), 200);
+		Report("300 ms stalls", fps, flushed, paced);
+		EXPECT_EQ(0, paced.Bursts);
+		EXPECT_GT(paced.Stale, 0u);
+		// No frame older than the maximum latency reaches the encoder.
+		EXPECT_LE(paced.GetMaxAge(), 200);
+		EXPECT_GT(flushed.GetMaxAge(), 200);
+	}
+}
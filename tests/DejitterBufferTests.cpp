@@ -0,0 +1,255 @@
+/*
+DejitterBufferTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "DejitterBuffer.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	int sLiveFrames = 0;
+
+	/// A frame of a 30 fps stream: its 90 kHz timestamp, the time it was sent and the time it arrived, in ms.
+	struct Frame
+	{
+		uint32_t timestamp;
+		double sent;
+		double arrival;
+	};
+
+	void DisposeFrame(Frame *)
+	{
+		sLiveFrames--;
+	}
+
+	typedef DejitterBuffer<Frame *> FrameBuffer;
+
+	const uint32_t FrameTicks = 3000;
+	const double FrameMs = 1000.0 / 30;
+	const double Transit = 30;
+
+	std::vector<Frame> Stream(int count, uint32_t firstTimestamp, const std::function<double(int, double)> &delay)
+	{
+		std::vector<Frame> frames;
+		for (int i = 0; i < count; i++) {
+			double sent = 20 + i * FrameMs;
+			frames.push_back({ firstTimestamp + i * FrameTicks, sent, sent + delay(i, sent) });
+		}
+		return frames;
+	}
+
+	struct Playback
+	{
+		// Indexes of the frames released, in release order, and the ticks they were released at.
+		std::vector<size_t> released;
+		std::vector<double> times;
+		uint64_t late;
+		uint64_t overflow;
+		uint64_t resyncs;
+
+		/// Root mean square of the difference between the release intervals and the send intervals.
+		double CadenceError(const std::vector<Frame> &frames) const
+		{
+			double sum = 0;
+			for (size_t i = 1; i < released.size(); i++) {
+				double error = (times[i] - times[i - 1]) - (frames[released[i]].sent - frames[released[i - 1]].sent);
+				sum += error * error;
+			}
+			return (released.size() > 1) ? std::sqrt(sum / (released.size() - 1)) : 0;
+		}
+	};
+
+	/// Feeds the frames at their arrival time and pops one frame per tick, as the display ticker does.
+	Playback Play(std::vector<Frame> &frames, size_t capacity, int tickMs, int budgetMs = 100)
+	{
+		FrameBuffer buffer(capacity, DisposeFrame);
+		buffer.SetLatencyBudget(budgetMs);
+		std::vector<size_t> order(frames.size());
+		for (size_t i = 0; i < order.size(); i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return frames[a].arrival < frames[b].arrival; });
+		Playback playback;
+		size_t next = 0;
+		double end = frames[order.back()].arrival + 1000;
+		for (uint64_t now = 0; now < end; now += tickMs) {
+			while ((next < order.size()) && (frames[order[next]].arrival <= now)) {
+				Frame *frame = &frames[order[next++]];
+				sLiveFrames++;
+				buffer.Push(frame, frame->timestamp, now);
+			}
+			Frame *frame = buffer.Pop(now);
+			if (frame) {
+				sLiveFrames--;
+				playback.released.push_back(frame - frames.data());
+				playback.times.push_back((double)now);
+			}
+		}
+		playback.late = buffer.GetLateCount();
+		playback.overflow = buffer.GetOverflowCount();
+		playback.resyncs = buffer.GetResyncCount();
+		EXPECT_EQ(playback.released.size(), buffer.GetReleasedCount());
+		buffer.Clear();
+		EXPECT_EQ(0, sLiveFrames);
+		return playback;
+	}
+
+	/// Released on arrival, the newest frame at each tick, as without the buffer.
+	Playback PlayLastFrame(const std::vector<Frame> &frames, int tickMs)
+	{
+		Playback playback;
+		size_t next = 0;
+		for (uint64_t now = 0; next < frames.size(); now += tickMs) {
+			size_t last = frames.size();
+			while ((next < frames.size()) && (frames[next].arrival <= now)) last = next++;
+			if (last < frames.size()) {
+				playback.released.push_back(last);
+				playback.times.push_back((double)now);
+			}
+		}
+		return playback;
+	}
+}
+
+
+TEST(DejitterBufferTest, SteadyStreamIsReleasedOnItsCadence)
+{
+	std::vector<Frame> frames = Stream(300, 1000, [](int, double) { return Transit; });
+	Playback playback = Play(frames, 16, 1);
+	ASSERT_EQ(300u, playback.released.size());
+	EXPECT_EQ(0u, playback.late);
+	EXPECT_LT(playback.CadenceError(frames), 1.0);
+	// Half the latency budget behind the frames arriving without delay.
+	EXPECT_NEAR(frames[0].arrival + 50, playback.times[0], 1.0);
+}
+
+TEST(DejitterBufferTest, JitteredStreamIsReleasedOnTheSendCadence)
+{
+	std::mt19937 rng(7);
+	std::exponential_distribution<double> jitter(1.0 / 15);
+	std::vector<Frame> frames = Stream(900, 1000, [&](int, double) { return Transit + jitter(rng); });
+	Playback playback = Play(frames, 16, 10);
+	EXPECT_LT(playback.CadenceError(frames), PlayLastFrame(frames, 10).CadenceError(frames) / 2);
+	EXPECT_LT(playback.late, frames.size() / 20);
+}
+
+TEST(DejitterBufferTest, BurstsAreSpreadWithinTheLatencyBudget)
+{
+	// Wi-Fi power save: the packets are held until the next 100 ms beacon.
+	std::vector<Frame> frames = Stream(900, 1000, [](int, double sent) { return Transit + (100 - std::fmod(sent, 100.0)); });
+	Playback playback = Play(frames, 16, 10, 250);
+	// Without the buffer, only the newest frame of each beacon is rendered.
+	EXPECT_LT(PlayLastFrame(frames, 10).released.size(), frames.size() / 2);
+	EXPECT_EQ(0u, playback.late);
+	EXPECT_EQ(frames.size(), playback.released.size());
+	EXPECT_LT(playback.CadenceError(frames), 6.0);
+}
+
+TEST(DejitterBufferTest, ReorderedFramesAreReleasedInTimestampOrder)
+{
+	// Every 20th frame is overtaken by the next one.
+	std::vector<Frame> frames = Stream(100, 1000, [](int i, double) { return (i % 20 == 5) ? 80.0 : Transit; });
+	Playback playback = Play(frames, 16, 1);
+	ASSERT_EQ(100u, playback.released.size());
+	for (size_t i = 0; i < playback.released.size(); i++) EXPECT_EQ(i, playback.released[i]);
+	EXPECT_EQ(0u, playback.late);
+}
+
+TEST(DejitterBufferTest, FullBufferDropsTheOldestFrame)
+{
+	// 6 frames arrive together at 200 ms in a buffer of 4.
+	std::vector<Frame> frames = Stream(6, 1000, [](int, double sent) { return 200 - sent; });
+	Playback playback = Play(frames, 4, 1, 300);
+	EXPECT_EQ(2u, playback.overflow);
+	EXPECT_EQ(0u, playback.late);
+	EXPECT_EQ((std::vector<size_t>{ 2, 3, 4, 5 }), playback.released);
+}
+
+TEST(DejitterBufferTest, FrameBeyondTheLatencyBudgetIsDropped)
+{
+	std::vector<Frame> frames = Stream(100, 1000, [](int i, double) { return (i == 50) ? 400.0 : Transit; });
+	Playback playback = Play(frames, 16, 1);
+	EXPECT_EQ(1u, playback.late);
+	EXPECT_EQ(99u, playback.released.size());
+	EXPECT_EQ(0u, playback.resyncs);
+	EXPECT_EQ(playback.released.end(), std::find(playback.released.begin(), playback.released.end(), 50u));
+}
+
+TEST(DejitterBufferTest, FrameOlderThanTheReleasedOneIsDropped)
+{
+	FrameBuffer buffer(16, DisposeFrame);
+	Frame frames[3] = {};
+	sLiveFrames = 3;
+	buffer.Push(&frames[0], 1000, 100);
+	buffer.Push(&frames[1], 1000 + 2 * FrameTicks, 167);
+	EXPECT_EQ(&frames[0], buffer.Pop(150));
+	EXPECT_EQ(&frames[1], buffer.Pop(217));
+	sLiveFrames -= 2;
+	// The frame between them arrives once its successor has been rendered.
+	buffer.Push(&frames[2], 1000 + FrameTicks, 218);
+	EXPECT_EQ(nullptr, buffer.Pop(300));
+	EXPECT_EQ(1u, buffer.GetLateCount());
+	EXPECT_EQ(0, sLiveFrames);
+}
+
+TEST(DejitterBufferTest, DelayStepResyncsAfterConsecutiveLateFrames)
+{
+	std::vector<Frame> frames = Stream(900, 1000, [](int, double sent) { return (sent < 10000) ? Transit : Transit + 200; });
+	Playback playback = Play(frames, 16, 1);
+	EXPECT_EQ(1u, playback.resyncs);
+	// The frames delayed while the buffer waits for a third late frame in a row.
+	EXPECT_EQ(2u, playback.late);
+	EXPECT_EQ(898u, playback.released.size());
+	EXPECT_LT(playback.CadenceError(frames), 7.0);
+}
+
+TEST(DejitterBufferTest, SenderRestartStartsANewTimeline)
+{
+	// The timestamps go back to a random origin at 10 s, as after a restart of the sender.
+	std::vector<Frame> frames = Stream(600, 1000, [](int, double) { return Transit; });
+	for (size_t i = 300; i < frames.size(); i++) frames[i].timestamp = 77777 + (uint32_t)(i - 300) * FrameTicks;
+	Playback playback = Play(frames, 16, 1);
+	EXPECT_EQ(1u, playback.resyncs);
+	EXPECT_EQ(600u, playback.released.size());
+	EXPECT_EQ(0u, playback.late);
+}
+
+TEST(DejitterBufferTest, TimestampWrapKeepsTheOrderAndTheCadence)
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> jitter(0, 10);
+	std::vector<Frame> frames = Stream(300, 0xFFFFFFFFu - 100 * FrameTicks, [&](int, double) { return Transit + jitter(rng); });
+	Playback playback = Play(frames, 16, 1);
+	ASSERT_EQ(300u, playback.released.size());
+	for (size_t i = 0; i < playback.released.size(); i++) EXPECT_EQ(i, playback.released[i]);
+	EXPECT_EQ(0u, playback.late);
+	EXPECT_EQ(0u, playback.resyncs);
+	EXPECT_LT(playback.CadenceError(frames), 1.0);
+}
@@ -0,0 +1,128 @@
+/*
+FakeWorkQueue.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "RingQueue.h"
+
+
+namespace libmswinrtvid
+{
+	namespace test
+	{
+		/// <summary>
+		/// Serial work queue standing in for a Media Foundation one: the work items are run one at a time, in order, by a
+		/// single thread. As with MFPutWorkItem2, a work item is a callback and a state pointer. The items are held in a
+		/// preallocated ring buffer so that putting one does not allocate.
+		/// </summary>
+		class FakeWorkQueue
+		{
+		public:
+			typedef void (*WorkFunc)(void *context, void *state);
+
+			FakeWorkQueue(size_t capacity) : mItems(capacity), mStop(false), mRunning(false), mPutCount(0), mWakeCount(0)
+			{
+				mThread = std::thread([this]() { Run(); });
+			}
+
+			~FakeWorkQueue()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					mStop = true;
+				}
+				mCondition.notify_one();
+				mThread.join();
+			}
+
+			bool Put(WorkFunc func, void *context, void *state)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if (!mItems.PushBack(WorkItem(func, context, state))) return false;
+				}
+				mPutCount++;
+				mCondition.notify_one();
+				return true;
+			}
+
+			/// Wait until every work item put so far has been run.
+			void Flush()
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mIdle.wait(lock, [this]() { return mItems.IsEmpty() && !mRunning; });
+			}
+
+			/// Number of work items put, and number of times the queue thread has been woken up to run some.
+			uint64_t GetPutCount() const { return mPutCount; }
+			uint64_t GetWakeCount() const { return mWakeCount; }
+
+		private:
+			struct WorkItem
+			{
+				WorkItem() : Func(nullptr), Context(nullptr), State(nullptr) {}
+				WorkItem(WorkFunc func, void *context, void *state) : Func(func), Context(context), State(state) {}
+
+				WorkFunc Func;
+				void *Context;
+				void *State;
+			};
+
+			void Run()
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				while (true) {
+					mCondition.wait(lock, [this]() { return mStop || !mItems.IsEmpty(); });
+					if (mItems.IsEmpty()) return;
+					mWakeCount++;
+					WorkItem item;
+					while (mItems.PopFront(item)) {
+						mRunning = true;
+						lock.unlock();
+						item.Func(item.Context, item.State);
+						lock.lock();
+						mRunning = false;
+					}
+					mIdle.notify_all();
+				}
+			}
+
+			std::mutex mMutex;
+			std::condition_variable mCondition;
+			std::condition_variable mIdle;
+			RingQueue<WorkItem> mItems;
+			bool mStop;
+			bool mRunning;
+			std::atomic<uint64_t> mPutCount;
+			std::atomic<uint64_t> mWakeCount;
+			std::thread mThread;
+		};
+	}
+}
@@ -0,0 +1,248 @@
+/*
+FrameAdmissionTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "FrameAdmission.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	const int64_t TimestampsPerMs = 10000;
+
+	/// Synthetic camera timestamps, in 100 ns units: a regular cadence, optionally jittered, or delivered in bursts
+	/// of frames stamped 1 ms apart, with an optional gap of one second in the middle.
+	struct CameraStream
+	{
+		CameraStream(double fps, double seconds) : Fps(fps), Seconds(seconds), JitterMs(0), Burst(1), Gap(false) {}
+
+		std::vector<int64_t> Timestamps() const
+		{
+			std::vector<int64_t> timestamps;
+			std::mt19937 generator(1);
+			std::uniform_real_distribution<double> jitter(-JitterMs, JitterMs);
+			double periodMs = 1000.0 / Fps;
+			int count = (int)(Seconds * Fps);
+			for (int i = 0; i < count; i++) {
+				if (Gap && (i > (count / 2)) && (i < ((count / 2) + (int)Fps))) continue;
+				double ms = i * periodMs;
+				if (Burst > 1) ms = (i / Burst) * Burst * periodMs + (i % Burst);
+				else if (JitterMs > 0) ms += jitter(generator);
+				timestamps.push_back((int64_t)(ms * TimestampsPerMs));
+			}
+			return timestamps;
+		}
+
+		double Fps;
+		double Seconds;
+		double JitterMs;
+		int Burst;
+		bool Gap;
+	};
+
+	/// The timestamps of the frames admitted, with their average rate and the extreme intervals between them.
+	struct AdmittedFrames
+	{
+		AdmittedFrames(FrameAdmission &admission, const std::vector<int64_t> &timestamps)
+		{
+			for (int64_t timestamp : timestamps) {
+				if (admission.Admit(timestamp)) Timestamps.push_back(timestamp);
+			}
+		}
+
+		double GetFps() const
+		{
+			if (Timestamps.size() < 2) return 0;
+			return (Timestamps.size() - 1) * 1000.0 * TimestampsPerMs / (double)(Timestamps.back() - Timestamps.front());
+		}
+
+		double GetMinIntervalMs() const
+		{
+			double interval = 1e9;
+			for (size_t i = 1; i < Timestamps.size(); i++) interval = std::min(interval, (Timestamps[i] - Timestamps[i - 1]) / (double)TimestampsPerMs);
+			return interval;
+		}
+
+		double GetMaxIntervalMs() const
+		{
+			double interval = 0;
+			for (size_t i = 1; i < Timestamps.size(); i++) interval = std::max(interval, (Timestamps[i] - Timestamps[i - 1]) / (double)TimestampsPerMs);
+			return interval;
+		}
+
+		std::vector<int64_t> Timestamps;
+	};
+}
+
+
+TEST(FrameAdmissionTest, RegularCameraIsDecimatedEvenly)
+{
+	FrameAdmission admission;
+	admission.SetFrameRate(FrameRate::FromFraction(15, 1));
+	CameraStream camera(30, 60);
+	AdmittedFrames admitted(admission, camera.Timestamps());
+	EXPECT_EQ(900u, admitted.Timestamps.size());
+	EXPECT_EQ(900u, admission.GetSkippedCount());
+	// Every other frame, the 333333 intervals of the camera rounding to 66.67 ms.
+	EXPECT_NEAR(66.67, admitted.GetMinIntervalMs(), 0.01);
+	EXPECT_NEAR(66.67, admitted.GetMaxIntervalMs(), 0.01);
+}
+
+TEST(FrameAdmissionTest, JitteredCameraKeepsTheAverageRate)
+{
+	struct Case { double cameraFps; double targetFps; double jitterMs; };
+	const Case cases[] = { { 30, 15, 5 }, { 30, 30, 5 }, { 24, 15, 5 }, { 60, 15, 3 }, { 30, 10, 8 } };
+	for (const Case &c : cases) {
+		FrameAdmission admission;
+		admission.SetFrameRate(FrameRate::FromFloat((float)c.targetFps));
+		CameraStream camera(c.cameraFps, 60);
+		camera.JitterMs = c.jitterMs;
+		AdmittedFrames admitted(admission, camera.Timestamps());
+		printf("camera %4.1f fps +-%.0f ms, target %4.1f fps: %5.2f fps, intervals %5.1f..%5.1f ms\n", c.cameraFps, c.jitterMs, c.targetFps,
+			admitted.GetFps(), admitted.GetMinIntervalMs(), admitted.GetMaxIntervalMs());
+		EXPECT_NEAR(c.targetFps, admitted.GetFps(), c.targetFps * 0.01) << c.cameraFps << " fps to " << c.targetFps << " fps";
+		// A frame is never admitted more than 3/8 of an interval early, jitter of the timestamps included.
+		EXPECT_GE(admitted.GetMinIntervalMs(), (1000.0 / c.targetFps) * 5 / 8 - 2 * c.jitterMs);
+	}
+}
+
+TEST(FrameAdmissionTest, FractionalRatesDoNotDrift)
+{
+	struct Case { FrameRate camera; FrameRate target; };
+	const Case cases[] = {
+		{ { 30, 1 }, { 30000, 1001 } }, { { 30, 1 }, { 24000, 1001 } }, { { 30, 1 }, { 15000, 1001 } },
+		{ { 30, 1 }, { 15, 2 } }, { { 25, 1 }, { 25, 2 } }, { { 30000, 1001 }, { 24000, 1001 } }
+	};
+	const int64_t seconds = 3600;
+	for (const Case &c : cases) {
+		FrameAdmission admission;
+		admission.SetFrameRate(c.target);
+		// Exact camera timestamps, frame i at i / rate.
+		std::vector<int64_t> timestamps;
+		int64_t count = seconds * c.camera.Numerator / c.camera.Denominator;
+		for (int64_t i = 0; i < count; i++) timestamps.push_back(i * 1000 * TimestampsPerMs * c.camera.Denominator / c.camera.Numerator);
+		AdmittedFrames admitted(admission, timestamps);
+		double targetFps = (double)c.target.Numerator / c.target.Denominator;
+		double cameraIntervalMs = 1000.0 * c.camera.Denominator / c.camera.Numerator;
+		EXPECT_NEAR(seconds * targetFps, (double)admitted.Timestamps.size(), 1.5) << c.target.Numerator << "/" << c.target.Denominator;
+		// Frame n is the first camera frame from 3/8 of an interval before n / rate, the timestamps being truncated to 100 ns.
+		double worstMs = 0;
+		for (size_t n = 0; n < admitted.Timestamps.size(); n++) {
+			double idealMs = n * 1000.0 / targetFps;
+			worstMs = std::max(worstMs, std::fabs(admitted.Timestamps[n] / (double)TimestampsPerMs - idealMs));
+		}
+		EXPECT_LE(worstMs, cameraIntervalMs + 0.001) << c.target.Numerator << "/" << c.target.Denominator;
+	}
+}
+
+TEST(FrameAdmissionTest, BurstyCameraKeepsTheAverageRate)
+{
+	struct Case { double targetFps; int burst; };
+	const Case cases[] = { { 15, 2 }, { 10, 4 }, { 15, 4 } };
+	for (const Case &c : cases) {
+		FrameAdmission admission;
+		admission.SetFrameRate(FrameRate::FromFloat((float)c.targetFps));
+		CameraStream camera(30, 60);
+		camera.Burst = c.burst;
+		AdmittedFrames admitted(admission, camera.Timestamps());
+		printf("camera 30 fps in bursts of %d, target %4.1f fps: %5.2f fps, intervals %5.1f..%5.1f ms\n", c.burst, c.targetFps,
+			admitted.GetFps(), admitted.GetMinIntervalMs(), admitted.GetMaxIntervalMs());
+		EXPECT_NEAR(c.targetFps, admitted.GetFps(), c.targetFps * 0.02) << "bursts of " << c.burst << " to " << c.targetFps << " fps";
+	}
+}
+
+TEST(FrameAdmissionTest, SlowCameraIsNotDecimated)
+{
+	FrameAdmission admission;
+	admission.SetFrameRate(FrameRate::FromFraction(15, 1));
+	CameraStream camera(10, 30);
+	camera.JitterMs = 2;
+	std::vector<int64_t> timestamps = camera.Timestamps();
+	AdmittedFrames admitted(admission, timestamps);
+	EXPECT_EQ(timestamps.size(), admitted.Timestamps.size());
+	EXPECT_EQ(0u, admission.GetSkippedCount());
+}
+
+TEST(FrameAdmissionTest, GapIsNotCaughtUpOn)
+{
+	FrameAdmission admission;
+	admission.SetFrameRate(FrameRate::FromFraction(15, 1));
+	CameraStream camera(30, 60);
+	camera.JitterMs = 3;
+	camera.Gap = true;
+	AdmittedFrames admitted(admission, camera.Timestamps());
+	// No burst of frames after the gap to make up for the missing ones.
+	EXPECT_GE(admitted.GetMinIntervalMs(), 66.67 * 5 / 8 - 6);
+	EXPECT_GT(admitted.GetMaxIntervalMs(), 1000.0);
+}
+
+TEST(FrameAdmissionTest, NoRateAdmitsEveryFrame)
+{
+	FrameAdmission admission;
+	admission.SetFrameRate(FrameRate::FromFraction(0, 1));
+	for (int i = 0; i < 100; i++) EXPECT_TRUE(admission.Admit(i * 333333));
+	EXPECT_EQ(100u, admission.GetAdmittedCount());
+	EXPECT_FALSE(admission.GetFrameRate().IsValid());
+}
+
+TEST(FrameAdmissionTest, RateChangeRestartsTheSchedule)
+{
+	FrameAdmission admission;
+	admission.SetFrameRate(FrameRate::FromFraction(30, 1));
+	int64_t timestamp = 0;
+	int admitted = 0;
+	for (int i = 0; i < 300; i++, timestamp += 333333) admitted += admission.Admit(timestamp) ? 1 : 0;
+	EXPECT_EQ(300, admitted);
+
+	admission.SetFrameRate(FrameRate::FromFraction(10, 1));
+	EXPECT_EQ(FrameRate::FromFraction(10, 1), admission.GetFrameRate());
+	admitted = 0;
+	for (int i = 0; i < 300; i++, timestamp += 333333) admitted += admission.Admit(timestamp) ? 1 : 0;
+	// 10 s at 10 fps, the frame 3 ms before a due time being taken early.
+	EXPECT_NEAR(100, admitted, 1);
+}
+
+TEST(FrameAdmissionTest, ResetAndClockGoingBackRestartTheSchedule)
+{
+	FrameAdmission admission;
+	admission.SetFrameRate(FrameRate::FromFraction(15, 1));
+	EXPECT_TRUE(admission.Admit(10000000));
+	EXPECT_FALSE(admission.Admit(10333333));
+
+	// A new capture starts with its own timestamps: its first frame is admitted.
+	admission.Reset();
+	EXPECT_TRUE(admission.Admit(10400000));
+	EXPECT_FALSE(admission.Admit(10733333));
+
+	// So does a frame stamped before the previous one.
+	EXPECT_TRUE(admission.Admit(5000000));
+	EXPECT_FALSE(admission.Admit(5333333));
+	EXPECT_TRUE(admission.Admit(5666666));
+}
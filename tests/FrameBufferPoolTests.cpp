@@ -0,0 +1,146 @@
+/*
+FrameBufferPoolTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <mediastreamer2/mscommon.h>
+
+#include "FrameBufferPool.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	const size_t FrameSize = 1280 * 720 * 3 / 2;
+
+	/// Allocations done through ms_malloc and not freed since the creation of the object.
+	class AllocationCounter
+	{
+	public:
+		AllocationCounter() : mAllocations(ms_test_allocation_count()), mFrees(ms_test_free_count()) {}
+
+		long GetAllocations() const { return ms_test_allocation_count() - mAllocations; }
+		long GetFrees() const { return ms_test_free_count() - mFrees; }
+
+	private:
+		long mAllocations;
+		long mFrees;
+	};
+
+	/// Display of frames that keeps the last ones in use, as the MediaElement does with its sample queue.
+	void DisplayFrames(FrameBufferPool &pool, std::deque<uint8_t *> &inUse, size_t inUseCount, int frames, size_t size)
+	{
+		for (int i = 0; i < frames; i++) {
+			uint8_t *buffer = pool.Get(size);
+			buffer[0] = (uint8_t)i;
+			buffer[size - 1] = (uint8_t)i;
+			inUse.push_back(buffer);
+			if (inUse.size() > inUseCount) {
+				pool.Release(inUse.front(), size);
+				inUse.pop_front();
+			}
+		}
+	}
+}
+
+
+TEST(FrameBufferPoolTest, SteadyStreamDoesNotAllocate)
+{
+	AllocationCounter counter;
+	{
+		FrameBufferPool pool(4);
+		std::deque<uint8_t *> inUse;
+		DisplayFrames(pool, inUse, 2, 10, FrameSize);
+		// The buffers in use and the one being filled.
+		EXPECT_EQ(3, counter.GetAllocations());
+		EXPECT_EQ(3u, pool.GetAllocationCount());
+
+		DisplayFrames(pool, inUse, 2, 1000, FrameSize);
+		EXPECT_EQ(3, counter.GetAllocations());
+		EXPECT_EQ(0, counter.GetFrees());
+		for (uint8_t *buffer : inUse) pool.Release(buffer, FrameSize);
+	}
+	EXPECT_EQ(3, counter.GetFrees());
+}
+
+TEST(FrameBufferPoolTest, KeptBuffersAreBounded)
+{
+	AllocationCounter counter;
+	FrameBufferPool pool(2);
+	std::vector<uint8_t *> buffers;
+	for (int i = 0; i < 5; i++) buffers.push_back(pool.Get(FrameSize));
+	for (uint8_t *buffer : buffers) pool.Release(buffer, FrameSize);
+	// Only two of the five buffers are kept for reuse.
+	EXPECT_EQ(3, counter.GetFrees());
+	for (int i = 0; i < 2; i++) buffers[i] = pool.Get(FrameSize);
+	EXPECT_EQ(5, counter.GetAllocations());
+	buffers[2] = pool.Get(FrameSize);
+	EXPECT_EQ(6, counter.GetAllocations());
+	for (int i = 0; i < 3; i++) pool.Release(buffers[i], FrameSize);
+}
+
+TEST(FrameBufferPoolTest, SizeChangeFreesTheOldBuffers)
+{
+	AllocationCounter counter;
+	FrameBufferPool pool(4);
+	std::deque<uint8_t *> inUse;
+	DisplayFrames(pool, inUse, 2, 10, FrameSize);
+	long allocations = counter.GetAllocations();
+
+	// The buffers of the old size that are still displayed are freed when they come back, not kept.
+	const size_t smallSize = 640 * 480 * 3 / 2;
+	uint8_t *small = pool.Get(smallSize);
+	EXPECT_EQ(allocations + 1, counter.GetAllocations());
+	EXPECT_EQ(1, counter.GetFrees());
+	for (uint8_t *buffer : inUse) pool.Release(buffer, FrameSize);
+	EXPECT_EQ(3, counter.GetFrees());
+	pool.Release(small, smallSize);
+	EXPECT_EQ(small, pool.Get(smallSize));
+	pool.Release(small, smallSize);
+
+	pool.Reset();
+	EXPECT_EQ(4, counter.GetFrees());
+	EXPECT_EQ(counter.GetAllocations(), counter.GetFrees());
+}
+
+TEST(FrameBufferPoolTest, BuffersAreReturnedFromAnotherThread)
+{
+	AllocationCounter counter;
+	{
+		std::shared_ptr<FrameBufferPool> pool = std::make_shared<FrameBufferPool>(4);
+		// The renderer thread gets the buffers, the MediaElement returns them from its own thread.
+		for (int frame = 0; frame < 200; frame++) {
+			uint8_t *buffer = pool->Get(FrameSize);
+			std::thread display([pool, buffer]() { pool->Release(buffer, FrameSize); });
+			display.join();
+		}
+		EXPECT_EQ(1, counter.GetAllocations());
+	}
+	EXPECT_EQ(1, counter.GetFrees());
+}
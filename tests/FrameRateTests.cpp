@@ -0,0 +1,153 @@
+/*
+FrameRateTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "FrameRate.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	// NTSC and PAL derived rates, that have no exact float or whole ms interval.
+	const FrameRate FractionalRates[] = {
+		{ 30000, 1001 }, { 24000, 1001 }, { 15, 2 }, { 25, 2 }
+	};
+
+	const uint64_t TickMs = 10;
+
+	double ToDouble(const FrameRate &rate)
+	{
+		return (double)rate.Numerator / (double)rate.Denominator;
+	}
+}
+
+
+TEST(FrameRateTest, FromFloatRecognizesTheFractionalRates)
+{
+	struct Case { float fps; uint32_t numerator; uint32_t denominator; };
+	const Case cases[] = {
+		{ 7.5f, 15, 2 }, { 12.5f, 25, 2 }, { 29.97f, 30000, 1001 }, { 59.94f, 60000, 1001 }, { 23.976f, 24000, 1001 },
+		{ 14.985f, 15000, 1001 }, { 15.f, 15, 1 }, { 30.f, 30, 1 }, { 0.5f, 1, 2 }, { 10.f, 10, 1 }
+	};
+	for (const Case &c : cases) {
+		FrameRate rate = FrameRate::FromFloat(c.fps);
+		EXPECT_EQ(c.numerator, rate.Numerator) << c.fps;
+		EXPECT_EQ(c.denominator, rate.Denominator) << c.fps;
+	}
+}
+
+TEST(FrameRateTest, InvalidRates)
+{
+	EXPECT_FALSE(FrameRate::FromFloat(0.f).IsValid());
+	EXPECT_FALSE(FrameRate::FromFloat(-1.f).IsValid());
+	EXPECT_FALSE(FrameRate::FromFloat(NAN).IsValid());
+	EXPECT_FALSE(FrameRate::FromFraction(30, 0).IsValid());
+	EXPECT_EQ(0.f, FrameRate::FromFraction(0, 1).ToFloat());
+}
+
+TEST(FrameRateTest, FractionsAreReduced)
+{
+	FrameRate rate = FrameRate::FromFraction(60000, 2002);
+	EXPECT_EQ(30000u, rate.Numerator);
+	EXPECT_EQ(1001u, rate.Denominator);
+	EXPECT_EQ(FrameRate::FromFraction(30000, 1001), FrameRate::FromFraction(90000, 3003));
+	EXPECT_NE(FrameRate::FromFraction(30000, 1001), FrameRate::FromFraction(30, 1));
+}
+
+TEST(FrameRateControllerTest, ScheduleFollowsTheExactRateOverADay)
+{
+	for (const FrameRate &rate : FractionalRates) {
+		FrameRateController controller;
+		controller.Init(rate);
+		// The ideal cadence: frame n is due at n / rate from the first tick.
+		double fps = ToDouble(rate);
+		uint64_t sent = 0;
+		double worst = 0;
+		for (uint64_t now = 0; now < 24 * 3600 * 1000ULL; now += TickMs) {
+			if (controller.IsFrameDue(now)) sent++;
+			double ideal = std::floor(now * fps / 1000.0) + 1;
+			worst = std::max(worst, std::fabs((double)sent - ideal));
+		}
+		EXPECT_LE(worst, 1.0) << rate.Numerator << "/" << rate.Denominator;
+		EXPECT_NEAR(24 * 3600 * fps, (double)sent, 1.5) << rate.Numerator << "/" << rate.Denominator;
+	}
+}
+
+TEST(FrameRateControllerTest, FramesAreSentAtTheFirstTickAfterTheirDueTime)
+{
+	for (const FrameRate &rate : FractionalRates) {
+		FrameRateController controller;
+		controller.Init(rate);
+		double interval = 1000.0 * rate.Denominator / rate.Numerator;
+		uint64_t frame = 0;
+		for (uint64_t now = 0; now < 600 * 1000; now += TickMs) {
+			if (!controller.IsFrameDue(now)) continue;
+			// A floating accumulator of the interval gives the due time, a tick at most before the send time.
+			double due = frame * interval;
+			EXPECT_LE(due, (double)now + 1e-6) << rate.Numerator << "/" << rate.Denominator << " frame " << frame;
+			EXPECT_GT(due, (double)now - TickMs - 1e-6) << rate.Numerator << "/" << rate.Denominator << " frame " << frame;
+			frame++;
+		}
+	}
+}
+
+TEST(FrameRateMeterTest, MeasuresTheFractionalRates)
+{
+	for (const FrameRate &rate : FractionalRates) {
+		FrameRateController controller;
+		FrameRateMeter meter;
+		controller.Init(rate);
+		EXPECT_EQ(0.f, meter.Get());
+		for (uint64_t now = 0; now < 60 * 1000; now += TickMs) {
+			if (controller.IsFrameDue(now)) meter.Update(now);
+		}
+		// The window of 128 frames spans seconds: one tick of error is a few 0.1% of the rate.
+		EXPECT_NEAR(ToDouble(rate), meter.Get(), ToDouble(rate) * 0.003) << rate.Numerator << "/" << rate.Denominator;
+		meter.Reset();
+		EXPECT_EQ(0.f, meter.Get());
+	}
+}
+
+TEST(FrameRateMeterTest, ReadWhileTheTickerUpdatesIt)
+{
+	FrameRateMeter meter;
+	std::atomic<bool> done(false);
+	// The ticker sends 30 fps while the application thread polls the rate.
+	std::thread ticker([&]() {
+		for (uint64_t now = 0; now < 600 * 1000; now += 33) meter.Update(now);
+		done = true;
+	});
+	float rate = 0.f;
+	while (!done) {
+		rate = meter.Get();
+		EXPECT_TRUE((rate == 0.f) || ((rate > 29.f) && (rate < 31.f))) << rate;
+	}
+	ticker.join();
+	EXPECT_NEAR(1000.0 / 33, meter.Get(), 0.01);
+}
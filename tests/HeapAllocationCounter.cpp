@@ -0,0 +1,57 @@
+/*
+HeapAllocationCounter.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+// Replaces the global operator new of the tester so that a test can check that a code path does not allocate.
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "TestSupport.h"
+
+
+static std::atomic<long> sHeapAllocationCount(0);
+
+long libmswinrtvid::test::GetHeapAllocationCount()
+{
+	return sHeapAllocationCount;
+}
+
+void * operator new(size_t size)
+{
+	sHeapAllocationCount++;
+	void *ptr = malloc((size > 0) ? size : 1);
+	if (ptr == NULL) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
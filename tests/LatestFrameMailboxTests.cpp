@@ -0,0 +1,197 @@
+/*
+LatestFrameMailboxTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "LatestFrameMailbox.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	std::atomic<int> sLiveFrames(0);
+
+	struct Frame
+	{
+		Frame(int number) : Number(number) { sLiveFrames++; }
+		~Frame() { sLiveFrames--; }
+
+		int Number;
+	};
+
+	typedef LatestFrameMailbox<Frame, int> Mailbox;
+}
+
+
+TEST(LatestFrameMailboxTest, NewestFrameReplacesTheOneNotTaken)
+{
+	sLiveFrames = 0;
+	{
+		Mailbox mailbox(4);
+		EXPECT_EQ(nullptr, mailbox.Post(new Frame(1)));
+		Frame *replaced = mailbox.Post(new Frame(2));
+		ASSERT_NE(nullptr, replaced);
+		EXPECT_EQ(1, replaced->Number);
+		delete replaced;
+		EXPECT_EQ(1u, mailbox.GetReplacedCount());
+
+		Frame *frame = mailbox.Take();
+		ASSERT_NE(nullptr, frame);
+		EXPECT_EQ(2, frame->Number);
+		delete frame;
+		EXPECT_EQ(nullptr, mailbox.Take());
+
+		// The mailbox owns the frame left in the slot.
+		mailbox.Post(new Frame(3));
+	}
+	EXPECT_EQ(0, sLiveFrames.load());
+}
+
+TEST(LatestFrameMailboxTest, DeferredRequestIsMatchedWithTheNextFrame)
+{
+	sLiveFrames = 0;
+	Mailbox mailbox(4);
+	int request;
+	Frame *frame;
+	EXPECT_FALSE(mailbox.Match(request, frame));
+
+	int evicted = -1;
+	EXPECT_FALSE(mailbox.Defer(10, evicted));
+	EXPECT_FALSE(mailbox.Defer(11, evicted));
+	EXPECT_FALSE(mailbox.Match(request, frame));
+
+	mailbox.Post(new Frame(1));
+	ASSERT_TRUE(mailbox.Match(request, frame));
+	EXPECT_EQ(10, request);
+	EXPECT_EQ(1, frame->Number);
+	delete frame;
+	EXPECT_FALSE(mailbox.Match(request, frame));
+
+	mailbox.Post(new Frame(2));
+	ASSERT_TRUE(mailbox.Match(request, frame));
+	EXPECT_EQ(11, request);
+	delete frame;
+
+	// A frame without a request waits in the slot.
+	mailbox.Post(new Frame(3));
+	EXPECT_FALSE(mailbox.Match(request, frame));
+	mailbox.Clear([](int &) {});
+	EXPECT_EQ(0, sLiveFrames.load());
+}
+
+TEST(LatestFrameMailboxTest, TooManyDeferredRequestsEvictTheOldest)
+{
+	Mailbox mailbox(2);
+	int evicted = -1;
+	EXPECT_FALSE(mailbox.Defer(1, evicted));
+	EXPECT_FALSE(mailbox.Defer(2, evicted));
+	EXPECT_TRUE(mailbox.Defer(3, evicted));
+	EXPECT_EQ(1, evicted);
+
+	std::vector<int> cleared;
+	mailbox.Clear([&](int &request) { cleared.push_back(request); });
+	EXPECT_EQ((std::vector<int>{ 2, 3 }), cleared);
+}
+
+TEST(LatestFrameMailboxTest, ThreadedHandoffAnswersEveryRequest)
+{
+	sLiveFrames = 0;
+	const int frames = 20000;
+	std::atomic<int> answered(0);
+	std::atomic<int> outOfOrder(0);
+	std::atomic<int> replacedByProducer(0);
+	std::atomic<int> lastNumber(0);
+	std::atomic<bool> producerDone(false);
+	std::atomic<int> outstanding(0);
+	int requests = 0;
+	int evictedCount = 0;
+	{
+		Mailbox mailbox(4);
+		auto answer = [&](int, Frame *frame) {
+			if (frame->Number <= lastNumber) outOfOrder++;
+			lastNumber = frame->Number;
+			delete frame;
+			answered++;
+			outstanding--;
+		};
+
+		// The ticker thread feeds the frames and answers the request deferred while no frame was there.
+		std::thread producer([&]() {
+			for (int i = 1; i <= frames; i++) {
+				Frame *replaced = mailbox.Post(new Frame(i));
+				if (replaced != nullptr) {
+					delete replaced;
+					replacedByProducer++;
+				}
+				int request;
+				Frame *frame;
+				if (mailbox.Match(request, frame)) answer(request, frame);
+				if ((i % 64) == 0) std::this_thread::yield();
+			}
+			producerDone = true;
+		});
+
+		// The media pipeline keeps a single request outstanding: it raises the next one once the previous is answered.
+		int request = 0;
+		while (!producerDone) {
+			if (outstanding > 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			outstanding++;
+			requests++;
+			Frame *frame = mailbox.Take();
+			if (frame != nullptr) {
+				answer(request++, frame);
+				continue;
+			}
+			int evicted;
+			if (mailbox.Defer(request++, evicted)) evictedCount++;
+			int matched;
+			if (mailbox.Match(matched, frame)) answer(matched, frame);
+		}
+		producer.join();
+
+		// At the end, either the last request is still deferred or the last frame is still in the slot, never both.
+		Frame *left = mailbox.Take();
+		int leftInSlot = (left != nullptr) ? 1 : 0;
+		delete left;
+		int remaining = 0;
+		mailbox.Clear([&](int &) { remaining++; outstanding--; });
+		EXPECT_LE(remaining + leftInSlot, 1);
+		EXPECT_EQ(requests, answered + remaining);
+		// Every frame has been answered, replaced by a newer one or left in the slot.
+		EXPECT_EQ(frames, answered + replacedByProducer + leftInSlot);
+		EXPECT_EQ((unsigned long long)replacedByProducer.load(), mailbox.GetReplacedCount());
+	}
+	printf("%d frames, %d requests answered, %d frames replaced before being taken\n", frames, answered.load(), replacedByProducer.load());
+	EXPECT_EQ(0, outOfOrder.load());
+	EXPECT_EQ(0, evictedCount);
+	EXPECT_EQ(0, outstanding.load());
+	EXPECT_EQ(0, sLiveFrames.load());
+}
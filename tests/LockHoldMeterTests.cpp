@@ -0,0 +1,98 @@
+/*
+LockHoldMeterTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "LockHoldMeter.h"
+#include "MonotonicClock.h"
+
+using namespace libmswinrtvid;
+
+
+TEST(LockHoldMeterTest, AverageAndMaximumOfTheRecordedTicks)
+{
+	LockHoldMeter meter;
+	meter.SetFrequency(10000000);
+	EXPECT_EQ(0u, meter.GetCount());
+	EXPECT_EQ(0.0, meter.GetAverageUs());
+	meter.Record(10);
+	meter.Record(20);
+	meter.Record(30);
+	// A counter read out of order is not a negative hold.
+	meter.Record(-50);
+	EXPECT_EQ(4u, meter.GetCount());
+	EXPECT_DOUBLE_EQ(1.5, meter.GetAverageUs());
+	EXPECT_DOUBLE_EQ(3.0, meter.GetMaxUs());
+	meter.Reset();
+	EXPECT_EQ(0u, meter.GetCount());
+	EXPECT_EQ(0.0, meter.GetMaxUs());
+}
+
+TEST(LockHoldMeterTest, InvalidFrequencyDoesNotDivideByZero)
+{
+	LockHoldMeter meter;
+	meter.SetFrequency(0);
+	meter.Record(3);
+	EXPECT_DOUBLE_EQ(3000000.0, meter.GetAverageUs());
+}
+
+TEST(LockHoldMeterTest, MeasuresTheHoldsAndWaitsOfAContendedLock)
+{
+	// As in the stream sink: the holds are recorded by the holder before it releases the lock, the waits by the
+	// waiter once it has acquired it, both under the lock.
+	std::mutex mutex;
+	LockHoldMeter holds;
+	LockHoldMeter waits;
+	holds.SetFrequency(MonotonicClock::Rate);
+	waits.SetFrequency(MonotonicClock::Rate);
+	const int rounds = 20;
+	for (int i = 0; i < rounds; i++) {
+		std::atomic<bool> held(false);
+		std::thread holder([&]() {
+			mutex.lock();
+			int64_t start = MonotonicClock::Now();
+			held = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			holds.Record(MonotonicClock::Now() - start);
+			mutex.unlock();
+		});
+		while (!held) std::this_thread::yield();
+		int64_t start = MonotonicClock::Now();
+		mutex.lock();
+		waits.Record(MonotonicClock::Now() - start);
+		mutex.unlock();
+		holder.join();
+	}
+	EXPECT_EQ((unsigned int)rounds, holds.GetCount());
+	EXPECT_EQ((unsigned int)rounds, waits.GetCount());
+	EXPECT_GE(holds.GetAverageUs(), 2000.0);
+	EXPECT_GE(holds.GetMaxUs(), holds.GetAverageUs());
+	// The waiter starts waiting once the lock is held, the waits cover most of the holds.
+	EXPECT_GE(waits.GetMaxUs(), 1000.0);
+	EXPECT_LE(waits.GetAverageUs(), holds.GetMaxUs() + 1000.0);
+}
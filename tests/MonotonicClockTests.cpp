@@ -0,0 +1,227 @@
+/*
+MonotonicClockTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "MonotonicClock.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	const int64_t Ms = MonotonicClock::Rate / 1000;
+	// Granularity of GetTickCount64, that stamped the samples before the MonotonicClock.
+	const int64_t TickGranularity = 156250;
+
+	struct Spread
+	{
+		double Sd;
+		double WorstDeviation;
+	};
+
+	Spread SpreadAround(const std::vector<double> &values, double nominal)
+	{
+		double sum = 0, sum2 = 0, worst = 0;
+		for (double value : values) {
+			sum += value;
+			sum2 += value * value;
+			worst = std::max(worst, std::fabs(value - nominal));
+		}
+		double mean = sum / values.size();
+		return { std::sqrt(std::max(0.0, sum2 / values.size() - mean * mean)), worst };
+	}
+
+	/// Arrival times of a camera at the given rate, with a normal jitter, in MonotonicClock units.
+	std::vector<int64_t> Arrivals(double fps, double jitterMs, int count, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::normal_distribution<double> jitter(0, jitterMs > 0 ? jitterMs : 1);
+		std::vector<int64_t> arrivals;
+		for (int i = 0; i < count; i++) {
+			double ms = 1000 + i * 1000.0 / fps + (jitterMs > 0 ? jitter(rng) : 0);
+			arrivals.push_back((int64_t)(ms * Ms));
+		}
+		std::sort(arrivals.begin(), arrivals.end());
+		return arrivals;
+	}
+
+	struct JitterCase
+	{
+		double fps;
+		double jitterMs;
+		double boundMs;
+	};
+
+	// Steady and jittered cameras, down to the NTSC rate.
+	const JitterCase JitterCases[] = {
+		{ 30, 0, 0.5 }, { 30, 3, 2.5 }, { 30, 8, 6.0 }, { 15, 5, 4.0 }, { 29.97, 2, 2.0 }
+	};
+}
+
+
+TEST(MonotonicClockTest, NowIsMonotonicIn100NsUnits)
+{
+	int64_t previous = MonotonicClock::Now();
+	for (int i = 0; i < 10000; i++) {
+		int64_t now = MonotonicClock::Now();
+		ASSERT_GE(now, previous);
+		previous = now;
+	}
+	int64_t start = MonotonicClock::Now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	int64_t elapsed = MonotonicClock::Now() - start;
+	EXPECT_GE(elapsed, 19 * Ms);
+	EXPECT_LT(elapsed, 500 * Ms);
+}
+
+TEST(SampleClockTest, TimelineStartsAtTheFirstSample)
+{
+	SampleClock clock;
+	EXPECT_FALSE(clock.IsStarted());
+	int64_t sampleTime, duration;
+	clock.Stamp(123456789, sampleTime, duration);
+	EXPECT_TRUE(clock.IsStarted());
+	EXPECT_EQ(0, sampleTime);
+	EXPECT_EQ(MonotonicClock::Rate / 30, duration);
+	clock.Stamp(123456789 + 40 * Ms, sampleTime, duration);
+	EXPECT_EQ(40 * Ms, sampleTime);
+}
+
+TEST(SampleClockTest, JitteredArrivalsKeepDurationsCloseToTheFrameInterval)
+{
+	for (const JitterCase &c : JitterCases) {
+		std::vector<int64_t> arrivals = Arrivals(c.fps, c.jitterMs, 600, 7);
+		SampleClock clock;
+		std::vector<double> durations, tickIntervals;
+		int64_t sampleTime, duration, previousTime = -1, previousTick = 0;
+		for (size_t i = 0; i < arrivals.size(); i++) {
+			clock.Stamp(arrivals[i], sampleTime, duration);
+			ASSERT_GT(sampleTime, previousTime);
+			previousTime = sampleTime;
+			int64_t tick = (arrivals[i] / TickGranularity) * TickGranularity;
+			// Leave the convergence from the default duration out.
+			if (i >= 30) {
+				durations.push_back((double)duration / Ms);
+				tickIntervals.push_back((double)(tick - previousTick) / Ms);
+			}
+			previousTick = tick;
+		}
+		double nominal = 1000.0 / c.fps;
+		Spread smoothed = SpreadAround(durations, nominal);
+		Spread ticks = SpreadAround(tickIntervals, nominal);
+		EXPECT_LE(smoothed.WorstDeviation, c.boundMs) << c.fps << " fps jitter " << c.jitterMs << " ms";
+		EXPECT_LT(smoothed.Sd, ticks.Sd) << c.fps << " fps jitter " << c.jitterMs << " ms";
+	}
+}
+
+TEST(SampleClockTest, PairedBurstsAreSmoothedToTheMeanInterval)
+{
+	// Pairs of frames 5 ms apart every 66.7 ms, as some cameras deliver them.
+	SampleClock clock;
+	std::vector<double> durations;
+	int64_t sampleTime, duration;
+	for (int i = 0; i < 300; i++) {
+		int64_t pair = (int64_t)((1000 + i * 66.67) * Ms);
+		clock.Stamp(pair, sampleTime, duration);
+		if (i >= 15) durations.push_back((double)duration / Ms);
+		clock.Stamp(pair + 5 * Ms, sampleTime, duration);
+		if (i >= 15) durations.push_back((double)duration / Ms);
+	}
+	EXPECT_LE(SpreadAround(durations, 33.33).WorstDeviation, 12.0);
+}
+
+TEST(SampleClockTest, AnswerLatencyDoesNotSkewTheDurations)
+{
+	// Frames every 33.3 ms whose requests are answered 0 to 25 ms late, as when they wait in the deferral queue.
+	SampleClock fromArrival, fromAnswer;
+	std::mt19937 random(11);
+	std::uniform_int_distribution<int> latency(0, 25);
+	std::vector<double> arrivalDurations, answerDurations;
+	int64_t sampleTime, duration;
+	for (int i = 0; i < 300; i++) {
+		int64_t arrival = (int64_t)((1000 + i * 33.33) * Ms);
+		fromArrival.Stamp(arrival, sampleTime, duration);
+		if (i >= 30) arrivalDurations.push_back((double)duration / Ms);
+		fromAnswer.Stamp(arrival + latency(random) * Ms, sampleTime, duration);
+		if (i >= 30) answerDurations.push_back((double)duration / Ms);
+	}
+	EXPECT_LE(SpreadAround(arrivalDurations, 33.33).WorstDeviation, 0.5);
+	EXPECT_GT(SpreadAround(answerDurations, 33.33).WorstDeviation, 1.0);
+}
+
+TEST(SampleClockTest, EarlierArrivalIsStampedAfterThePreviousSample)
+{
+	// A repeated frame stamped when answered, then a frame fed before that answer.
+	SampleClock clock;
+	int64_t sampleTime, duration, previousTime, previousDuration;
+	clock.Stamp(0, sampleTime, duration);
+	clock.Stamp(40 * Ms, previousTime, previousDuration);
+	clock.Stamp(35 * Ms, sampleTime, duration);
+	EXPECT_GT(sampleTime, previousTime);
+	EXPECT_EQ(previousDuration, duration);
+	clock.Stamp(40 * Ms, sampleTime, duration);
+	EXPECT_GT(sampleTime, previousTime);
+}
+
+TEST(SampleClockTest, PauseDoesNotSkewTheDuration)
+{
+	SampleClock clock;
+	int64_t sampleTime, duration;
+	const int64_t interval = MonotonicClock::Rate / 30;
+	int64_t now = 0;
+	for (int i = 0; i < 60; i++, now += interval) clock.Stamp(now, sampleTime, duration);
+	now += 5 * MonotonicClock::Rate;
+	clock.Stamp(now, sampleTime, duration);
+	EXPECT_NEAR(interval, duration, 2 * Ms);
+	EXPECT_EQ(now, sampleTime);
+}
+
+TEST(SampleClockTest, DurationFollowsARateChange)
+{
+	SampleClock clock;
+	int64_t sampleTime, duration;
+	int64_t now = 0;
+	for (int i = 0; i < 60; i++, now += MonotonicClock::Rate / 30) clock.Stamp(now, sampleTime, duration);
+	for (int i = 0; i < 40; i++, now += MonotonicClock::Rate / 15) clock.Stamp(now, sampleTime, duration);
+	EXPECT_NEAR(MonotonicClock::Rate / 15, duration, 2 * Ms);
+}
+
+TEST(SampleClockTest, ResetRestartsTheTimeline)
+{
+	SampleClock clock;
+	int64_t sampleTime, duration;
+	for (int i = 0; i < 60; i++) clock.Stamp(i * MonotonicClock::Rate / 15, sampleTime, duration);
+	clock.Reset();
+	EXPECT_FALSE(clock.IsStarted());
+	clock.Stamp(123456789, sampleTime, duration);
+	EXPECT_EQ(0, sampleTime);
+	EXPECT_EQ(MonotonicClock::Rate / 30, duration);
+}
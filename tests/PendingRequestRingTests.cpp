@@ -0,0 +1,84 @@
+/*
+PendingRequestRingTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "PendingRequestRing.h"
+
+using namespace libmswinrtvid;
+
+
+TEST(PendingRequestRingTest, RequestsAreAnsweredInOrder)
+{
+	PendingRequestRing<int> ring(4);
+	int evicted = -1;
+	int request;
+	// Around the ring several times, never full.
+	for (int i = 0; i < 20; i++) {
+		EXPECT_FALSE(ring.Push(2 * i, evicted));
+		EXPECT_FALSE(ring.Push(2 * i + 1, evicted));
+		ASSERT_TRUE(ring.Pop(request));
+		EXPECT_EQ(2 * i, request);
+		ASSERT_TRUE(ring.Pop(request));
+		EXPECT_EQ(2 * i + 1, request);
+	}
+	EXPECT_FALSE(ring.Pop(request));
+	EXPECT_EQ(-1, evicted);
+	EXPECT_EQ(0u, ring.GetEvictedCount());
+}
+
+TEST(PendingRequestRingTest, OverflowEvictsTheOldestRequest)
+{
+	PendingRequestRing<int> ring(3);
+	int evicted = -1;
+	for (int i = 0; i < 3; i++) EXPECT_FALSE(ring.Push(i, evicted));
+	EXPECT_TRUE(ring.Push(3, evicted));
+	EXPECT_EQ(0, evicted);
+	EXPECT_TRUE(ring.Push(4, evicted));
+	EXPECT_EQ(1, evicted);
+	EXPECT_EQ(2u, ring.GetEvictedCount());
+	EXPECT_EQ(3u, ring.GetCount());
+	EXPECT_EQ(3u, ring.GetCapacity());
+
+	std::vector<int> cleared;
+	ring.Clear([&](int &request) { cleared.push_back(request); });
+	EXPECT_EQ((std::vector<int>{ 2, 3, 4 }), cleared);
+	EXPECT_TRUE(ring.IsEmpty());
+}
+
+TEST(PendingRequestRingTest, PoppedRequestIsNotReferencedAnymore)
+{
+	// The requests are reference counted WinRT objects: the ring must not keep them alive once popped.
+	PendingRequestRing<std::shared_ptr<int>> ring(2);
+	std::shared_ptr<int> request = std::make_shared<int>(1);
+	std::shared_ptr<int> evicted;
+	ring.Push(request, evicted);
+	EXPECT_EQ(2, request.use_count());
+	std::shared_ptr<int> popped;
+	ASSERT_TRUE(ring.Pop(popped));
+	popped.reset();
+	EXPECT_EQ(1, request.use_count());
+}
@@ -0,0 +1,192 @@
+/*
+RenderAheadEstimatorTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "RenderAheadEstimator.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	const int64_t Ms = 10000;
+	// Render-ahead used for every frame before the estimator.
+	const int64_t FixedRenderAhead = 40 * Ms;
+
+	/// Jitter of the frames of a stream: an exponential tail, as the network and the decoder delay frames.
+	std::vector<int64_t> SyntheticJitter(double meanMs, int count, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::exponential_distribution<double> tail(1.0 / meanMs);
+		std::vector<int64_t> jitter;
+		for (int i = 0; i < count; i++) jitter.push_back((int64_t)(tail(rng) * Ms));
+		return jitter;
+	}
+
+	struct Outcome
+	{
+		// Frames whose jitter exceeded the render-ahead they were scheduled with.
+		double lateRatio;
+		double meanRenderAheadMs;
+	};
+
+	/// The render-ahead of a frame is the one returned for the previous frame, its own jitter being known only once it has arrived.
+	Outcome Schedule(RenderAheadEstimator &estimator, const std::vector<int64_t> &jitter, int skipped)
+	{
+		int64_t renderAhead = estimator.Update(jitter[0]);
+		int late = 0;
+		double sum = 0;
+		for (size_t i = 1; i < jitter.size(); i++) {
+			if ((int)i >= skipped) {
+				if (jitter[i] > renderAhead) late++;
+				sum += (double)renderAhead / Ms;
+			}
+			renderAhead = estimator.Update(jitter[i]);
+		}
+		int counted = (int)jitter.size() - skipped;
+		return { (double)late / counted, sum / counted };
+	}
+
+	double FixedLateRatio(const std::vector<int64_t> &jitter, int skipped)
+	{
+		int late = 0;
+		for (size_t i = skipped; i < jitter.size(); i++) {
+			if (jitter[i] > FixedRenderAhead) late++;
+		}
+		return (double)late / (jitter.size() - skipped);
+	}
+}
+
+
+TEST(RenderAheadEstimatorTest, FixedRenderAheadUntilEnoughFrames)
+{
+	RenderAheadEstimator estimator;
+	for (int i = 0; i < 29; i++) EXPECT_EQ(FixedRenderAhead, estimator.Update(0));
+	// From the 30th frame on, the jitter of the window is used and the estimate decreases by 1 ms per frame.
+	EXPECT_EQ(FixedRenderAhead - Ms, estimator.Update(0));
+}
+
+TEST(RenderAheadEstimatorTest, SyntheticJitterIsCoveredAtThePercentile)
+{
+	struct JitterCase { double meanMs; int maxMs; };
+	// Quiet and busy networks, within the default bounds, and a tail beyond the upper bound.
+	const JitterCase cases[] = { { 1, 200 }, { 3, 200 }, { 8, 200 }, { 20, 200 }, { 20, 40 } };
+	for (const JitterCase &c : cases) {
+		RenderAheadEstimator estimator;
+		ASSERT_TRUE(estimator.SetBounds(RenderAheadEstimator::DefaultMinMs, c.maxMs));
+		std::vector<int64_t> jitter = SyntheticJitter(c.meanMs, 3000, 11);
+		Outcome outcome = Schedule(estimator, jitter, 300);
+		double fixedLateRatio = FixedLateRatio(jitter, 300);
+		if (c.maxMs >= 200) {
+			// The percentile plus the margin leaves fewer late frames than the 5% the percentile lets through.
+			EXPECT_LE(outcome.lateRatio, 0.05) << "mean jitter " << c.meanMs << " ms";
+		} else {
+			EXPECT_LE(outcome.meanRenderAheadMs, c.maxMs) << "mean jitter " << c.meanMs << " ms";
+		}
+		if (fixedLateRatio <= 0.05) {
+			// On a quiet network, the frames are presented with less delay than with the fixed render-ahead.
+			EXPECT_LT(outcome.meanRenderAheadMs, (double)FixedRenderAhead / Ms) << "mean jitter " << c.meanMs << " ms";
+		} else {
+			EXPECT_LE(outcome.lateRatio, fixedLateRatio) << "mean jitter " << c.meanMs << " ms";
+		}
+	}
+}
+
+TEST(RenderAheadEstimatorTest, RisesAtOnceAndFallsByOneMsPerFrame)
+{
+	RenderAheadEstimator estimator;
+	int64_t value = 0;
+	for (int i = 0; i < 300; i++) value = estimator.Update(2 * Ms);
+	EXPECT_EQ(10 * Ms, value);
+
+	// A burst of late frames, above 5% of the window, raises the render-ahead on the frame that crosses it.
+	int64_t previous = value;
+	for (int i = 0; i < 20; i++) {
+		value = estimator.Update(60 * Ms);
+		EXPECT_GE(value, previous);
+		previous = value;
+	}
+	EXPECT_EQ(67 * Ms, value);
+
+	// Once the burst has left the window, the render-ahead goes back down without steps above 1 ms.
+	for (int i = 0; i < 400; i++) {
+		value = estimator.Update(2 * Ms);
+		EXPECT_LE(previous - value, Ms);
+		EXPECT_LE(value, previous);
+		previous = value;
+	}
+	EXPECT_EQ(10 * Ms, value);
+}
+
+TEST(RenderAheadEstimatorTest, BoundsClampTheEstimate)
+{
+	RenderAheadEstimator estimator;
+	EXPECT_FALSE(estimator.SetBounds(-1, 100));
+	EXPECT_FALSE(estimator.SetBounds(50, 20));
+	ASSERT_TRUE(estimator.SetBounds(20, 60));
+	int minMs, maxMs;
+	estimator.GetBounds(minMs, maxMs);
+	EXPECT_EQ(20, minMs);
+	EXPECT_EQ(60, maxMs);
+
+	int64_t value = 0;
+	for (int i = 0; i < 300; i++) value = estimator.Update(0);
+	EXPECT_EQ(20 * Ms, value);
+	for (int i = 0; i < 300; i++) value = estimator.Update(150 * Ms);
+	EXPECT_EQ(60 * Ms, value);
+	EXPECT_EQ(60, estimator.GetRenderAheadMs());
+
+	// Narrowing the bounds applies to the current estimate.
+	ASSERT_TRUE(estimator.SetBounds(20, 30));
+	EXPECT_EQ(30, estimator.GetRenderAheadMs());
+}
+
+TEST(RenderAheadEstimatorTest, HistogramCountsTheWindow)
+{
+	RenderAheadEstimator estimator;
+	const int frames = 1000;
+	for (int i = 0; i < frames; i++) estimator.Update((i % 2) ? 3 * Ms : 1000 * Ms);
+	unsigned int counts[RenderAheadEstimator::BucketCount];
+	estimator.GetHistogram(counts);
+	unsigned int total = 0;
+	for (int i = 0; i < RenderAheadEstimator::BucketCount; i++) total += counts[i];
+	EXPECT_EQ(300u, total);
+	EXPECT_EQ(150u, counts[3 / RenderAheadEstimator::BucketWidthMs]);
+	// Jitters beyond the histogram all go to the last bucket.
+	EXPECT_EQ(150u, counts[RenderAheadEstimator::BucketCount - 1]);
+}
+
+TEST(RenderAheadEstimatorTest, ResetForgetsTheJitter)
+{
+	RenderAheadEstimator estimator;
+	for (int i = 0; i < 300; i++) estimator.Update(100 * Ms);
+	estimator.Reset();
+	unsigned int counts[RenderAheadEstimator::BucketCount];
+	estimator.GetHistogram(counts);
+	for (int i = 0; i < RenderAheadEstimator::BucketCount; i++) EXPECT_EQ(0u, counts[i]);
+	EXPECT_EQ(FixedRenderAhead, estimator.Update(100 * Ms));
+}
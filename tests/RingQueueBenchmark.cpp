@@ -0,0 +1,95 @@
+/*
+RingQueueBenchmark.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <memory>
+
+#include "RingQueue.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	/// Queue of the samples of the media sink before the ring buffer: a linked list, allocating a node per item.
+	template <class T>
+	class ListQueue
+	{
+	public:
+		bool PushBack(const T &item)
+		{
+			mItems.push_back(item);
+			return true;
+		}
+
+		bool PopFront(T &item)
+		{
+			if (mItems.empty()) return false;
+			item = mItems.front();
+			mItems.pop_front();
+			return true;
+		}
+
+	private:
+		std::list<T> mItems;
+	};
+
+	/// Time in ns of a push and a pop on a queue holding depth items, with a reference counted item as a ComPtr would be.
+	template <class Queue>
+	double MeasurePushPopNs(Queue &queue, int depth, int iterations)
+	{
+		std::shared_ptr<int> items[64];
+		for (int i = 0; i < 64; i++) items[i] = std::make_shared<int>(i);
+		for (int i = 0; i < depth; i++) queue.PushBack(items[i]);
+		std::shared_ptr<int> item;
+		long sum = 0;
+		double ms = MeasureMs(1, [&]() {
+			for (int i = 0; i < iterations; i++) {
+				queue.PushBack(items[i & 63]);
+				queue.PopFront(item);
+				sum += *item;
+			}
+		});
+		EXPECT_GT(sum, 0);
+		return (ms * 1000000.0) / iterations;
+	}
+}
+
+
+TEST(RingQueueBenchmark, PushPopAgainstLinkedList)
+{
+	printf("Push and pop of a queued sample, ring buffer against a linked list\n");
+	const int iterations = 2000000;
+	for (int depth : { 1, 4, 16 }) {
+		ListQueue<std::shared_ptr<int>> list;
+		RingQueue<std::shared_ptr<int>> ring(4);
+		double listNs = MeasurePushPopNs(list, depth, iterations);
+		double ringNs = MeasurePushPopNs(ring, depth, iterations);
+		printf("  depth %2d: list %6.1f ns, ring %6.1f ns, x%.1f\n", depth, listNs, ringNs, listNs / ringNs);
+		EXPECT_EQ((size_t)depth, ring.GetCount());
+	}
+}
@@ -0,0 +1,84 @@
+/*
+RingQueueTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <random>
+
+#include "RingQueue.h"
+
+using namespace libmswinrtvid;
+
+
+TEST(RingQueueTest, KeepsTheOrderAcrossWrapsAndGrowth)
+{
+	RingQueue<int> queue(3);
+	std::deque<int> expected;
+	std::mt19937 generator(1);
+	int next = 0;
+	for (int i = 0; i < 100000; i++) {
+		if ((generator() % 3) != 0) {
+			ASSERT_TRUE(queue.PushBack(next));
+			expected.push_back(next++);
+		} else {
+			int item = -1;
+			bool popped = queue.PopFront(item);
+			ASSERT_EQ(!expected.empty(), popped);
+			if (popped) {
+				ASSERT_EQ(expected.front(), item);
+				expected.pop_front();
+			}
+		}
+		ASSERT_EQ(expected.size(), queue.GetCount());
+	}
+}
+
+TEST(RingQueueTest, SteadyDepthDoesNotGrow)
+{
+	RingQueue<int> queue(4);
+	for (int i = 0; i < 4; i++) queue.PushBack(i);
+	EXPECT_EQ(4u, queue.GetCapacity());
+	int item;
+	for (int i = 4; i < 10000; i++) {
+		ASSERT_TRUE(queue.PushBack(i));
+		ASSERT_TRUE(queue.PopFront(item));
+		ASSERT_EQ(i - 4, item);
+	}
+	// The fifth item made the buffer grow once, then it was reused.
+	EXPECT_EQ(8u, queue.GetCapacity());
+}
+
+TEST(RingQueueTest, ClearReleasesEveryItem)
+{
+	RingQueue<int> queue(2);
+	for (int i = 0; i < 5; i++) queue.PushBack(i);
+	int sum = 0;
+	queue.Clear([&](int &item) { sum += item; });
+	EXPECT_EQ(10, sum);
+	EXPECT_TRUE(queue.IsEmpty());
+	int item;
+	EXPECT_FALSE(queue.PopFront(item));
+	// The buffer grown to hold the five items is kept.
+	EXPECT_EQ(8u, queue.GetCapacity());
+}
@@ -0,0 +1,204 @@
+/*
+SamplePoolTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "SamplePool.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	/// Stand-in for an IMFSample: a handle that counts the samples alive, as the references of a ComPtr would.
+	struct FakeSample
+	{
+		FakeSample(int width, int height, std::atomic<int> &alive) : Width(width), Height(height), Alive(alive) { Alive++; }
+		~FakeSample() { Alive--; }
+
+		int Width;
+		int Height;
+		std::atomic<int> &Alive;
+	};
+
+	typedef std::shared_ptr<FakeSample> FakeSampleRef;
+
+	/// Creates the samples asked for by the pool, and counts them.
+	class FakeAllocator
+	{
+	public:
+		FakeAllocator() : Created(0), Alive(0), Fail(false) {}
+
+		std::function<bool(FakeSampleRef &)> For(int width, int height)
+		{
+			return [this, width, height](FakeSampleRef &sample) {
+				if (Fail) return false;
+				Created++;
+				sample = std::make_shared<FakeSample>(width, height, Alive);
+				return true;
+			};
+		}
+
+		std::atomic<int> Created;
+		std::atomic<int> Alive;
+		bool Fail;
+	};
+}
+
+
+TEST(SamplePoolTest, RecycledSampleIsReused)
+{
+	FakeAllocator allocator;
+	SamplePool<FakeSampleRef> pool(2);
+	FakeSampleRef first;
+	unsigned int generation;
+	ASSERT_TRUE(pool.Acquire(640, 480, first, generation, allocator.For(640, 480)));
+	EXPECT_TRUE(pool.Recycle(first, generation));
+	EXPECT_EQ(1u, pool.GetFreeCount());
+	EXPECT_EQ(0u, pool.GetInUseCount());
+
+	FakeSampleRef again;
+	ASSERT_TRUE(pool.Acquire(640, 480, again, generation, allocator.For(640, 480)));
+	EXPECT_EQ(first, again);
+	EXPECT_EQ(1, allocator.Created.load());
+	EXPECT_EQ(1u, pool.GetInUseCount());
+}
+
+TEST(SamplePoolTest, CapacityBoundsTheSamplesInUse)
+{
+	FakeAllocator allocator;
+	SamplePool<FakeSampleRef> pool(2);
+	FakeSampleRef samples[3];
+	unsigned int generations[3];
+	ASSERT_TRUE(pool.Acquire(640, 480, samples[0], generations[0], allocator.For(640, 480)));
+	ASSERT_TRUE(pool.Acquire(640, 480, samples[1], generations[1], allocator.For(640, 480)));
+	EXPECT_FALSE(pool.Acquire(640, 480, samples[2], generations[2], allocator.For(640, 480)));
+	EXPECT_EQ(2, allocator.Created.load());
+
+	// Once a sample is back, the next one reuses it without creating another one.
+	ASSERT_TRUE(pool.Recycle(samples[0], generations[0]));
+	ASSERT_TRUE(pool.Acquire(640, 480, samples[2], generations[2], allocator.For(640, 480)));
+	EXPECT_EQ(samples[0], samples[2]);
+	EXPECT_EQ(2, allocator.Created.load());
+}
+
+TEST(SamplePoolTest, FailedCreationIsNotCounted)
+{
+	FakeAllocator allocator;
+	SamplePool<FakeSampleRef> pool(1);
+	FakeSampleRef sample;
+	unsigned int generation;
+	allocator.Fail = true;
+	EXPECT_FALSE(pool.Acquire(640, 480, sample, generation, allocator.For(640, 480)));
+	EXPECT_EQ(0u, pool.GetInUseCount());
+	allocator.Fail = false;
+	EXPECT_TRUE(pool.Acquire(640, 480, sample, generation, allocator.For(640, 480)));
+}
+
+TEST(SamplePoolTest, DimensionChangeStartsANewGeneration)
+{
+	FakeAllocator allocator;
+	{
+		SamplePool<FakeSampleRef> pool(2);
+		FakeSampleRef vga, spare, cif;
+		unsigned int vgaGeneration, spareGeneration, cifGeneration;
+		ASSERT_TRUE(pool.Acquire(640, 480, vga, vgaGeneration, allocator.For(640, 480)));
+		ASSERT_TRUE(pool.Acquire(640, 480, spare, spareGeneration, allocator.For(640, 480)));
+		ASSERT_TRUE(pool.Recycle(spare, spareGeneration));
+		spare.reset();
+
+		// The free sample of the old dimensions is dropped, and so is the one in use when it comes back.
+		ASSERT_TRUE(pool.Acquire(352, 288, cif, cifGeneration, allocator.For(352, 288)));
+		EXPECT_NE(vgaGeneration, cifGeneration);
+		EXPECT_EQ(352, cif->Width);
+		EXPECT_EQ(0u, pool.GetFreeCount());
+		EXPECT_EQ(2, allocator.Alive.load());
+		EXPECT_FALSE(pool.Recycle(vga, vgaGeneration));
+		vga.reset();
+		EXPECT_EQ(1, allocator.Alive.load());
+		EXPECT_EQ(1u, pool.GetInUseCount());
+
+		EXPECT_TRUE(pool.Recycle(cif, cifGeneration));
+		cif.reset();
+		EXPECT_EQ(1u, pool.GetFreeCount());
+		EXPECT_EQ(1, allocator.Alive.load());
+	}
+	EXPECT_EQ(0, allocator.Alive.load());
+}
+
+TEST(SamplePoolTest, ResetDropsFreeAndInUseSamples)
+{
+	FakeAllocator allocator;
+	SamplePool<FakeSampleRef> pool(2);
+	FakeSampleRef inUse, free;
+	unsigned int inUseGeneration, freeGeneration;
+	ASSERT_TRUE(pool.Acquire(640, 480, inUse, inUseGeneration, allocator.For(640, 480)));
+	ASSERT_TRUE(pool.Acquire(640, 480, free, freeGeneration, allocator.For(640, 480)));
+	ASSERT_TRUE(pool.Recycle(free, freeGeneration));
+	free.reset();
+
+	pool.Reset();
+	EXPECT_EQ(0u, pool.GetFreeCount());
+	EXPECT_EQ(0u, pool.GetInUseCount());
+	EXPECT_EQ(1, allocator.Alive.load());
+	EXPECT_FALSE(pool.Recycle(inUse, inUseGeneration));
+
+	// The same dimensions after a reset make new samples.
+	FakeSampleRef next;
+	unsigned int nextGeneration;
+	ASSERT_TRUE(pool.Acquire(640, 480, next, nextGeneration, allocator.For(640, 480)));
+	EXPECT_NE(inUse, next);
+	EXPECT_EQ(3, allocator.Created.load());
+}
+
+TEST(SamplePoolTest, ConcurrentRenderersStayWithinCapacity)
+{
+	FakeAllocator allocator;
+	SamplePool<FakeSampleRef> pool(4);
+	std::atomic<int> refused(0);
+	std::vector<std::thread> renderers;
+	for (int t = 0; t < 3; t++) {
+		renderers.emplace_back([&]() {
+			for (int i = 0; i < 2000; i++) {
+				FakeSampleRef sample;
+				unsigned int generation;
+				if (!pool.Acquire(640, 480, sample, generation, allocator.For(640, 480))) {
+					refused++;
+					continue;
+				}
+				EXPECT_LE(pool.GetInUseCount(), 4u);
+				EXPECT_TRUE(pool.Recycle(sample, generation));
+			}
+		});
+	}
+	for (std::thread &renderer : renderers) renderer.join();
+	EXPECT_LE(allocator.Created.load(), 4);
+	EXPECT_EQ(0u, pool.GetInUseCount());
+	EXPECT_EQ(0, refused.load());
+}
@@ -0,0 +1,63 @@
+/*
+SliceWorkerPoolBenchmark.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "YuvConverter.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+TEST(SliceWorkerPoolBenchmark, ConversionScalingWithTheThreadCount)
+{
+	const int w = 1920;
+	const int h = 1080;
+	const int iterations = 50;
+	std::vector<uint8_t> src = RandomBytes(w * h * 3 / 2);
+	std::vector<uint8_t> expected(w * h * 3 / 2);
+	ReferenceNV12ToI420Rotate(src.data(), w, src.data() + w * h, w, expected.data(), w, h, 0);
+	// Each slice is converted in one piece by the thread that takes it.
+	ParallelThreshold parallel(ParallelThreshold::Never);
+
+	printf("1080p NV12 to I420 by slices of 16 rows, %u hardware threads\n", std::thread::hardware_concurrency());
+	double singleMs = 0;
+	for (int threads : { 1, 2, 4, 8 }) {
+		SliceWorkerPool pool(threads);
+		std::vector<uint8_t> dst(w * h * 3 / 2);
+		uint8_t *dstU = dst.data() + w * h;
+		uint8_t *dstV = dstU + (w / 2) * (h / 2);
+		double ms = MeasureMs(iterations, [&]() {
+			pool.Run(h, 16, [&](int first, int last) {
+				YuvConverter::NV12ToI420Rotate(src.data() + first * w, w, src.data() + w * h + (first / 2) * w, w,
+					dst.data() + first * w, w, dstU + (first / 2) * (w / 2), w / 2, dstV + (first / 2) * (w / 2), w / 2, w, last - first, 0);
+			});
+		});
+		if (threads == 1) singleMs = ms;
+		printf("  %d threads: %6.3f ms per frame, x%.2f\n", threads, ms, singleMs / ms);
+		EXPECT_EQ(expected, dst) << threads << " threads";
+	}
+}
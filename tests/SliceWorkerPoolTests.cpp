@@ -0,0 +1,108 @@
+/*
+SliceWorkerPoolTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "SliceWorkerPool.h"
+
+using namespace libmswinrtvid;
+
+
+TEST(SliceWorkerPoolTest, ThreadCountIsBounded)
+{
+	EXPECT_EQ(1, SliceWorkerPool(0).GetThreadCount());
+	EXPECT_EQ(1, SliceWorkerPool(1).GetThreadCount());
+	EXPECT_EQ(4, SliceWorkerPool(4).GetThreadCount());
+	const int maxThreads = SliceWorkerPool::MaxThreads;
+	EXPECT_EQ(maxThreads, SliceWorkerPool(maxThreads + 8).GetThreadCount());
+	int shared = SliceWorkerPool::GetInstance()->GetThreadCount();
+	EXPECT_GE(shared, 1);
+	EXPECT_LE(shared, maxThreads);
+}
+
+TEST(SliceWorkerPoolTest, SlicesCoverEachRowOnceOnGranularityBoundaries)
+{
+	for (int threads : { 1, 2, 4, 8 }) {
+		SliceWorkerPool pool(threads);
+		for (int count : { 1, 15, 16, 17, 100, 720, 1081 }) {
+			for (int granularity : { 1, 2, 16 }) {
+				std::vector<std::atomic<int>> visits(count);
+				for (std::atomic<int> &v : visits) v = 0;
+				std::atomic<bool> misaligned(false);
+				pool.Run(count, granularity, [&](int first, int last) {
+					if ((first % granularity) != 0) misaligned = true;
+					for (int i = first; i < last; i++) visits[i]++;
+				});
+				for (int i = 0; i < count; i++) {
+					ASSERT_EQ(1, visits[i].load()) << threads << " threads, row " << i << " of " << count << ", granularity " << granularity;
+				}
+				EXPECT_FALSE(misaligned.load());
+			}
+		}
+	}
+}
+
+TEST(SliceWorkerPoolTest, RunReturnsOnceEverySliceHasCompleted)
+{
+	SliceWorkerPool pool(4);
+	for (int frame = 0; frame < 20; frame++) {
+		std::atomic<int> completed(0);
+		pool.Run(64, 16, [&](int first, int last) {
+			// The last slices take longer than the one of the calling thread.
+			if (first > 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			completed += last - first;
+		});
+		ASSERT_EQ(64, completed.load()) << "frame " << frame;
+	}
+}
+
+TEST(SliceWorkerPoolTest, BusyPoolRunsTheJobOnTheCallingThread)
+{
+	SliceWorkerPool pool(2);
+	std::atomic<bool> inFirstJob(false);
+	std::atomic<bool> release(false);
+	std::thread first([&]() {
+		pool.Run(2, 1, [&](int, int) {
+			inFirstJob = true;
+			while (!release) std::this_thread::yield();
+		});
+	});
+	while (!inFirstJob) std::this_thread::yield();
+	// The pool is held by the first frame: the second one is converted in one piece by its caller.
+	std::thread::id caller = std::this_thread::get_id();
+	int calls = 0;
+	bool onCaller = true;
+	pool.Run(100, 1, [&](int f, int l) {
+		calls++;
+		onCaller = onCaller && (std::this_thread::get_id() == caller) && (f == 0) && (l == 100);
+	});
+	release = true;
+	first.join();
+	EXPECT_EQ(1, calls);
+	EXPECT_TRUE(onCaller);
+}
@@ -0,0 +1,174 @@
+/*
+SpscRingTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "SpscRing.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	struct Frame
+	{
+		long Sequence;
+	};
+
+	std::atomic<long> sLiveFrames(0);
+	std::atomic<long> sDisposedFrames(0);
+
+	Frame * NewFrame(long sequence)
+	{
+		sLiveFrames++;
+		return new Frame{ sequence };
+	}
+
+	void DeleteFrame(Frame *frame)
+	{
+		sLiveFrames--;
+		delete frame;
+	}
+
+	void DisposeFrame(Frame *frame)
+	{
+		sDisposedFrames++;
+		DeleteFrame(frame);
+	}
+
+	typedef SpscRing<Frame *> FrameRing;
+}
+
+
+// Run with -DENABLE_TSAN=YES to have the thread sanitizer check the memory orders of the ring.
+TEST(SpscRingTest, ProducerAndConsumerStress)
+{
+	for (int policy : { FrameRing::DropOldest, FrameRing::DropNewest, FrameRing::Block }) {
+		for (size_t depth : { 1, 2, 4, 16 }) {
+			FrameRing ring(16, DisposeFrame);
+			ring.SetDepth(depth);
+			ring.SetOverflowPolicy((FrameRing::OverflowPolicy)policy);
+			sLiveFrames = 0;
+			sDisposedFrames = 0;
+			const long count = (policy == FrameRing::Block) ? 5000 : 50000;
+			std::atomic<bool> done(false);
+			long received = 0;
+			long outOfOrder = 0;
+
+			std::thread producer([&]() {
+				for (long i = 0; i < count; i++) {
+					ring.Push(NewFrame(i));
+					// The depth is changed while the ring is in use, as the display does when its latency target moves.
+					if ((i & 1023) == 0) ring.SetDepth(((i & 2048) || (depth == 1)) ? depth : (depth / 2));
+				}
+				done = true;
+			});
+			std::thread consumer([&]() {
+				long last = -1;
+				Frame *frame;
+				while (true) {
+					if (ring.Pop(frame)) {
+						if (frame->Sequence <= last) outOfOrder++;
+						last = frame->Sequence;
+						received++;
+						DeleteFrame(frame);
+					} else if (done) {
+						break;
+					} else {
+						std::this_thread::yield();
+					}
+				}
+			});
+			producer.join();
+			consumer.join();
+			Frame *frame;
+			while (ring.Pop(frame)) {
+				received++;
+				DeleteFrame(frame);
+			}
+
+			EXPECT_EQ(0, outOfOrder) << "policy " << policy << " depth " << depth;
+			EXPECT_EQ(count, received + (long)ring.GetDroppedCount()) << "policy " << policy << " depth " << depth;
+			EXPECT_EQ(sDisposedFrames.load(), (long)ring.GetDroppedCount());
+			EXPECT_EQ(0, sLiveFrames.load());
+			if (policy == FrameRing::Block) {
+				EXPECT_EQ(0u, ring.GetDroppedCount());
+			}
+		}
+	}
+}
+
+TEST(SpscRingTest, DropOldestKeepsTheNewestFrames)
+{
+	sLiveFrames = 0;
+	FrameRing ring(4, DisposeFrame);
+	for (long i = 0; i < 10; i++) EXPECT_TRUE(ring.Push(NewFrame(i)));
+	EXPECT_EQ(6u, ring.GetDroppedCount());
+	Frame *frame;
+	for (long i = 6; i < 10; i++) {
+		ASSERT_TRUE(ring.Pop(frame));
+		EXPECT_EQ(i, frame->Sequence);
+		DeleteFrame(frame);
+	}
+	EXPECT_TRUE(ring.IsEmpty());
+	EXPECT_EQ(0, sLiveFrames.load());
+}
+
+TEST(SpscRingTest, DropNewestKeepsTheOldestFrames)
+{
+	sLiveFrames = 0;
+	FrameRing ring(4, DisposeFrame);
+	ring.SetDepth(2);
+	ring.SetOverflowPolicy(FrameRing::DropNewest);
+	EXPECT_TRUE(ring.Push(NewFrame(0)));
+	EXPECT_TRUE(ring.Push(NewFrame(1)));
+	EXPECT_FALSE(ring.Push(NewFrame(2)));
+	Frame *frame;
+	ASSERT_TRUE(ring.Pop(frame));
+	EXPECT_EQ(0, frame->Sequence);
+	DeleteFrame(frame);
+	ring.Clear();
+	EXPECT_EQ(0, sLiveFrames.load());
+	EXPECT_EQ(1u, ring.GetDroppedCount());
+}
+
+TEST(SpscRingTest, CloseReleasesABlockedProducer)
+{
+	sLiveFrames = 0;
+	FrameRing ring(2, DisposeFrame);
+	ring.SetOverflowPolicy(FrameRing::Block);
+	ring.Push(NewFrame(0));
+	ring.Push(NewFrame(1));
+	std::atomic<bool> pushed(true);
+	std::thread producer([&]() { pushed = ring.Push(NewFrame(2)); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	ring.Close();
+	producer.join();
+	EXPECT_FALSE(pushed.load());
+	ring.Clear();
+	EXPECT_EQ(0, sLiveFrames.load());
+}
@@ -0,0 +1,292 @@
+/*
+StreamSinkDeliveryTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FakeWorkQueue.h"
+#include "RingQueue.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	/// A sample or a marker, numbered in the order the stream received them.
+	struct Item
+	{
+		Item() : Marker(false), Number(0) {}
+		Item(bool marker, int number) : Marker(marker), Number(number) {}
+
+		bool operator==(const Item &other) const { return (Marker == other.Marker) && (Number == other.Number); }
+
+		bool Marker;
+		int Number;
+	};
+
+	void PrintTo(const Item &item, std::ostream *os)
+	{
+		*os << (item.Marker ? "M" : "S") << item.Number;
+	}
+
+	/// <summary>
+	/// The delivery of MSWinRTStreamSink without Media Foundation: the work item moves the samples and markers from the
+	/// sample queue to the ready queue under the stream lock, then converts the samples outside of it, the markers being
+	/// sent once the samples before them have been converted. A flush waits for the conversion in progress, then drops
+	/// the ready samples and sends the markers, of the ready queue first. The events, a converted sample or a sent marker, are logged in the order they happen.
+	/// </summary>
+	class FakeDeliverySink
+	{
+	public:
+		FakeDeliverySink(FakeWorkQueue &workQueue) : mWorkQueue(workQueue), mSampleQueue(8), mReadyQueue(8), mCaptureShutdown(false) {}
+
+		/// The conversion of a sample, called without the stream lock: returns false for a failure.
+		std::function<bool(const Item &)> OnPrepareSample;
+
+		void ProcessItem(const Item &item)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mCritSec);
+				mSampleQueue.PushBack(item);
+			}
+			mWorkQueue.Put(&FakeDeliverySink::OnDispatchWorkItem, this, nullptr);
+		}
+
+		/// Waits for the conversion in progress, the locks being taken in the order of Shutdown.
+		void Flush()
+		{
+			std::lock_guard<std::mutex> lock(mCritSec);
+			std::lock_guard<std::mutex> captureLock(mCaptureCritSec);
+			ProcessSamplesFromQueue(true);
+		}
+
+		/// The first half of the work item, without the delivery.
+		void Dispatch()
+		{
+			std::lock_guard<std::mutex> lock(mCritSec);
+			ProcessSamplesFromQueue(false);
+		}
+
+		void DeliverReadySamples()
+		{
+			for (;;) {
+				Item sample;
+				mCritSec.lock();
+				bool found = TakeReadySample(sample);
+				mCritSec.unlock();
+				if (!found) break;
+				std::lock_guard<std::mutex> captureLock(mCaptureCritSec);
+				if (mCaptureShutdown) continue;
+				bool prepared = OnPrepareSample ? OnPrepareSample(sample) : true;
+				if (prepared) Log(sample);
+				else break;
+			}
+		}
+
+		/// Queue an item without a work item, as ProcessSample does while the stream is paused.
+		void QueueItem(const Item &item)
+		{
+			std::lock_guard<std::mutex> lock(mCritSec);
+			mSampleQueue.PushBack(item);
+		}
+
+		size_t GetReadyCount()
+		{
+			std::lock_guard<std::mutex> lock(mCritSec);
+			return mReadyQueue.GetCount();
+		}
+
+		std::vector<Item> GetEvents()
+		{
+			std::lock_guard<std::mutex> lock(mLogMutex);
+			return mEvents;
+		}
+
+	private:
+		static void OnDispatchWorkItem(void *context, void *)
+		{
+			FakeDeliverySink *sink = static_cast<FakeDeliverySink *>(context);
+			sink->Dispatch();
+			sink->DeliverReadySamples();
+		}
+
+		// Called with mCritSec held.
+		void ProcessSamplesFromQueue(bool flush)
+		{
+			if (flush) {
+				Item dropped;
+				while (TakeReadySample(dropped)) {}
+			}
+			Item item;
+			while (mSampleQueue.PopFront(item)) {
+				if (!item.Marker) {
+					if (!flush) mReadyQueue.PushBack(item);
+				} else if (flush) {
+					Log(item);
+				} else {
+					mReadyQueue.PushBack(item);
+				}
+			}
+		}
+
+		// Called with mCritSec held.
+		bool TakeReadySample(Item &sample)
+		{
+			Item item;
+			while (mReadyQueue.PopFront(item)) {
+				if (!item.Marker) {
+					sample = item;
+					return true;
+				}
+				Log(item);
+			}
+			return false;
+		}
+
+		void Log(const Item &item)
+		{
+			std::lock_guard<std::mutex> lock(mLogMutex);
+			mEvents.push_back(item);
+		}
+
+		FakeWorkQueue &mWorkQueue;
+		std::mutex mCritSec;
+		std::mutex mCaptureCritSec;
+		std::mutex mLogMutex;
+		RingQueue<Item> mSampleQueue;
+		RingQueue<Item> mReadyQueue;
+		bool mCaptureShutdown;
+		std::vector<Item> mEvents;
+	};
+
+	/// Items 1 to count, every third one a marker.
+	std::vector<Item> Stream(int count)
+	{
+		std::vector<Item> items;
+		for (int i = 1; i <= count; i++) items.push_back(Item((i % 3) == 0, i));
+		return items;
+	}
+}
+
+
+TEST(StreamSinkDeliveryTest, MarkersAreSentAfterTheSamplesQueuedBeforeThem)
+{
+	FakeWorkQueue workQueue(4096);
+	FakeDeliverySink sink(workQueue);
+	std::vector<Item> items = Stream(3000);
+	for (const Item &item : items) sink.ProcessItem(item);
+	workQueue.Flush();
+	EXPECT_EQ(items, sink.GetEvents());
+}
+
+TEST(StreamSinkDeliveryTest, FlushSendsTheReadyMarkersFirst)
+{
+	FakeWorkQueue workQueue(16);
+	FakeDeliverySink sink(workQueue);
+	// S1 M2 S3 M4 are handed over to the delivery, S5 M6 are still in the sample queue when the flush comes.
+	sink.QueueItem(Item(false, 1));
+	sink.QueueItem(Item(true, 2));
+	sink.QueueItem(Item(false, 3));
+	sink.QueueItem(Item(true, 4));
+	sink.Dispatch();
+	sink.QueueItem(Item(false, 5));
+	sink.QueueItem(Item(true, 6));
+	sink.Flush();
+	EXPECT_EQ((std::vector<Item>{ Item(true, 2), Item(true, 4), Item(true, 6) }), sink.GetEvents());
+	EXPECT_EQ(0u, sink.GetReadyCount());
+	sink.DeliverReadySamples();
+	EXPECT_EQ(3u, sink.GetEvents().size());
+}
+
+TEST(StreamSinkDeliveryTest, FlushDuringAConversionKeepsTheMarkerOrder)
+{
+	FakeWorkQueue workQueue(16);
+	FakeDeliverySink sink(workQueue);
+	for (int i = 1; i <= 4; i++) sink.QueueItem(Item((i % 2) == 0, i));
+	sink.Dispatch();
+	sink.QueueItem(Item(false, 5));
+	sink.QueueItem(Item(true, 6));
+	// The flush comes while S1 is converted, the stream lock being released meanwhile: M2 is not sent before S1.
+	std::thread flusher;
+	sink.OnPrepareSample = [&](const Item &) {
+		if (!flusher.joinable()) {
+			flusher = std::thread([&]() { sink.Flush(); });
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		return true;
+	};
+	sink.DeliverReadySamples();
+	flusher.join();
+	EXPECT_EQ((std::vector<Item>{ Item(false, 1), Item(true, 2), Item(true, 4), Item(true, 6) }), sink.GetEvents());
+}
+
+TEST(StreamSinkDeliveryTest, ConcurrentFlushesKeepTheOrderOfTheEvents)
+{
+	FakeWorkQueue workQueue(8192);
+	FakeDeliverySink sink(workQueue);
+	std::vector<Item> items = Stream(6000);
+	std::atomic<bool> done(false);
+	std::thread flusher([&]() {
+		while (!done) {
+			sink.Flush();
+			std::this_thread::yield();
+		}
+	});
+	for (const Item &item : items) sink.ProcessItem(item);
+	workQueue.Flush();
+	done = true;
+	flusher.join();
+
+	// Samples may be dropped, but every marker is sent once, and all the events are in the order of the stream.
+	std::vector<Item> events = sink.GetEvents();
+	int markers = 0;
+	for (size_t i = 0; i < events.size(); i++) {
+		if (events[i].Marker) markers++;
+		if (i > 0) {
+			ASSERT_LT(events[i - 1].Number, events[i].Number) << "event " << i;
+		}
+	}
+	EXPECT_EQ(2000, markers);
+}
+
+TEST(StreamSinkDeliveryTest, FailedConversionStopsTheDelivery)
+{
+	FakeWorkQueue workQueue(16);
+	FakeDeliverySink sink(workQueue);
+	for (int i = 1; i <= 6; i++) sink.QueueItem(Item((i % 3) == 0, i));
+	sink.Dispatch();
+	sink.OnPrepareSample = [](const Item &sample) { return sample.Number != 2; };
+	sink.DeliverReadySamples();
+	// S2 fails: M3 and the items behind it wait for the next work item.
+	EXPECT_EQ((std::vector<Item>{ Item(false, 1) }), sink.GetEvents());
+	EXPECT_EQ(4u, sink.GetReadyCount());
+	sink.DeliverReadySamples();
+	EXPECT_EQ((std::vector<Item>{ Item(false, 1), Item(true, 3), Item(false, 4), Item(false, 5), Item(true, 6) }), sink.GetEvents());
+}
@@ -0,0 +1,126 @@
+/*
+StreamSinkDispatchBenchmark.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "CoalescingDispatcher.h"
+#include "FakeWorkQueue.h"
+#include "RingQueue.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	/// Sample queue of a stream sink drained from a serial work queue, either by one work item per sample as
+	/// before, or by the single pending work item of a CoalescingDispatcher.
+	class SampleDrain
+	{
+	public:
+		SampleDrain(FakeWorkQueue &workQueue, bool coalesce)
+			: mWorkQueue(workQueue), mCoalesce(coalesce), mQueue(1024), mDispatcher([this]() { return Post(); }), mWorkItems(0), mSamples(0) {}
+
+		void ProcessSample(int sample)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mQueue.PushBack(sample);
+			}
+			if (mCoalesce) mDispatcher.Schedule();
+			else Post();
+		}
+
+		int GetWorkItemCount() const { return mWorkItems; }
+		int GetSampleCount() const { return mSamples; }
+
+	private:
+		bool Post()
+		{
+			return mWorkQueue.Put(&SampleDrain::OnDispatchWorkItem, this, nullptr);
+		}
+
+		static void OnDispatchWorkItem(void *context, void *)
+		{
+			static_cast<SampleDrain *>(context)->Dispatch();
+		}
+
+		void Dispatch()
+		{
+			mWorkItems++;
+			std::lock_guard<std::mutex> lock(mMutex);
+			int sample;
+			if (!mCoalesce) {
+				if (mQueue.PopFront(sample)) mSamples++;
+				return;
+			}
+			mDispatcher.BeginDrain();
+			while (mQueue.PopFront(sample)) mSamples++;
+		}
+
+		FakeWorkQueue &mWorkQueue;
+		bool mCoalesce;
+		std::mutex mMutex;
+		RingQueue<int> mQueue;
+		CoalescingDispatcher mDispatcher;
+		std::atomic<int> mWorkItems;
+		int mSamples;
+	};
+}
+
+
+TEST(StreamSinkDispatchBenchmark, CoalescedDrainAgainstWorkItemPerSample)
+{
+	printf("Camera bursts drained from a serial work queue, one work item per sample against a coalesced drain\n");
+	const int samples = 60000;
+	for (int burst : { 1, 4, 16 }) {
+		int workItems[2];
+		uint64_t wakes[2];
+		double ns[2];
+		for (int coalesce = 0; coalesce < 2; coalesce++) {
+			FakeWorkQueue workQueue(samples + 1);
+			SampleDrain drain(workQueue, coalesce != 0);
+			double ms = MeasureMs(1, [&]() {
+				for (int i = 0; i < samples; i += burst) {
+					for (int j = 0; j < burst; j++) drain.ProcessSample(i + j);
+					// The camera delivers the next burst a bit later.
+					std::this_thread::yield();
+				}
+				workQueue.Flush();
+			});
+			EXPECT_EQ(samples, drain.GetSampleCount());
+			workItems[coalesce] = drain.GetWorkItemCount();
+			wakes[coalesce] = workQueue.GetWakeCount();
+			ns[coalesce] = (ms * 1000000.0) / samples;
+		}
+		printf("  bursts of %2d: per sample %5d work items, %5llu wake-ups, %6.0f ns/sample; coalesced %5d work items, %5llu wake-ups, %6.0f ns/sample\n",
+			burst, workItems[0], (unsigned long long)wakes[0], ns[0], workItems[1], (unsigned long long)wakes[1], ns[1]);
+		EXPECT_EQ(samples, workItems[0]);
+		EXPECT_LE(workItems[1], workItems[0]);
+	}
+}
@@ -0,0 +1,236 @@
+/*
+StreamSinkDispatchTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CoalescingDispatcher.h"
+#include "FakeWorkQueue.h"
+#include "RingQueue.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	/// <summary>
+	/// The work item dispatch of MSWinRTStreamSink without Media Foundation: one stateless operation object per
+	/// StreamOperation, holding a reference on the stream while a work item carries it, and the samples and markers
+	/// drained from the sample queue by the single pending work item of a CoalescingDispatcher.
+	/// </summary>
+	class FakeStreamSink
+	{
+	public:
+		enum StreamOperation { OpStart, OpPause, OpProcessSample, Op_Count };
+
+		/// Stand-in for MSWinRTAsyncOperation: its reference count is the one of the stream.
+		class AsyncOperation
+		{
+		public:
+			AsyncOperation() : m_op(OpStart), m_pParent(nullptr) {}
+
+			void Initialize(FakeStreamSink *pParent, StreamOperation op)
+			{
+				m_pParent = pParent;
+				m_op = op;
+			}
+
+			long AddRef() { return m_pParent->AddRef(); }
+			long Release() { return m_pParent->Release(); }
+
+			StreamOperation m_op;
+
+		private:
+			FakeStreamSink *m_pParent;
+		};
+
+		FakeStreamSink(FakeWorkQueue &workQueue, size_t queueCapacity)
+			: mRefs(1), mWorkQueue(workQueue), mSampleQueue(queueCapacity), mDispatcher([this]() { return QueueAsyncOperation(OpProcessSample); }),
+			mSamples(0), mMarkers(0), mOutOfOrder(0), mInFlight(0), mMaxInFlight(0)
+		{
+			for (int op = 0; op < Op_Count; op++) mAsyncOperations[op].Initialize(this, (StreamOperation)op);
+			for (int op = 0; op < Op_Count; op++) mDispatched[op] = 0;
+		}
+
+		long AddRef() { return ++mRefs; }
+		long Release() { return --mRefs; }
+		long GetRefCount() const { return mRefs; }
+
+		/// A positive item is a sample, a negative one a marker. Each producer numbers its items.
+		void ProcessItem(int producer, int item)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mSampleQueue.PushBack(QueuedItem(producer, item));
+			}
+			mDispatcher.Schedule();
+		}
+
+		bool QueueAsyncOperation(StreamOperation op)
+		{
+			// The work item holds a reference on the stream until it is dispatched, as MFPutWorkItem2 does on its state.
+			AsyncOperation *pOp = &mAsyncOperations[op];
+			pOp->AddRef();
+			int inFlight = ++mInFlight;
+			int max = mMaxInFlight;
+			while ((inFlight > max) && !mMaxInFlight.compare_exchange_weak(max, inFlight)) {}
+			if (!mWorkQueue.Put(&FakeStreamSink::OnDispatchWorkItem, this, pOp)) {
+				mInFlight--;
+				pOp->Release();
+				return false;
+			}
+			return true;
+		}
+
+		uint64_t GetDispatchedCount(StreamOperation op) const { return mDispatched[op]; }
+		int GetSampleCount() const { return mSamples; }
+		int GetMarkerCount() const { return mMarkers; }
+		int GetOutOfOrderCount() const { return mOutOfOrder; }
+		int GetMaxInFlight() const { return mMaxInFlight; }
+		const CoalescingDispatcher & GetDispatcher() const { return mDispatcher; }
+
+		static const int MaxProducers = 8;
+
+	private:
+		struct QueuedItem
+		{
+			QueuedItem() : Producer(0), Item(0) {}
+			QueuedItem(int producer, int item) : Producer(producer), Item(item) {}
+
+			int Producer;
+			int Item;
+		};
+
+		static void OnDispatchWorkItem(void *context, void *state)
+		{
+			FakeStreamSink *stream = static_cast<FakeStreamSink *>(context);
+			AsyncOperation *pOp = static_cast<AsyncOperation *>(state);
+			stream->Dispatch(pOp->m_op);
+			stream->mInFlight--;
+			pOp->Release();
+		}
+
+		void Dispatch(StreamOperation op)
+		{
+			mDispatched[op]++;
+			if (op != OpProcessSample) return;
+			mDispatcher.BeginDrain();
+			std::lock_guard<std::mutex> lock(mMutex);
+			QueuedItem item;
+			while (mSampleQueue.PopFront(item)) {
+				int number = (item.Item < 0) ? -item.Item : item.Item;
+				if (number != (mLastItem[item.Producer] + 1)) mOutOfOrder++;
+				mLastItem[item.Producer] = number;
+				if (item.Item < 0) mMarkers++;
+				else mSamples++;
+			}
+		}
+
+		std::atomic<long> mRefs;
+		FakeWorkQueue &mWorkQueue;
+		AsyncOperation mAsyncOperations[Op_Count];
+		std::mutex mMutex;
+		RingQueue<QueuedItem> mSampleQueue;
+		CoalescingDispatcher mDispatcher;
+		std::atomic<uint64_t> mDispatched[Op_Count];
+		int mLastItem[MaxProducers] = {};
+		int mSamples;
+		int mMarkers;
+		int mOutOfOrder;
+		std::atomic<int> mInFlight;
+		std::atomic<int> mMaxInFlight;
+	};
+}
+
+
+TEST(StreamSinkDispatchTest, SustainedLoadDoesNotAllocate)
+{
+	const int producers = 4;
+	const int itemsPerProducer = 20000;
+	const int controls = 2000;
+	FakeWorkQueue workQueue(1 << 16);
+	FakeStreamSink stream(workQueue, producers * itemsPerProducer + 1);
+
+	std::atomic<bool> go(false);
+	std::atomic<int> done(0);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p]() {
+			while (!go) std::this_thread::yield();
+			// Every tenth item is a marker, placed in the sample queue between the samples.
+			for (int i = 1; i <= itemsPerProducer; i++) stream.ProcessItem(p, ((i % 10) == 0) ? -i : i);
+			done++;
+		});
+	}
+	// State changes queue work items of the same operation while others of this operation are still in flight.
+	threads.emplace_back([&]() {
+		while (!go) std::this_thread::yield();
+		for (int i = 0; i < controls; i++) {
+			EXPECT_TRUE(stream.QueueAsyncOperation(FakeStreamSink::OpStart));
+			EXPECT_TRUE(stream.QueueAsyncOperation(FakeStreamSink::OpPause));
+		}
+		done++;
+	});
+
+	// The threads and the queues are set up: from now on, queueing and dispatching must not allocate.
+	long allocations = GetHeapAllocationCount();
+	go = true;
+	while (done < (producers + 1)) std::this_thread::yield();
+	workQueue.Flush();
+	EXPECT_EQ(allocations, GetHeapAllocationCount());
+	for (std::thread &thread : threads) thread.join();
+
+	EXPECT_EQ(producers * itemsPerProducer * 9 / 10, stream.GetSampleCount());
+	EXPECT_EQ(producers * itemsPerProducer / 10, stream.GetMarkerCount());
+	EXPECT_EQ(0, stream.GetOutOfOrderCount());
+	EXPECT_EQ((uint64_t)controls, stream.GetDispatchedCount(FakeStreamSink::OpStart));
+	EXPECT_EQ((uint64_t)controls, stream.GetDispatchedCount(FakeStreamSink::OpPause));
+	EXPECT_EQ(stream.GetDispatcher().GetPostCount(), stream.GetDispatchedCount(FakeStreamSink::OpProcessSample));
+	EXPECT_GT(stream.GetMaxInFlight(), 1);
+	// Every work item has given back the reference it held on the stream.
+	EXPECT_EQ(1, stream.GetRefCount());
+	printf("%d items in %llu work items, %d work items in flight at most\n", producers * itemsPerProducer,
+		(unsigned long long)stream.GetDispatchedCount(FakeStreamSink::OpProcessSample), stream.GetMaxInFlight());
+}
+
+TEST(StreamSinkDispatchTest, ItemPushedWhileDrainingGetsAWorkItem)
+{
+	FakeWorkQueue workQueue(64);
+	FakeStreamSink stream(workQueue, 64);
+	for (int i = 1; i <= 20; i++) {
+		stream.ProcessItem(0, i);
+		// Let the queue thread drain some of them while the others are pushed.
+		if ((i % 3) == 0) std::this_thread::yield();
+	}
+	workQueue.Flush();
+	EXPECT_EQ(20, stream.GetSampleCount());
+	EXPECT_EQ(0, stream.GetOutOfOrderCount());
+	EXPECT_FALSE(stream.GetDispatcher().IsPending());
+	EXPECT_EQ(1, stream.GetRefCount());
+}
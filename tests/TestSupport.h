@@ -0,0 +1,231 @@
+/*
+TestSupport.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "SliceWorkerPool.h"
+#include "YuvConverter.h"
+
+
+namespace libmswinrtvid
+{
+	namespace test
+	{
+		/// Number of operator new calls since the start of the tester, counted by HeapAllocationCounter.cpp.
+		long GetHeapAllocationCount();
+
+		/// Picture bytes filled with a deterministic noise, so that every sample of a conversion is checked.
+		inline std::vector<uint8_t> RandomBytes(size_t size, unsigned int seed = 1)
+		{
+			std::vector<uint8_t> bytes(size);
+			std::mt19937 generator(seed);
+			for (size_t i = 0; i < size; i++) bytes[i] = (uint8_t)generator();
+			return bytes;
+		}
+
+		/// Average time in ms of a call of fn, over iterations calls.
+		template <class FN>
+		double MeasureMs(int iterations, FN fn)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++) fn();
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+		}
+
+		/// Sets the SliceWorkerPool parallel threshold for the lifetime of the object, so that a test can force the
+		/// conversions to be sliced, or not, whatever the frame size.
+		class ParallelThreshold
+		{
+		public:
+			static const int Never = 1 << 30;
+			static const int Always = 1;
+
+			ParallelThreshold(int pixels) : mPrevious(SliceWorkerPool::GetParallelThreshold()) { SliceWorkerPool::SetParallelThreshold(pixels); }
+			~ParallelThreshold() { SliceWorkerPool::SetParallelThreshold(mPrevious); }
+
+		private:
+			int mPrevious;
+		};
+
+		/// The conversion done by the display filter before the SIMD kernels: a plain copy of the luma and an
+		/// interleave of the chroma one sample at a time, for a contiguous I420 picture.
+		inline void ReferenceI420ToNV12(const uint8_t *src, uint8_t *dst, int width, int height)
+		{
+			int ysize = width * height;
+			int usize = ysize / 4;
+			memcpy(dst, src, ysize);
+			for (int i = 0; i < usize; i++) {
+				dst[ysize + (i * 2)] = src[ysize + i];
+				dst[ysize + (i * 2) + 1] = src[ysize + usize + i];
+			}
+		}
+
+		/// Sample of the destination picture at (x, y) when a plane is rotated clockwise by rotation degrees then, with
+		/// mirror, flipped horizontally. width and height are the dimensions of the destination plane. step is the
+		/// distance between two samples of a source row, 2 for a plane of a semi-planar chroma.
+		inline uint8_t RotatedSample(const uint8_t *src, int srcStride, int step, int x, int y, int width, int height, int rotation, bool mirror)
+		{
+			if (mirror) x = width - 1 - x;
+			switch (rotation) {
+			case 90: return src[(width - 1 - x) * srcStride + y * step];
+			case 180: return src[(height - 1 - y) * srcStride + (width - 1 - x) * step];
+			case 270: return src[x * srcStride + (height - 1 - y) * step];
+			default: return src[y * srcStride + x * step];
+			}
+		}
+
+		/// Per-sample NV12 to I420 rotation, in the way of the mediastreamer2 picture helpers, into a contiguous
+		/// width x height I420 picture.
+		inline void ReferenceNV12ToI420Rotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+			uint8_t *dst, int width, int height, int rotation, bool mirror = false)
+		{
+			int cw = width / 2;
+			int ch = height / 2;
+			uint8_t *dstU = dst + width * height;
+			uint8_t *dstV = dstU + cw * ch;
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					dst[y * width + x] = RotatedSample(srcY, srcYStride, 1, x, y, width, height, rotation, mirror);
+				}
+			}
+			for (int y = 0; y < ch; y++) {
+				for (int x = 0; x < cw; x++) {
+					dstU[y * cw + x] = RotatedSample(srcUV, srcUVStride, 2, x, y, cw, ch, rotation, mirror);
+					dstV[y * cw + x] = RotatedSample(srcUV + 1, srcUVStride, 2, x, y, cw, ch, rotation, mirror);
+				}
+			}
+		}
+
+		/// Source sample and 8-bit weight of the destination sample i when srcCount samples are scaled to dstCount, the
+		/// centers of the samples being aligned.
+		inline void ReferenceScaleTap(int i, int dstCount, int srcCount, int &index0, int &index1, int &weight)
+		{
+			int64_t pos = ((((int64_t)(2 * i + 1) * srcCount) << 16) / (2 * dstCount)) - 32768;
+			index0 = 0;
+			weight = 0;
+			if (pos > 0) {
+				index0 = (int)(pos >> 16);
+				weight = (int)((pos >> 8) & 0xFF);
+			}
+			index1 = ((index0 + 1) < srcCount) ? (index0 + 1) : (srcCount - 1);
+		}
+
+		/// Per-sample bilinear scaling of a srcWidth x srcHeight plane to a width x height plane rotated clockwise by rotation
+		/// degrees then, with mirror, flipped horizontally. step is the distance between two samples of a source row.
+		inline void ReferenceScaleRotatePlane(const uint8_t *src, int srcStride, int step, int srcWidth, int srcHeight,
+			uint8_t *dst, int dstStride, int width, int height, int rotation, bool mirror = false)
+		{
+			bool transpose = (rotation == 90) || (rotation == 270);
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					int rx = mirror ? (width - 1 - x) : x;
+					int ux = ((rotation == 90) || (rotation == 180)) ? (width - 1 - rx) : rx;
+					int uy = ((rotation == 180) || (rotation == 270)) ? (height - 1 - y) : y;
+					int row = transpose ? ux : uy;
+					int col = transpose ? uy : ux;
+					int r0, r1, wr, c0, c1, wc;
+					ReferenceScaleTap(row, transpose ? width : height, srcHeight, r0, r1, wr);
+					ReferenceScaleTap(col, transpose ? height : width, srcWidth, c0, c1, wc);
+					int top = src[r0 * srcStride + c0 * step] * (256 - wc) + src[r0 * srcStride + c1 * step] * wc;
+					int bottom = src[r1 * srcStride + c0 * step] * (256 - wc) + src[r1 * srcStride + c1 * step] * wc;
+					dst[y * dstStride + x] = (uint8_t)((top * (256 - wr) + bottom * wr + 32768) >> 16);
+				}
+			}
+		}
+
+		/// Per-sample NV12 to I420 scaling and rotation into a contiguous width x height I420 picture.
+		inline void ReferenceNV12ToI420ScaleRotate(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride,
+			int srcWidth, int srcHeight, uint8_t *dst, int width, int height, int rotation, bool mirror = false)
+		{
+			int cw = width / 2;
+			int ch = height / 2;
+			uint8_t *dstU = dst + width * height;
+			uint8_t *dstV = dstU + cw * ch;
+			ReferenceScaleRotatePlane(srcY, srcYStride, 1, srcWidth, srcHeight, dst, width, width, height, rotation, mirror);
+			ReferenceScaleRotatePlane(srcUV, srcUVStride, 2, srcWidth / 2, srcHeight / 2, dstU, cw, cw, ch, rotation, mirror);
+			ReferenceScaleRotatePlane(srcUV + 1, srcUVStride, 2, srcWidth / 2, srcHeight / 2, dstV, cw, cw, ch, rotation, mirror);
+		}
+
+		/// 2:1 box reduction of a plane into a width x height plane, in the way of a separate downscaling pass. step and
+		/// dstStep are the distances between two samples of a row.
+		inline void ReferenceHalvePlane(const uint8_t *src, int srcStride, int step, uint8_t *dst, int dstStride, int dstStep, int width, int height)
+		{
+			for (int y = 0; y < height; y++) {
+				const uint8_t *line0 = src + 2 * y * srcStride;
+				const uint8_t *line1 = line0 + srcStride;
+				for (int x = 0; x < width; x++) {
+					int sum = line0[2 * x * step] + line0[(2 * x + 1) * step] + line1[2 * x * step] + line1[(2 * x + 1) * step];
+					dst[y * dstStride + x * dstStep] = (uint8_t)((sum + 2) >> 2);
+				}
+			}
+		}
+
+		/// Contiguous I420 or NV12 picture, with the planes described for the YuvConverter.
+		struct PictureBuffer
+		{
+			PictureBuffer(int width, int height, bool nv12) : bytes(width * height + 2 * (width / 2) * (height / 2) + 2, 0)
+			{
+				uint8_t *y = bytes.data();
+				uint8_t *chroma = y + width * height;
+				planes = nv12 ? YuvConverter::NV12Planes(y, width, chroma, width & ~1, width, height)
+					: YuvConverter::I420Planes(y, width, chroma, width / 2, chroma + (width / 2) * (height / 2), width / 2, width, height);
+			}
+
+			std::vector<uint8_t> bytes;
+			YuvConverter::YuvPlanes planes;
+		};
+
+		/// Fills dst, half the size of src, the way a separate downscaling pass would.
+		inline void ReferenceHalvePicture(const YuvConverter::YuvPlanes &src, const YuvConverter::YuvPlanes &dst)
+		{
+			ReferenceHalvePlane(src.y, src.yStride, 1, dst.y, dst.yStride, 1, dst.width, dst.height);
+			ReferenceHalvePlane(src.u, src.uStride, src.uvStep, dst.u, dst.uStride, dst.uvStep, dst.width / 2, dst.height / 2);
+			ReferenceHalvePlane(src.v, src.vStride, src.uvStep, dst.v, dst.vStride, dst.uvStep, dst.width / 2, dst.height / 2);
+		}
+
+		/// Peak signal to noise ratio in dB of a width x height plane against expected values given by fn(x, y).
+		template <class FN>
+		double PlanePsnr(const uint8_t *plane, int stride, int width, int height, FN fn)
+		{
+			double mse = 0;
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					double d = plane[y * stride + x] - fn(x, y);
+					mse += d * d;
+				}
+			}
+			mse /= (double)width * height;
+			return (mse > 0) ? (10 * log10((255.0 * 255.0) / mse)) : 100.0;
+		}
+	}
+}
@@ -0,0 +1,194 @@
+/*
+TimelineMapperTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "TimelineMapper.h"
+
+using namespace libmswinrtvid;
+
+
+namespace
+{
+	const int64_t Ms = 10000;
+	// 30 fps at 90 kHz, and in 100 ns units.
+	const uint32_t FrameTicks = 3000;
+	const int64_t FrameInterval = 333333;
+
+	struct StreamCase
+	{
+		double fps;
+		// Drift of the sender clock against the local one.
+		double ppm;
+		// Mean of the exponential network jitter, on top of a 20 ms delay.
+		double jitterMs;
+		uint32_t firstTimestamp;
+	};
+
+	// Steady and jittered networks, drifting sender clocks, and a timestamp wrapping in the first seconds.
+	const StreamCase StreamCases[] = {
+		{ 30, 0, 0, 1000 }, { 30, 0, 5, 1000 }, { 30, 0, 20, 1000 },
+		{ 30, 100, 5, 1000 }, { 30, -100, 5, 1000 }, { 15, 0, 10, 0xFFFFFFFFu - 90000u * 10u }
+	};
+
+	struct Replay
+	{
+		double arrivalSd;
+		double presentedSd;
+		// Smallest arrival - presentation difference, in ms: a frame is not presented before it arrives.
+		double minLag;
+		unsigned int resyncs;
+	};
+
+	double IntervalSd(const std::vector<double> &times)
+	{
+		// Leave the first second, where the offset settles on the smallest delay, out.
+		double sum = 0, sum2 = 0;
+		int count = 0;
+		for (size_t i = 31; i < times.size(); i++) {
+			double interval = times[i] - times[i - 1];
+			sum += interval;
+			sum2 += interval * interval;
+			count++;
+		}
+		double mean = sum / count;
+		return std::sqrt(std::max(0.0, sum2 / count - mean * mean));
+	}
+
+	Replay ReplayStream(const StreamCase &c, int frames)
+	{
+		TimelineMapper mapper;
+		std::mt19937 rng(3);
+		std::exponential_distribution<double> jitter(c.jitterMs > 0 ? 1.0 / c.jitterMs : 1.0);
+		std::vector<double> arrivals, presented;
+		double lastArrival = 0;
+		int64_t lastOutput = INT64_MIN;
+		double minLag = 1e9;
+		for (int i = 0; i < frames; i++) {
+			double senderSec = i / c.fps;
+			uint32_t timestamp = c.firstTimestamp + (uint32_t)std::llround(senderSec * 90000);
+			double arrival = 5.0 + senderSec * (1 + c.ppm * 1e-6) + 0.020 + (c.jitterMs > 0 ? jitter(rng) / 1000.0 : 0);
+			// The frames are delivered in order.
+			arrival = std::max(arrival, lastArrival);
+			lastArrival = arrival;
+			int64_t output = mapper.Map(timestamp, (int64_t)(arrival * 1e7));
+			EXPECT_GT(output, lastOutput);
+			lastOutput = output;
+			arrivals.push_back(arrival * 1000);
+			presented.push_back((double)output / Ms);
+			if (i > 30) minLag = std::min(minLag, arrival * 1000 - (double)output / Ms);
+		}
+		return { IntervalSd(arrivals), IntervalSd(presented), minLag, mapper.GetResyncCount() };
+	}
+}
+
+
+TEST(TimelineMapperTest, PresentedCadenceIsSmootherThanTheArrivals)
+{
+	for (const StreamCase &c : StreamCases) {
+		Replay replay = ReplayStream(c, 9000);
+		EXPECT_TRUE((replay.presentedSd < 0.5) || (replay.presentedSd < replay.arrivalSd / 4))
+			<< c.fps << " fps " << c.ppm << " ppm jitter " << c.jitterMs << " ms: presented sd " << replay.presentedSd << " ms, arrival sd " << replay.arrivalSd << " ms";
+		EXPECT_GT(replay.minLag, -1.0) << c.fps << " fps " << c.ppm << " ppm jitter " << c.jitterMs << " ms";
+		EXPECT_EQ(0u, replay.resyncs);
+	}
+}
+
+TEST(TimelineMapperTest, TimestampWrapKeepsTheCadence)
+{
+	TimelineMapper mapper;
+	uint32_t timestamp = 0xFFFFFFFFu - 10 * FrameTicks;
+	int64_t arrival = 1000 * Ms;
+	int64_t previous = mapper.Map(timestamp, arrival);
+	for (int i = 0; i < 20; i++) {
+		timestamp += FrameTicks;
+		arrival += FrameInterval;
+		int64_t output = mapper.Map(timestamp, arrival);
+		EXPECT_NEAR(FrameInterval, output - previous, 1) << "frame " << i;
+		previous = output;
+	}
+	EXPECT_LT(timestamp, FrameTicks * 10);
+	EXPECT_EQ(0u, mapper.GetResyncCount());
+}
+
+TEST(TimelineMapperTest, LateFrameIsPresentedOnTheCaptureCadence)
+{
+	TimelineMapper mapper;
+	int64_t arrival = 1000 * Ms;
+	int64_t first = mapper.Map(0, arrival);
+	for (uint32_t i = 1; i < 10; i++) mapper.Map(i * FrameTicks, arrival + i * FrameInterval);
+	// Frame 10 is held 50 ms by the network, frame 11 arrives on time.
+	int64_t late = mapper.Map(10 * FrameTicks, arrival + 10 * FrameInterval + 50 * Ms);
+	int64_t next = mapper.Map(11 * FrameTicks, arrival + 11 * FrameInterval);
+	EXPECT_NEAR(first + 10 * FrameInterval, late, 2 * Ms);
+	EXPECT_NEAR(first + 11 * FrameInterval, next, 2 * Ms);
+}
+
+TEST(TimelineMapperTest, OlderFrameDoesNotGoBackwards)
+{
+	TimelineMapper mapper;
+	int64_t arrival = 1000 * Ms;
+	int64_t last = 0;
+	for (uint32_t i = 0; i < 10; i++) last = mapper.Map(i * FrameTicks, arrival + i * FrameInterval);
+	// A frame reordered by the network, older than the last one presented.
+	int64_t reordered = mapper.Map(8 * FrameTicks, arrival + 10 * FrameInterval);
+	EXPECT_GT(reordered, last);
+	EXPECT_EQ(0u, mapper.GetResyncCount());
+}
+
+TEST(TimelineMapperTest, SenderRestartStartsANewTimeline)
+{
+	TimelineMapper mapper;
+	int64_t arrival = 0;
+	int64_t last = 0;
+	for (uint32_t i = 0; i < 100; i++) {
+		arrival += FrameInterval;
+		last = mapper.Map(5000 + i * FrameTicks, arrival);
+	}
+	arrival += FrameInterval;
+	int64_t restarted = mapper.Map(123456789, arrival);
+	EXPECT_EQ(1u, mapper.GetResyncCount());
+	EXPECT_GT(restarted, last);
+	EXPECT_LT(restarted - arrival, 1 * Ms);
+	arrival += FrameInterval;
+	int64_t next = mapper.Map(123456789 + FrameTicks, arrival);
+	EXPECT_NEAR(FrameInterval, next - restarted, 1);
+}
+
+TEST(TimelineMapperTest, ResetStartsFromTheNextFrame)
+{
+	TimelineMapper mapper;
+	for (uint32_t i = 0; i < 10; i++) mapper.Map(i * FrameTicks, 1000 * Ms + i * FrameInterval);
+	mapper.Reset();
+	// A new stream, with unrelated timestamps, is presented when it arrives.
+	int64_t arrival = 5000 * Ms;
+	EXPECT_EQ(arrival, mapper.Map(777, arrival));
+	EXPECT_EQ(arrival, mapper.GetOffset());
+	EXPECT_EQ(0u, mapper.GetResyncCount());
+	EXPECT_NEAR(arrival + FrameInterval, mapper.Map(777 + FrameTicks, arrival + FrameInterval), 1);
+}
@@ -0,0 +1,170 @@
+/*
+YuvConverterBenchmark.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include "YuvConverter.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	struct FrameSize
+	{
+		const char *name;
+		int width;
+		int height;
+	};
+
+	const FrameSize DisplaySizes[] = { { "CIF", 352, 288 }, { "VGA", 640, 480 }, { "720p", 1280, 720 }, { "1080p", 1920, 1080 } };
+
+	int IterationsFor(int width, int height)
+	{
+		int iterations = (100 * 1920 * 1080) / (width * height);
+		return (iterations > 1000) ? 1000 : iterations;
+	}
+}
+
+
+TEST(YuvConverterBenchmark, I420ToNV12AgainstDisplayLoop)
+{
+	printf("I420 to NV12 with the %s kernels, single thread\n", YuvConverter::GetImplementationName());
+	ParallelThreshold parallel(ParallelThreshold::Never);
+	for (const FrameSize &size : DisplaySizes) {
+		int w = size.width;
+		int h = size.height;
+		int iterations = IterationsFor(w, h);
+		std::vector<uint8_t> src = RandomBytes(w * h * 3 / 2);
+		std::vector<uint8_t> expected(w * h * 3 / 2);
+		std::vector<uint8_t> actual(w * h * 3 / 2);
+		double loopMs = MeasureMs(iterations, [&]() {
+			ReferenceI420ToNV12(src.data(), expected.data(), w, h);
+		});
+		double kernelMs = MeasureMs(iterations, [&]() {
+			YuvConverter::I420ToNV12(src.data(), w, src.data() + w * h, w / 2, src.data() + w * h * 5 / 4, w / 2,
+				actual.data(), w, actual.data() + w * h, w, w, h);
+		});
+		printf("  %-6s loop %7.3f ms, kernel %7.3f ms, x%.1f\n", size.name, loopMs, kernelMs, loopMs / kernelMs);
+		EXPECT_EQ(expected, actual) << size.name;
+	}
+}
+
+TEST(YuvConverterBenchmark, NV12ToI420RotateAgainstPerSampleRotation)
+{
+	printf("NV12 to I420 with rotation, fused kernel against a per-sample rotation, single thread\n");
+	ParallelThreshold parallel(ParallelThreshold::Never);
+	const FrameSize cameraSizes[] = { { "VGA", 640, 480 }, { "720p", 1280, 720 }, { "1080p", 1920, 1080 } };
+	for (const FrameSize &size : cameraSizes) {
+		for (int rotation : { 0, 90, 180, 270 }) {
+			// The camera frame is in landscape, the destination is rotated.
+			int sw = size.width;
+			int sh = size.height;
+			int w = (rotation % 180) ? sh : sw;
+			int h = (rotation % 180) ? sw : sh;
+			int iterations = IterationsFor(w, h) / 4 + 1;
+			std::vector<uint8_t> src = RandomBytes(sw * sh * 3 / 2);
+			std::vector<uint8_t> expected(w * h * 3 / 2);
+			std::vector<uint8_t> actual(w * h * 3 / 2);
+			double referenceMs = MeasureMs(iterations, [&]() {
+				ReferenceNV12ToI420Rotate(src.data(), sw, src.data() + sw * sh, sw, expected.data(), w, h, rotation);
+			});
+			double kernelMs = MeasureMs(iterations, [&]() {
+				YuvConverter::NV12ToI420Rotate(src.data(), sw, src.data() + sw * sh, sw,
+					actual.data(), w, actual.data() + w * h, w / 2, actual.data() + w * h * 5 / 4, w / 2, w, h, rotation);
+			});
+			printf("  %-6s %3d: per-sample %7.3f ms, fused %7.3f ms, x%.1f\n", size.name, rotation, referenceMs, kernelMs, referenceMs / kernelMs);
+			EXPECT_EQ(expected, actual) << size.name << " rotation " << rotation;
+		}
+	}
+}
+
+TEST(YuvConverterBenchmark, ScaleRotateThroughput)
+{
+	printf("NV12 to I420 scaling and rotation, kernel against a per-sample bilinear filter, single thread\n");
+	ParallelThreshold parallel(ParallelThreshold::Never);
+	struct ScaleSize { const char *name; int srcWidth; int srcHeight; int width; int height; };
+	const ScaleSize sizes[] = {
+		{ "720p to 360p", 1280, 720, 640, 360 }, { "720p to 480p", 1280, 720, 854, 480 }, { "1080p to VGA", 1920, 1080, 640, 480 }
+	};
+	for (const ScaleSize &size : sizes) {
+		for (int rotation : { 0, 90 }) {
+			int sw = size.srcWidth;
+			int sh = size.srcHeight;
+			int w = rotation ? size.height : size.width;
+			int h = rotation ? size.width : size.height;
+			int iterations = IterationsFor(w, h) / 4 + 1;
+			std::vector<uint8_t> src = RandomBytes(sw * sh * 3 / 2);
+			std::vector<uint8_t> expected(w * h * 3 / 2);
+			std::vector<uint8_t> actual(w * h * 3 / 2);
+			double referenceMs = MeasureMs(iterations, [&]() {
+				ReferenceNV12ToI420ScaleRotate(src.data(), sw, src.data() + sw * sh, sw, sw, sh, expected.data(), w, h, rotation);
+			});
+			double kernelMs = MeasureMs(iterations, [&]() {
+				YuvConverter::NV12ToI420ScaleRotate(src.data(), sw, src.data() + sw * sh, sw, sw, sh,
+					actual.data(), w, actual.data() + w * h, w / 2, actual.data() + w * h * 5 / 4, w / 2, w, h, rotation);
+			});
+			printf("  %-13s %3d: per-sample %7.3f ms, kernel %7.3f ms (%.0f Mpixel/s), x%.1f\n", size.name, rotation,
+				referenceMs, kernelMs, (w * h) / (kernelMs * 1000.0), referenceMs / kernelMs);
+			EXPECT_EQ(expected, actual) << size.name << " rotation " << rotation;
+		}
+	}
+}
+
+TEST(YuvConverterBenchmark, FusedPyramidAgainstSeparatePasses)
+{
+	printf("NV12 to a 3-level I420 pyramid, fused reductions against separate downscaling passes, single thread\n");
+	ParallelThreshold parallel(ParallelThreshold::Never);
+	const FrameSize cameraSizes[] = { { "720p", 1280, 720 }, { "1080p", 1920, 1080 } };
+	for (const FrameSize &size : cameraSizes) {
+		for (int rotation : { 0, 90 }) {
+			int sw = size.width;
+			int sh = size.height;
+			int w = rotation ? sh : sw;
+			int h = rotation ? sw : sh;
+			int iterations = IterationsFor(w, h) / 2 + 1;
+			std::vector<uint8_t> src = RandomBytes(sw * sh * 3 / 2);
+			std::vector<PictureBuffer> fused;
+			std::vector<PictureBuffer> separate;
+			YuvConverter::YuvPlanes levels[YuvConverter::MaxPyramidLevels];
+			for (int i = 0; i < YuvConverter::MaxPyramidLevels; i++) {
+				fused.emplace_back(w >> i, h >> i, false);
+				separate.emplace_back(w >> i, h >> i, false);
+				levels[i] = fused[i].planes;
+			}
+			double separateMs = MeasureMs(iterations, [&]() {
+				YuvConverter::NV12ToPyramid(src.data(), sw, src.data() + sw * sh, sw, sw, sh, &separate[0].planes, 1, rotation);
+				for (int i = 1; i < YuvConverter::MaxPyramidLevels; i++) ReferenceHalvePicture(separate[i - 1].planes, separate[i].planes);
+			});
+			double fusedMs = MeasureMs(iterations, [&]() {
+				YuvConverter::NV12ToPyramid(src.data(), sw, src.data() + sw * sh, sw, sw, sh, levels, YuvConverter::MaxPyramidLevels, rotation);
+			});
+			printf("  %-6s %3d: separate passes %7.3f ms, fused %7.3f ms, x%.2f\n", size.name, rotation, separateMs, fusedMs, separateMs / fusedMs);
+			for (int i = 0; i < YuvConverter::MaxPyramidLevels; i++) {
+				EXPECT_EQ(separate[i].bytes, fused[i].bytes) << size.name << " rotation " << rotation << " level " << i;
+			}
+		}
+	}
+}
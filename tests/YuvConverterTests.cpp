@@ -0,0 +1,466 @@
+/*
+YuvConverterTests.cpp
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "YuvConverter.h"
+#include "TestSupport.h"
+
+using namespace libmswinrtvid;
+using namespace libmswinrtvid::test;
+
+
+namespace
+{
+	struct FrameSize
+	{
+		int width;
+		int height;
+	};
+
+	const FrameSize DisplaySizes[] = { { 352, 288 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+}
+
+
+TEST(YuvConverterTest, ImplementationIsSelected)
+{
+	ASSERT_NE(YuvConverter::GetImplementationName(), nullptr);
+	printf("YuvConverter implementation: %s\n", YuvConverter::GetImplementationName());
+}
+
+TEST(YuvConverterTest, InterleaveUVMatchesScalarLoop)
+{
+	// Every count around the vector widths, from misaligned pointers.
+	std::vector<uint8_t> u = RandomBytes(256, 1);
+	std::vector<uint8_t> v = RandomBytes(256, 2);
+	for (int offset = 0; offset < 3; offset++) {
+		for (int count = 0; count <= 130; count++) {
+			std::vector<uint8_t> expected(2 * count + 8, 0xAA);
+			std::vector<uint8_t> actual(2 * count + 8, 0xAA);
+			for (int i = 0; i < count; i++) {
+				expected[offset + 2 * i] = u[offset + i];
+				expected[offset + 2 * i + 1] = v[offset + i];
+			}
+			YuvConverter::InterleaveUV(actual.data() + offset, u.data() + offset, v.data() + offset, count);
+			ASSERT_EQ(expected, actual) << "count " << count << ", offset " << offset;
+		}
+	}
+}
+
+TEST(YuvConverterTest, I420ToNV12MatchesDisplayLoop)
+{
+	for (const FrameSize &size : DisplaySizes) {
+		int w = size.width;
+		int h = size.height;
+		std::vector<uint8_t> src = RandomBytes(w * h * 3 / 2);
+		std::vector<uint8_t> expected(w * h * 3 / 2);
+		ReferenceI420ToNV12(src.data(), expected.data(), w, h);
+		for (int threshold : { ParallelThreshold::Never, ParallelThreshold::Always }) {
+			ParallelThreshold parallel(threshold);
+			std::vector<uint8_t> actual(w * h * 3 / 2);
+			YuvConverter::I420ToNV12(src.data(), w, src.data() + w * h, w / 2, src.data() + w * h * 5 / 4, w / 2,
+				actual.data(), w, actual.data() + w * h, w, w, h);
+			EXPECT_EQ(expected, actual) << w << "x" << h << ((threshold == ParallelThreshold::Always) ? " sliced" : "");
+		}
+	}
+}
+
+namespace
+{
+	/// The chroma interleave of MediaStreamSource::RenderFrame before the SIMD kernels, generalized to any source stride.
+	void ReferencePitchedI420ToNV12(const uint8_t *srcY, int srcYStride, const uint8_t *srcU, int srcUStride, const uint8_t *srcV, int srcVStride,
+		uint8_t *dstY, int dstYPitch, uint8_t *dstUV, int dstUVPitch, int width, int height)
+	{
+		for (int i = 0; i < height; i++) {
+			memcpy(dstY + i * dstYPitch, srcY + i * srcYStride, width);
+		}
+		for (int i = 0; i < height / 2; i++) {
+			for (int j = 0; j < width / 2; j++) {
+				dstUV[i * dstUVPitch + j * 2] = srcU[i * srcUStride + j];
+				dstUV[i * dstUVPitch + j * 2 + 1] = srcV[i * srcVStride + j];
+			}
+		}
+	}
+}
+
+TEST(YuvConverterTest, I420ToNV12HandlesOddSizesAndPitches)
+{
+	const int widths[] = { 1, 2, 3, 15, 16, 17, 31, 33, 63, 65, 127, 641 };
+	const int heights[] = { 1, 2, 3, 17, 33, 49 };
+	const int paddings[] = { 0, 1, 13, 64 };
+	for (int w : widths) {
+		for (int h : heights) {
+			for (int padding : paddings) {
+				// Odd strides on the source side as well, the destination pitch being the padded width.
+				int yStride = w + padding;
+				int uvStride = w / 2 + padding;
+				int pitch = w + padding;
+				std::vector<uint8_t> srcY = RandomBytes(yStride * h, 1);
+				std::vector<uint8_t> srcU = RandomBytes(uvStride * (h / 2) + 1, 2);
+				std::vector<uint8_t> srcV = RandomBytes(uvStride * (h / 2) + 1, 3);
+				std::vector<uint8_t> expected(pitch * (h + h / 2 + 1), 0xCD);
+				ReferencePitchedI420ToNV12(srcY.data(), yStride, srcU.data(), uvStride, srcV.data(), uvStride,
+					expected.data(), pitch, expected.data() + pitch * h, pitch, w, h);
+				for (int threshold : { ParallelThreshold::Never, ParallelThreshold::Always }) {
+					ParallelThreshold parallel(threshold);
+					// The padding bytes must be left untouched.
+					std::vector<uint8_t> actual(pitch * (h + h / 2 + 1), 0xCD);
+					YuvConverter::I420ToNV12(srcY.data(), yStride, srcU.data(), uvStride, srcV.data(), uvStride,
+						actual.data(), pitch, actual.data() + pitch * h, pitch, w, h);
+					ASSERT_EQ(expected, actual) << w << "x" << h << ", padding " << padding
+						<< ((threshold == ParallelThreshold::Always) ? " sliced" : "");
+				}
+			}
+		}
+	}
+}
+
+namespace
+{
+	/// Stands for the camera: delivers contiguous NV12 frames whose content changes from one frame to the next.
+	class FakeNV12Source
+	{
+	public:
+		FakeNV12Source(int width, int height) : mWidth(width), mHeight(height), mFrameCount(0) {}
+
+		const std::vector<uint8_t> & NextFrame()
+		{
+			mFrame = RandomBytes(mWidth * mHeight + (mWidth & ~1) * (mHeight / 2), ++mFrameCount);
+			return mFrame;
+		}
+
+		const uint8_t * Y() const { return mFrame.data(); }
+		const uint8_t * UV() const { return mFrame.data() + mWidth * mHeight; }
+
+	private:
+		int mWidth;
+		int mHeight;
+		unsigned int mFrameCount;
+		std::vector<uint8_t> mFrame;
+	};
+}
+
+TEST(YuvConverterTest, NV12OutputOfTheCameraSizeIsPassedThrough)
+{
+	const int w = 640;
+	const int h = 480;
+	FakeNV12Source source(w, h);
+	std::vector<uint8_t> output(w * h * 3 / 2);
+	YuvConverter::YuvPlanes nv12 = YuvConverter::NV12Planes(output.data(), w, output.data() + w * h, w, w, h);
+	for (int frame = 0; frame < 10; frame++) {
+		const std::vector<uint8_t> &input = source.NextFrame();
+		bool passedThrough = YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &nv12, 1, 0, false);
+		ASSERT_TRUE(passedThrough) << "frame " << frame;
+		ASSERT_EQ(input, output) << "frame " << frame;
+	}
+}
+
+TEST(YuvConverterTest, NV12OutputIsConvertedWhenItDiffersFromTheCamera)
+{
+	const int w = 640;
+	const int h = 480;
+	FakeNV12Source source(w, h);
+	source.NextFrame();
+	std::vector<uint8_t> output(w * h * 3 / 2);
+	std::vector<uint8_t> expected(w * h * 3 / 2);
+
+	// An I420 output, a rotation, a mirror, a scaled output or a pyramid all need the conversion.
+	YuvConverter::YuvPlanes i420 = YuvConverter::I420Planes(output.data(), w, output.data() + w * h, w / 2, output.data() + w * h * 5 / 4, w / 2, w, h);
+	EXPECT_FALSE(YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &i420, 1, 0, false));
+	ReferenceNV12ToI420Rotate(source.Y(), w, source.UV(), w, expected.data(), w, h, 0);
+	EXPECT_EQ(expected, output);
+
+	YuvConverter::YuvPlanes nv12 = YuvConverter::NV12Planes(output.data(), w, output.data() + w * h, w, w, h);
+	EXPECT_FALSE(YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &nv12, 1, 180, false));
+	EXPECT_FALSE(YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &nv12, 1, 0, true));
+	YuvConverter::YuvPlanes half = YuvConverter::NV12Planes(output.data(), w / 2, output.data() + w * h / 4, w / 2, w / 2, h / 2);
+	EXPECT_FALSE(YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &half, 1, 0, false));
+}
+
+TEST(YuvConverterTest, CroppedNV12FrameIsPassedThroughRowByRow)
+{
+	// The centre of a 640x480 frame cropped to 480x480: the source rows keep the stride of the camera frame.
+	const int sw = 640;
+	const int sh = 480;
+	const int w = 480;
+	const int x = (sw - w) / 2;
+	FakeNV12Source source(sw, sh);
+	source.NextFrame();
+	std::vector<uint8_t> output(w * sh * 3 / 2, 0);
+	YuvConverter::YuvPlanes nv12 = YuvConverter::NV12Planes(output.data(), w, output.data() + w * sh, w, w, sh);
+	ASSERT_TRUE(YuvConverter::NV12ToPyramidOrCopy(source.Y() + x, sw, source.UV() + x, sw, w, sh, &nv12, 1, 0, false));
+	for (int row = 0; row < sh; row++) {
+		ASSERT_EQ(0, memcmp(output.data() + row * w, source.Y() + row * sw + x, w)) << "luma row " << row;
+	}
+	for (int row = 0; row < sh / 2; row++) {
+		ASSERT_EQ(0, memcmp(output.data() + w * sh + row * w, source.UV() + row * sw + x, w)) << "chroma row " << row;
+	}
+}
+
+TEST(YuvConverterTest, NV12OutputHonoursThePictureStrides)
+{
+	// An MSPicture of the allocator may have padded rows: the chroma plane starts after stride * height luma bytes
+	// and its rows have the luma stride.
+	const int w = 630;
+	const int h = 480;
+	const int stride = 640;
+	const uint8_t padding = 0xEE;
+	FakeNV12Source source(w, h);
+	source.NextFrame();
+	std::vector<uint8_t> expected(w * h * 3 / 2);
+	YuvConverter::YuvPlanes packed = YuvConverter::NV12Planes(expected.data(), w, expected.data() + w * h, w, w, h);
+	for (bool mirror : { false, true }) {
+		std::vector<uint8_t> picture(stride * h * 3 / 2, padding);
+		YuvConverter::YuvPlanes nv12 = YuvConverter::NV12Planes(picture.data(), stride, picture.data() + stride * h, stride, w, h);
+		YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &packed, 1, 0, mirror);
+		YuvConverter::NV12ToPyramidOrCopy(source.Y(), w, source.UV(), w, w, h, &nv12, 1, 0, mirror);
+		for (int row = 0; row < h * 3 / 2; row++) {
+			ASSERT_EQ(0, memcmp(picture.data() + row * stride, expected.data() + row * w, w)) << "row " << row << " mirror " << mirror;
+			for (int x = w; x < stride; x++) {
+				ASSERT_EQ(padding, picture[row * stride + x]) << "row " << row << " mirror " << mirror;
+			}
+		}
+	}
+}
+
+namespace
+{
+	struct ScaleCase
+	{
+		int srcWidth;
+		int srcHeight;
+		int width;
+		int height;
+	};
+
+	// Landscape camera frames to landscape or portrait pictures, 2:1 reductions and fractional ratios, odd sizes.
+	const ScaleCase ScaleCases[] = {
+		{ 1280, 720, 640, 360 }, { 1280, 720, 352, 288 }, { 1920, 1080, 640, 480 }, { 641, 479, 320, 240 },
+		{ 1280, 720, 360, 640 }, { 640, 480, 320, 240 }, { 640, 480, 854, 480 }
+	};
+}
+
+TEST(YuvConverterTest, ScaleRotateMatchesBilinearReference)
+{
+	for (const ScaleCase &c : ScaleCases) {
+		for (int rotation : { 0, 90, 180, 270 }) {
+			for (int threshold : { ParallelThreshold::Never, ParallelThreshold::Always }) {
+				ParallelThreshold parallel(threshold);
+				int sw = c.srcWidth;
+				int sh = c.srcHeight;
+				int uvStride = sw & ~1;
+				int w = (rotation % 180) ? c.height : c.width;
+				int h = (rotation % 180) ? c.width : c.height;
+				std::vector<uint8_t> src = RandomBytes(sw * sh + uvStride * (sh / 2), (unsigned int)(sw + rotation));
+				const uint8_t *srcUV = src.data() + sw * sh;
+				std::vector<uint8_t> expected(w * h * 3 / 2);
+				std::vector<uint8_t> actual(w * h * 3 / 2);
+				ReferenceNV12ToI420ScaleRotate(src.data(), sw, srcUV, uvStride, sw, sh, expected.data(), w, h, rotation);
+				YuvConverter::NV12ToI420ScaleRotate(src.data(), sw, srcUV, uvStride, sw, sh,
+					actual.data(), w, actual.data() + w * h, w / 2, actual.data() + w * h + (w / 2) * (h / 2), w / 2, w, h, rotation);
+				ASSERT_EQ(expected, actual) << sw << "x" << sh << " to " << w << "x" << h << " rotation " << rotation << " threshold " << threshold;
+
+				// The NV12 destination holds the same samples, interleaved.
+				std::vector<uint8_t> nv12(w * h + (w & ~1) * (h / 2));
+				YuvConverter::NV12ScaleRotate(src.data(), sw, srcUV, uvStride, sw, sh, nv12.data(), w, nv12.data() + w * h, w & ~1, w, h, rotation);
+				ASSERT_TRUE(std::equal(expected.begin(), expected.begin() + w * h, nv12.begin()));
+				const uint8_t *expectedU = expected.data() + w * h;
+				const uint8_t *expectedV = expectedU + (w / 2) * (h / 2);
+				for (int y = 0; y < h / 2; y++) {
+					for (int x = 0; x < w / 2; x++) {
+						ASSERT_EQ(expectedU[y * (w / 2) + x], nv12[w * h + y * (w & ~1) + 2 * x]);
+						ASSERT_EQ(expectedV[y * (w / 2) + x], nv12[w * h + y * (w & ~1) + 2 * x + 1]);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(YuvConverterTest, ScaledSmoothPictureKeepsAHighPsnr)
+{
+	// A smooth pattern sampled at the centers of the destination samples is what an ideal filter would give.
+	auto pattern = [](double x, double y) { return 128 + 100 * sin(x * 0.05) * cos(y * 0.03); };
+	const ScaleCase cases[] = { { 1280, 720, 854, 480 }, { 1280, 720, 640, 360 }, { 640, 480, 1280, 960 } };
+	for (const ScaleCase &c : cases) {
+		int sw = c.srcWidth;
+		int sh = c.srcHeight;
+		int w = c.width;
+		int h = c.height;
+		std::vector<uint8_t> src(sw * sh * 3 / 2, 128);
+		for (int y = 0; y < sh; y++) {
+			for (int x = 0; x < sw; x++) src[y * sw + x] = (uint8_t)lround(pattern(x, y));
+		}
+		std::vector<uint8_t> dst(w * h * 3 / 2);
+		YuvConverter::NV12ToI420ScaleRotate(src.data(), sw, src.data() + sw * sh, sw, sw, sh,
+			dst.data(), w, dst.data() + w * h, w / 2, dst.data() + w * h * 5 / 4, w / 2, w, h, 0);
+		double psnr = PlanePsnr(dst.data(), w, w, h, [&](int x, int y) {
+			return pattern((x + 0.5) * sw / w - 0.5, (y + 0.5) * sh / h - 0.5);
+		});
+		printf("PSNR %dx%d to %dx%d: %.1f dB\n", sw, sh, w, h, psnr);
+		EXPECT_GT(psnr, 40.0) << sw << "x" << sh << " to " << w << "x" << h;
+	}
+}
+
+TEST(YuvConverterTest, PyramidLevelsMatchConversionThenBoxReductions)
+{
+	const ScaleCase cases[] = { { 1280, 720, 1280, 720 }, { 1920, 1080, 1280, 720 }, { 641, 481, 641, 481 }, { 1280, 720, 1000, 562 } };
+	for (const ScaleCase &c : cases) {
+		for (int rotation : { 0, 90, 180, 270 }) {
+			for (bool nv12 : { false, true }) {
+				for (int threshold : { ParallelThreshold::Never, ParallelThreshold::Always }) {
+					ParallelThreshold parallel(threshold);
+					int sw = c.srcWidth;
+					int sh = c.srcHeight;
+					int w = (rotation % 180) ? c.height : c.width;
+					int h = (rotation % 180) ? c.width : c.height;
+					std::vector<uint8_t> src = RandomBytes(sw * sh + (sw & ~1) * (sh / 2), (unsigned int)(sw + rotation));
+					const uint8_t *srcUV = src.data() + sw * sh;
+					std::vector<PictureBuffer> actual;
+					std::vector<PictureBuffer> expected;
+					YuvConverter::YuvPlanes levels[YuvConverter::MaxPyramidLevels];
+					for (int i = 0; i < YuvConverter::MaxPyramidLevels; i++) {
+						actual.emplace_back(w >> i, h >> i, nv12);
+						expected.emplace_back(w >> i, h >> i, nv12);
+						levels[i] = actual[i].planes;
+					}
+					YuvConverter::NV12ToPyramid(src.data(), sw, srcUV, sw & ~1, sw, sh, levels, YuvConverter::MaxPyramidLevels, rotation);
+
+					const YuvConverter::YuvPlanes &top = expected[0].planes;
+					if (nv12) {
+						YuvConverter::NV12ScaleRotate(src.data(), sw, srcUV, sw & ~1, sw, sh, top.y, top.yStride, top.u, top.uStride, w, h, rotation);
+					} else {
+						YuvConverter::NV12ToI420ScaleRotate(src.data(), sw, srcUV, sw & ~1, sw, sh,
+							top.y, top.yStride, top.u, top.uStride, top.v, top.vStride, w, h, rotation);
+					}
+					for (int i = 1; i < YuvConverter::MaxPyramidLevels; i++) ReferenceHalvePicture(expected[i - 1].planes, expected[i].planes);
+					for (int i = 0; i < YuvConverter::MaxPyramidLevels; i++) {
+						ASSERT_EQ(expected[i].bytes, actual[i].bytes) << sw << "x" << sh << " to " << w << "x" << h << " rotation " << rotation
+							<< (nv12 ? " NV12" : " I420") << " threshold " << threshold << " level " << i;
+					}
+				}
+			}
+		}
+	}
+}
+
+namespace
+{
+	// Sizes around the 8x8 transpose tiles and the 64x64 blocks, odd ones included.
+	const ScaleCase RotateSizes[] = { { 64, 64, 64, 64 }, { 72, 40, 72, 40 }, { 37, 23, 37, 23 }, { 641, 479, 641, 479 }, { 1280, 720, 1280, 720 } };
+
+	// Contiguous I420 copy of a NV12 picture, to compare it with the I420 references.
+	std::vector<uint8_t> NV12ToContiguousI420(const std::vector<uint8_t> &nv12, int width, int height, int uvStride)
+	{
+		int cw = width / 2;
+		int ch = height / 2;
+		std::vector<uint8_t> i420(width * height + 2 * cw * ch);
+		memcpy(i420.data(), nv12.data(), width * height);
+		for (int y = 0; y < ch; y++) {
+			for (int x = 0; x < cw; x++) {
+				i420[width * height + y * cw + x] = nv12[width * height + y * uvStride + 2 * x];
+				i420[width * height + cw * ch + y * cw + x] = nv12[width * height + y * uvStride + 2 * x + 1];
+			}
+		}
+		return i420;
+	}
+}
+
+TEST(YuvConverterTest, RotateMatchesPerSampleReference)
+{
+	for (const ScaleCase &c : RotateSizes) {
+		for (int rotation : { 0, 90, 180, 270 }) {
+			for (int threshold : { ParallelThreshold::Never, ParallelThreshold::Always }) {
+				ParallelThreshold parallel(threshold);
+				// The source rows are padded so that a stride mistake cannot go unnoticed.
+				int sw = c.srcWidth;
+				int sh = c.srcHeight;
+				int stride = sw + 8;
+				int w = (rotation % 180) ? sh : sw;
+				int h = (rotation % 180) ? sw : sh;
+				int cw = w / 2;
+				int ch = h / 2;
+				std::vector<uint8_t> src = RandomBytes(stride * (sh + sh / 2), (unsigned int)(sw * 4 + rotation));
+				const uint8_t *srcUV = src.data() + stride * sh;
+				std::vector<uint8_t> expected(w * h + 2 * cw * ch);
+				ReferenceNV12ToI420Rotate(src.data(), stride, srcUV, stride, expected.data(), w, h, rotation);
+
+				std::vector<uint8_t> i420(w * h + 2 * cw * ch);
+				YuvConverter::NV12ToI420Rotate(src.data(), stride, srcUV, stride,
+					i420.data(), w, i420.data() + w * h, cw, i420.data() + w * h + cw * ch, cw, w, h, rotation);
+				ASSERT_EQ(expected, i420) << "NV12ToI420Rotate " << sw << "x" << sh << " rotation " << rotation << " threshold " << threshold;
+
+				std::vector<uint8_t> nv12(w * h + 2 * cw * ch);
+				YuvConverter::NV12Rotate(src.data(), stride, srcUV, stride, nv12.data(), w, nv12.data() + w * h, 2 * cw, w, h, rotation);
+				ASSERT_EQ(expected, NV12ToContiguousI420(nv12, w, h, 2 * cw)) << "NV12Rotate " << sw << "x" << sh << " rotation " << rotation
+					<< " threshold " << threshold;
+			}
+		}
+	}
+}
+
+TEST(YuvConverterTest, MirroredRotationMatchesPerSampleReference)
+{
+	for (const ScaleCase &c : RotateSizes) {
+		for (int rotation : { 0, 90, 180, 270 }) {
+			for (int threshold : { ParallelThreshold::Never, ParallelThreshold::Always }) {
+				ParallelThreshold parallel(threshold);
+				int sw = c.srcWidth;
+				int sh = c.srcHeight;
+				int stride = sw + 8;
+				int w = (rotation % 180) ? sh : sw;
+				int h = (rotation % 180) ? sw : sh;
+				int cw = w / 2;
+				int ch = h / 2;
+				std::vector<uint8_t> src = RandomBytes(stride * (sh + sh / 2), (unsigned int)(sw * 4 + rotation));
+				const uint8_t *srcUV = src.data() + stride * sh;
+				std::vector<uint8_t> expected(w * h + 2 * cw * ch);
+				ReferenceNV12ToI420Rotate(src.data(), stride, srcUV, stride, expected.data(), w, h, rotation, true);
+
+				// Without scaling, the mirrored rotation goes through the transposes and the reversed copies.
+				std::vector<uint8_t> i420(w * h + 2 * cw * ch);
+				YuvConverter::NV12ToI420ScaleRotate(src.data(), stride, srcUV, stride, sw, sh,
+					i420.data(), w, i420.data() + w * h, cw, i420.data() + w * h + cw * ch, cw, w, h, rotation, true);
+				ASSERT_EQ(expected, i420) << "NV12ToI420ScaleRotate " << sw << "x" << sh << " rotation " << rotation << " threshold " << threshold;
+
+				std::vector<uint8_t> nv12(w * h + 2 * cw * ch);
+				YuvConverter::NV12ScaleRotate(src.data(), stride, srcUV, stride, sw, sh, nv12.data(), w, nv12.data() + w * h, 2 * cw, w, h, rotation, true);
+				ASSERT_EQ(expected, NV12ToContiguousI420(nv12, w, h, 2 * cw)) << "NV12ScaleRotate " << sw << "x" << sh << " rotation " << rotation
+					<< " threshold " << threshold;
+
+				// With scaling, the mirror is folded in the taps.
+				int sdw = (w / 2) | 1;
+				int sdh = (h * 2) / 3;
+				std::vector<uint8_t> scaledExpected(sdw * sdh + 2 * (sdw / 2) * (sdh / 2));
+				std::vector<uint8_t> scaled(scaledExpected.size());
+				ReferenceNV12ToI420ScaleRotate(src.data(), stride, srcUV, stride, sw, sh, scaledExpected.data(), sdw, sdh, rotation, true);
+				YuvConverter::NV12ToI420ScaleRotate(src.data(), stride, srcUV, stride, sw, sh, scaled.data(), sdw, scaled.data() + sdw * sdh, sdw / 2,
+					scaled.data() + sdw * sdh + (sdw / 2) * (sdh / 2), sdw / 2, sdw, sdh, rotation, true);
+				ASSERT_EQ(scaledExpected, scaled) << "scaled " << sw << "x" << sh << " to " << sdw << "x" << sdh << " rotation " << rotation
+					<< " threshold " << threshold;
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+/*
+mscommon.h
+
+mediastreamer2 library - modular sound and video processing and streaming
+Windows Audio Session API sound card plugin for mediastreamer2
+Copyright (C) 2010-2023 Belledonne Communications, Grenoble, France
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#pragma once
+
+// Stand-in for the mediastreamer2 header used by the portable components, so that they are built without
+// mediastreamer2. The allocations are counted so that the tests can check which code paths allocate.
+
+#include <stdlib.h>
+
+#include <atomic>
+
+
+inline std::atomic<long> & ms_test_allocation_count()
+{
+	static std::atomic<long> count(0);
+	return count;
+}
+
+inline std::atomic<long> & ms_test_free_count()
+{
+	static std::atomic<long> count(0);
+	return count;
+}
+
+inline void * ms_malloc(size_t size)
+{
+	ms_test_allocation_count()++;
+	return malloc(size);
+}
+
+inline void ms_free(void *ptr)
+{
+	if (ptr == NULL) return;
+	ms_test_free_count()++;
+	free(ptr);
+}